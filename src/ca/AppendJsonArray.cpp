@@ -35,7 +35,7 @@ HRESULT AppendJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath,
         }
 
         if (fs::exists(fs::path(wzFile))) {
-            json j;
+            ojson j;
             std::ifstream is{ fs::path(wzFile) };
 
             if (!is.is_open())
@@ -47,29 +47,21 @@ HRESULT AppendJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath,
             is >> j;
             is.close();
 
-            // Query the array using JSONPath
-            auto query = jsonpath::json_query(j, sElementPath);
-
-            if (query.empty())
+            // Resolve the target arrays once and append to them in place
+            auto matches = jsonpath::cached_expression<ojson>(sElementPath)->resolve(j);
+            if (matches.empty())
             {
                 WcaLog(LOGMSG_STANDARD, "Array not found at path: %s", sElementPath.c_str());
                 return HRESULT_FROM_WIN32(ERROR_OBJECT_NOT_FOUND);
             }
 
-            // Parse the value to append
-            json valueToAppend;
-            try {
-                valueToAppend = json::parse(valueUtf8);
-            }
-            catch (const std::exception&) {
-                // If parsing fails, treat as a string value
-                valueToAppend = json(valueUtf8);
-            }
+            // Parse the value to append (plain text that is not JSON becomes a string value)
+            ojson valueToAppend = MakeJsonValue(valueUtf8, NULL);
 
             WcaLog(LOGMSG_STANDARD, "Appending value to array at: %s", sElementPath.c_str());
 
             // Append to the array
-            auto f = [valueToAppend](const std::string& /*path*/, json& value)
+            auto f = [&valueToAppend](const jsonpath::path_node& /*path*/, ojson& value)
                 {
                     if (value.is_array())
                     {
@@ -77,7 +69,7 @@ HRESULT AppendJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath,
                     }
                 };
 
-            jsonpath::json_replace(j, sElementPath, f);
+            matches.update(f);
 
             WcaLog(LOGMSG_STANDARD, "Successfully appended value to array");
 
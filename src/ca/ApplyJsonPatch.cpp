@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "JsonFile.h"
+
+HRESULT ApplyJsonPatch(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue)
+{
+    try
+    {
+        // Input validation
+        if (NULL == wzFile || L'\0' == *wzFile)
+        {
+            WcaLog(LOGMSG_STANDARD, "Invalid file path parameter");
+            return E_INVALIDARG;
+        }
+
+        if (sElementPath.empty())
+        {
+            WcaLog(LOGMSG_STANDARD, "Invalid element path parameter");
+            return E_INVALIDARG;
+        }
+
+        if (fs::exists(fs::path(wzFile))) {
+            // The patch is given inline or as the path of a patch file. The file and the patch keep
+            // their member order, so the file is written in the same order whether the patch is
+            // streamed or applied in memory: members stay where they are and added ones follow.
+            ojson patch;
+            HRESULT hr = LoadJsonDocumentValue(wzValue, patch);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+            if (!patch.is_array())
+            {
+                WcaLog(LOGMSG_STANDARD, "applyJsonPatch requires a JSON Patch document (an array of operations)");
+                return E_INVALIDARG;
+            }
+
+            // A patch of a whole large file is streamed from the file into its replacement rather
+            // than applied to the parsed document. Patches one pass cannot apply, and patches that
+            // fail, leave the file untouched and go through the in-memory path below, which
+            // reports any failure.
+            std::error_code sizeEc;
+            if (sElementPath == "$" && fs::file_size(fs::path(wzFile), sizeEc) >= JSON_STREAM_MIN_BYTES && !sizeEc)
+            {
+                std::error_code streamEc;
+                hr = RewriteJsonFile(wzFile, [&patch](std::istream& input, json_visitor& output, std::error_code& ec)
+                    {
+                        jsonpatch::stream_apply_patch(input, patch, output, ec);
+                    }, streamEc);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+                if (S_OK == hr)
+                {
+                    WcaLog(LOGMSG_STANDARD, "Successfully applied %zu JSON Patch operations while streaming file: %ls", patch.size(), wzFile);
+                    return S_OK;
+                }
+                WcaLog(LOGMSG_VERBOSE, "JSON Patch was not streamed (%s); applying it in memory", streamEc.message().c_str());
+            }
+
+            ojson j;
+            std::ifstream is{ fs::path(wzFile) };
+
+            if (!is.is_open())
+            {
+                WcaLog(LOGMSG_STANDARD, "Failed to open file for reading: %ls", wzFile);
+                return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+            }
+
+            // Parse JSON with error handling
+            try {
+                is >> j;
+            }
+            catch (const std::exception& e) {
+                is.close();
+                WcaLog(LOGMSG_STANDARD, "Failed to parse JSON file: %ls. Error: %s", wzFile, e.what());
+                return E_FAIL;
+            }
+            is.close();
+
+            WcaLog(LOGMSG_STANDARD, "Applying %zu JSON Patch operations at: %s", patch.size(), sElementPath.c_str());
+
+            // Apply the whole patch to each match. A failed operation undoes the earlier operations
+            // on that match, and the file is only written when every match was patched, so the
+            // file either receives the entire patch or is left untouched.
+            size_t matchCount = 0;
+            std::error_code ec;
+            auto f = [&patch, &matchCount, &ec](const jsonpath::path_node& /*path*/, ojson& value)
+                {
+                    ++matchCount;
+                    if (!ec)
+                    {
+                        jsonpatch::apply_patch(value, patch, ec);
+                    }
+                };
+            jsonpath::json_replace(j, sElementPath, f);
+
+            if (0 == matchCount)
+            {
+                WcaLog(LOGMSG_STANDARD, "Element not found at path: %s", sElementPath.c_str());
+                return HRESULT_FROM_WIN32(ERROR_OBJECT_NOT_FOUND);
+            }
+
+            if (ec)
+            {
+                WcaLog(LOGMSG_STANDARD, "Failed to apply JSON Patch at path: %s. Error: %s", sElementPath.c_str(), ec.message().c_str());
+                return E_FAIL;
+            }
+
+            WcaLog(LOGMSG_STANDARD, "Successfully applied JSON Patch");
+
+            hr = WriteJsonOutput(wzFile, j);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+        else {
+            WcaLog(LOGMSG_STANDARD, "Unable to locate file: %ls", wzFile);
+            return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        }
+        return S_OK;
+    }
+    catch (_com_error& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "Encountered COM error: %ls", e.ErrorMessage());
+        return E_FAIL;
+    }
+    catch (std::exception& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "Encountered error %s", e.what());
+        return E_FAIL;
+    }
+    catch (...)
+    {
+        WcaLog(LOGMSG_STANDARD, "Encountered unknown error");
+        return E_FAIL;
+    }
+}
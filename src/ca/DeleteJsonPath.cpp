@@ -21,7 +21,7 @@ HRESULT DeleteJsonPath(__in_z LPCWSTR wzFile, const std::string& sElementPath)
         HRESULT hr = S_OK;
 
         if (fs::exists(fs::path(wzFile))) {
-            json j;
+            ojson j;
             SetLastError(0);
             std::ifstream is{ fs::path(wzFile) };
 
@@ -35,24 +35,21 @@ HRESULT DeleteJsonPath(__in_z LPCWSTR wzFile, const std::string& sElementPath)
             is >> j;
             is.close();
 
-            auto expr = jsonpath::make_expression<json>(sElementPath);
-            std::vector<jsonpath::json_location> locations = expr.select_paths(j,
-                jsonpath::result_options::sort_descending);
+            // Matches are resolved without duplicates and removed in descending path order, so
+            // removing one array element does not shift the index of another match.
+            auto matches = jsonpath::cached_expression<ojson>(sElementPath)->resolve(j);
 
-            if (locations.empty())
+            if (matches.empty())
             {
                 WcaLog(LOGMSG_STANDARD, "WixJsonFile: Warning - No elements found at path '%s' in file '%ls' to delete", 
                        sElementPath.c_str(), wzFile);
             }
             else
             {
-                for (const auto& location : locations)
-                {
-                    jsonpath::remove(j, location);
-                }
+                size_t removed = matches.remove();
 
                 WcaLog(LOGMSG_STANDARD, "WixJsonFile: Successfully deleted %d element(s) at path '%s' in file '%ls'", 
-                       locations.size(), sElementPath.c_str(), wzFile);
+                       static_cast<int>(removed), sElementPath.c_str(), wzFile);
             }
 
             hr = WriteJsonOutput(wzFile, j);
@@ -21,7 +21,7 @@ HRESULT DistinctJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath
         }
 
         if (fs::exists(fs::path(wzFile))) {
-            json j;
+            ojson j;
             std::ifstream is{ fs::path(wzFile) };
 
             if (!is.is_open())
@@ -41,44 +41,41 @@ HRESULT DistinctJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath
             }
             is.close();
 
-            // Query the array using JSONPath
-            auto query = jsonpath::json_query(j, sElementPath);
-
-            if (query.empty())
-            {
-                WcaLog(LOGMSG_STANDARD, "Array not found at path: %s", sElementPath.c_str());
-                return HRESULT_FROM_WIN32(ERROR_OBJECT_NOT_FOUND);
-            }
-
-            // Validate that all matched nodes are arrays
+            // Validate that the path matches and that all matched nodes are arrays, visiting the
+            // matches in place instead of copying them into a query result
+            size_t matchCount = 0;
             bool allArrays = true;
-            if (query.is_array())
-            {
-                for (const auto& node : query.array_range())
+            auto validate = [&matchCount, &allArrays](const jsonpath::path_node& /*path*/, const ojson& node)
                 {
+                    ++matchCount;
                     if (!node.is_array())
                     {
-                        WcaLog(LOGMSG_STANDARD, "distinctValues action requires path to point to an array. Path: %s", sElementPath.c_str());
                         allArrays = false;
-                        break;
                     }
-                }
+                };
+            jsonpath::cached_expression<ojson>(sElementPath)->select(j, validate);
+
+            if (0 == matchCount)
+            {
+                WcaLog(LOGMSG_STANDARD, "Array not found at path: %s", sElementPath.c_str());
+                return HRESULT_FROM_WIN32(ERROR_OBJECT_NOT_FOUND);
             }
 
             if (!allArrays)
             {
+                WcaLog(LOGMSG_STANDARD, "distinctValues action requires path to point to an array. Path: %s", sElementPath.c_str());
                 return E_INVALIDARG;
             }
 
             WcaLog(LOGMSG_STANDARD, "Removing duplicates from array at: %s", sElementPath.c_str());
 
             // Remove duplicates from the array
-            auto f = [](const std::string& /*path*/, json& value)
+            auto f = [](const jsonpath::path_node& /*path*/, ojson& value)
                 {
                     if (value.is_array())
                     {
                         // Use a vector to track unique items
-                        std::vector<json> uniqueItems;
+                        std::vector<ojson> uniqueItems;
                         std::set<std::string> seenStrings;
 
                         for (const auto& item : value.array_range())
@@ -1,6 +1,31 @@
 #include "stdafx.h"
 #include "JsonFile.h"
 
+// createJsonPointerValue rows (with or without OnlyIfExists and ValidateSchema) are queued
+// while they target the same file, so the file is read and written once for the whole run
+// of rows rather than once per row.
+static bool IsQueuedPointerWrite(int iFlags)
+{
+    const int iAllowed = (1 << FLAG_ONLYIFEXISTS) | (1 << FLAG_VALIDATESCHEMA);
+    return (iFlags & ~iAllowed) == (1 << FLAG_CREATEVALUE);
+}
+
+static HRESULT FlushPointerWrites(const std::wstring& sFile, std::vector<JSON_POINTER_WRITE>& writes, const std::wstring& sSchemaFile)
+{
+    HRESULT hr = S_OK;
+    if (1 == writes.size())
+    {
+        hr = UpdateJsonFile(sFile.c_str(), writes[0].sElementPath.c_str(), writes[0].sValue.c_str(), writes[0].iFlags, -1, sSchemaFile.c_str());
+    }
+    else if (writes.size() > 1)
+    {
+        WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Applying %d JSON Pointer writes to '%ls' together", static_cast<int>(writes.size()), sFile.c_str());
+        hr = SetJsonPointerValues(sFile.c_str(), writes, sSchemaFile.c_str());
+    }
+    writes.clear();
+    return hr;
+}
+
 /******************************************************************
  * ExecJsonFile - entry point for JsonFile Custom Action
  *****************************************************************/
@@ -20,6 +45,10 @@ extern "C" UINT WINAPI ExecJsonFile(
     int iFlags = 0;
     int iIndex = -1;
 
+    std::vector<JSON_POINTER_WRITE> pointerWrites;
+    std::wstring sPointerFile;
+    std::wstring sPointerSchemaFile;
+
     hr = WcaInitialize(hInstall, "ExecJsonFile");
     ExitOnFailure(hr, "WixJsonFile: Failed to initialize ExecJsonFile")
 
@@ -68,10 +97,42 @@ extern "C" UINT WINAPI ExecJsonFile(
         hr = WcaReadStringFromCaData(&pwz, &sczSchemaFile);
         ExitOnFailure(hr, "WixJsonFile: Failed to get SchemaFile for WixJsonFile")
 
+        if (!pointerWrites.empty() && (!IsQueuedPointerWrite(iFlags) || sPointerFile != sczFile))
+        {
+            hr = FlushPointerWrites(sPointerFile, pointerWrites, sPointerSchemaFile);
+            ExitOnFailure(hr, "WixJsonFile: Failed while updating file '%ls'", sPointerFile.c_str())
+        }
+
+        if (IsQueuedPointerWrite(iFlags))
+        {
+            try
+            {
+                sPointerFile = sczFile;
+                sPointerSchemaFile = sczSchemaFile;
+                pointerWrites.push_back({ sczElementPath, sczValue, iFlags });
+            }
+            catch (...)
+            {
+                hr = E_OUTOFMEMORY;
+            }
+            ExitOnFailure(hr, "WixJsonFile: Failed to queue path '%ls' for file '%ls'", sczElementPath, sczFile)
+
+            // A validated row ends the run, so the file is validated in the state that row left it
+            if (iFlags & (1 << FLAG_VALIDATESCHEMA))
+            {
+                hr = FlushPointerWrites(sPointerFile, pointerWrites, sPointerSchemaFile);
+                ExitOnFailure(hr, "WixJsonFile: Failed while updating file '%ls'", sPointerFile.c_str())
+            }
+            continue;
+        }
+
         hr = UpdateJsonFile(sczFile, sczElementPath, sczValue, iFlags, iIndex, sczSchemaFile);
         ExitOnFailure(hr, "WixJsonFile: Failed while updating file '%ls' at path '%ls'", sczFile, sczElementPath)
     }
 
+    hr = FlushPointerWrites(sPointerFile, pointerWrites, sPointerSchemaFile);
+    ExitOnFailure(hr, "WixJsonFile: Failed while updating file '%ls'", sPointerFile.c_str())
+
 LExit:
     ReleaseStr(pwzCustomActionData)
     ReleaseStr(sczFile)
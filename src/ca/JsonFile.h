@@ -1,6 +1,7 @@
 #pragma once
 #include "stdafx.h"
 
+#include <functional>
 #include <vector>
 
 using namespace jsoncons;
@@ -35,6 +36,8 @@ const int FLAG_REMOVEARRAYELEMENT = 7;
 const int FLAG_VALIDATESCHEMA = 8;
 const int FLAG_DISTINCTVALUES = 9;
 const int FLAG_ONLYIFEXISTS = 10;
+const int FLAG_APPLYJSONPATCH = 11;
+const int FLAG_MERGEJSON = 12;
 
 // These are bits
 enum eXmlAction
@@ -47,7 +50,9 @@ enum eXmlAction
     jaAppendArray = 32,
     jaInsertArray = 64,
     jaRemoveArrayElement = 128,
-    jaDistinctValues = 512
+    jaDistinctValues = 512,
+    jaApplyJsonPatch = 2048,
+    jaMergeJson = 4096
     // Note: ValidateSchema (256) and OnlyIfExists (1024) are flags, not actions
 };
 
@@ -112,21 +117,61 @@ HRESULT UpdateJsonFile(
     __in_z LPCWSTR wzSchemaFile
 );
 HRESULT SetJsonPathValue(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue, bool createValue);
+// A createJsonPointerValue row. Consecutive rows for the same file are applied together by
+// SetJsonPointerValues, which reads and writes the file once.
+struct JSON_POINTER_WRITE
+{
+    std::wstring sElementPath;
+    std::wstring sValue;
+    int iFlags;
+};
+HRESULT SetJsonPointerValues(__in_z LPCWSTR wzFile, const std::vector<JSON_POINTER_WRITE>& writes, __in_z LPCWSTR wzSchemaFile);
 HRESULT SetJsonPathObject(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue);
 HRESULT DeleteJsonPath(__in_z LPCWSTR wzFile, const std::string& sElementPath);
 HRESULT AppendJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue);
 HRESULT InsertJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue, int iIndex);
 HRESULT RemoveJsonArrayElement(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue);
 HRESULT DistinctJsonArray(__in_z LPCWSTR wzFile, const std::string& sElementPath);
+HRESULT ApplyJsonPatch(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue);
+HRESULT MergeJson(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue);
 HRESULT ValidateJsonSchema(__in_z LPCWSTR wzFile, __in_z LPCWSTR wzSchemaFile);
 
 std::string GetLastErrorAsString();
 HRESULT ReturnLastError(const std::string& action);
 
-// Atomically serializes and writes a JSON document to a file (temp file + replace).
-HRESULT WriteJsonOutput(__in_z LPCWSTR wzFile, const json& j);
+// Atomically serializes and writes a JSON document to a file (temp file + replace). Documents are
+// ojson throughout, so every action writes members in the order they appear in the file.
+HRESULT WriteJsonOutput(__in_z LPCWSTR wzFile, const ojson& j);
+// Reads a document and writes its replacement in one pass; sets ec when it cannot.
+typedef std::function<void(std::istream&, json_visitor&, std::error_code&)> JSON_STREAM_TRANSFORM;
+// Streams a file through a transform into its replacement (temp file + replace); on any failure
+// the file is left untouched and S_FALSE is returned so the caller can rewrite it in memory.
+HRESULT RewriteJsonFile(__in_z LPCWSTR wzFile, const JSON_STREAM_TRANSFORM& transform, std::error_code& ec);
+// Files at least this large are streamed rather than parsed: readValue queries them while they are
+// read, and whole-file patches and merges rewrite them with RewriteJsonFile
+#define JSON_STREAM_MIN_BYTES (16 * 1024 * 1024)
+// Parses an authored value as JSON without throwing; returns false when the text is not JSON.
+bool TryParseJsonValue(const std::string& valueUtf8, ojson& value);
+// Loads a JSON document given inline as Value or as the path of a file containing it.
+HRESULT LoadJsonDocumentValue(__in_z LPCWSTR wzValue, ojson& document);
 // Converts an authored value to a typed JSON value; preserves string type when replacing a string.
-json MakeJsonValue(const std::string& valueUtf8, const json* pExisting);
+ojson MakeJsonValue(const std::string& valueUtf8, const ojson* pExisting);
+
+// An authored value materialized once per operation, in both forms a matched node can take,
+// so applying it to every JSONPath match is a type check plus a copy instead of a re-parse.
+struct JSON_AUTHORED_VALUE
+{
+    ojson typed; // parsed JSON value, or the plain string when the text is not JSON
+    ojson text;  // the authored text as a JSON string
+
+    // Selects the form that replaces pExisting; an existing string keeps its string type.
+    const ojson& For(const ojson* pExisting) const
+    {
+        return (pExisting != NULL && pExisting->is_string()) ? text : typed;
+    }
+};
+
+JSON_AUTHORED_VALUE MakeAuthoredJsonValue(const std::string& valueUtf8);
 
 inline HRESULT WideToUtf8(__in_z LPCWSTR wzInput, std::string& value)
 {
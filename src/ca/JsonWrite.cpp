@@ -7,12 +7,39 @@
 #define REPLACEFILE_IGNORE_ACL_ERRORS 0x00000004
 #endif
 
+// Swaps a fully written temporary file in for the target with ReplaceFileW (which preserves the
+// original file's attributes and ACLs). The temporary file is removed if it cannot be swapped in.
+static HRESULT ReplaceWithTempFile(__in_z LPCWSTR wzFile, const fs::path& targetPath, const fs::path& tempPath)
+{
+    if (!::ReplaceFileW(targetPath.c_str(), tempPath.c_str(), NULL,
+                        REPLACEFILE_IGNORE_MERGE_ERRORS | REPLACEFILE_IGNORE_ACL_ERRORS, NULL, NULL))
+    {
+        DWORD dwError = ::GetLastError();
+
+        // ReplaceFileW requires the target to exist; fall back to a move when it does not
+        // (or when the volume rejects the replace for another transient reason).
+        if (!::MoveFileExW(tempPath.c_str(), targetPath.c_str(),
+                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        {
+            DWORD dwMoveError = ::GetLastError();
+            WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to replace file '%ls' (replace error=%u, move error=%u)",
+                   wzFile, dwError, dwMoveError);
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return HRESULT_FROM_WIN32(dwMoveError ? dwMoveError : ERROR_WRITE_FAULT);
+        }
+    }
+
+    return S_OK;
+}
+
 // Serializes the document and atomically replaces the target file: the JSON is written to a
 // temporary file in the same directory, flushed, then swapped in with ReplaceFileW (which
 // preserves the original file's attributes and ACLs). The original file is never truncated
 // before the new content is safely on disk, so a serialization or write failure - or a crash
-// mid-write - cannot corrupt the target.
-HRESULT WriteJsonOutput(__in_z LPCWSTR wzFile, const json& j)
+// mid-write - cannot corrupt the target. Members are written in the order they are held in, as a
+// streamed rewrite writes them.
+HRESULT WriteJsonOutput(__in_z LPCWSTR wzFile, const ojson& j)
 {
     try
     {
@@ -53,56 +80,194 @@ HRESULT WriteJsonOutput(__in_z LPCWSTR wzFile, const json& j)
             }
         }
 
-        if (!::ReplaceFileW(targetPath.c_str(), tempPath.c_str(), NULL,
-                            REPLACEFILE_IGNORE_MERGE_ERRORS | REPLACEFILE_IGNORE_ACL_ERRORS, NULL, NULL))
+        return ReplaceWithTempFile(wzFile, targetPath, tempPath);
+    }
+    catch (const std::exception& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Exception while writing file '%ls': %s", wzFile, e.what());
+        return E_FAIL;
+    }
+    catch (...)
+    {
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Unknown error while writing file '%ls'", wzFile);
+        return E_FAIL;
+    }
+}
+
+// Rewrites a file in one pass without holding the document in memory: transform reads the current
+// content and writes the new content to an encoder that streams it, pretty printed as by
+// WriteJsonOutput, into a temporary file, which then replaces the file in the same way. If
+// transform reports an error, the file cannot be read or written, or an exception is thrown, the
+// temporary file is discarded, the file is left untouched and S_FALSE is returned with the reason
+// in ec, so that the caller can fall back to rewriting the file in memory.
+HRESULT RewriteJsonFile(__in_z LPCWSTR wzFile, const JSON_STREAM_TRANSFORM& transform, std::error_code& ec)
+{
+    if (NULL == wzFile || L'\0' == *wzFile)
+    {
+        return E_INVALIDARG;
+    }
+
+    fs::path tempPath;
+    try
+    {
+        fs::path targetPath(wzFile);
+        tempPath = targetPath;
+        tempPath += L".wixjson.tmp";
+
         {
-            DWORD dwError = ::GetLastError();
+            std::ifstream is{ targetPath };
+            if (!is.is_open())
+            {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to open file stream for '%ls'", wzFile);
+                ec = std::make_error_code(std::errc::io_error);
+                return S_FALSE;
+            }
 
-            // ReplaceFileW requires the target to exist; fall back to a move when it does not
-            // (or when the volume rejects the replace for another transient reason).
-            if (!::MoveFileExW(tempPath.c_str(), targetPath.c_str(),
-                               MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+            // Text mode, as in WriteJsonOutput
+            std::ofstream os(tempPath, std::ios_base::out | std::ios_base::trunc);
+            if (!os.is_open())
             {
-                DWORD dwMoveError = ::GetLastError();
-                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to replace file '%ls' (replace error=%u, move error=%u)",
-                       wzFile, dwError, dwMoveError);
-                std::error_code ec;
-                fs::remove(tempPath, ec);
-                return HRESULT_FROM_WIN32(dwMoveError ? dwMoveError : ERROR_WRITE_FAULT);
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to create temporary file for '%ls'", wzFile);
+                ec = std::make_error_code(std::errc::io_error);
+                return S_FALSE;
+            }
+
+            json_stream_encoder encoder(os);
+            transform(is, encoder, ec);
+            if (!ec)
+            {
+                encoder.flush();
+            }
+            os.close();
+            if (!ec && os.fail())
+            {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to write temporary file for '%ls'", wzFile);
+                ec = std::make_error_code(std::errc::io_error);
             }
         }
 
-        return S_OK;
+        if (!ec && FAILED(ReplaceWithTempFile(wzFile, targetPath, tempPath)))
+        {
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        if (!ec)
+        {
+            return S_OK;
+        }
     }
     catch (const std::exception& e)
     {
-        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Exception while writing file '%ls': %s", wzFile, e.what());
-        return E_FAIL;
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Exception while rewriting file '%ls': %s", wzFile, e.what());
+        ec = std::make_error_code(std::errc::io_error);
     }
     catch (...)
     {
-        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Unknown error while writing file '%ls'", wzFile);
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Unknown error while rewriting file '%ls'", wzFile);
+        ec = std::make_error_code(std::errc::io_error);
+    }
+
+    if (!tempPath.empty())
+    {
+        std::error_code removeEc;
+        fs::remove(tempPath, removeEc);
+    }
+    return S_FALSE;
+}
+
+// Parses an authored attribute value as a single JSON document. Parse errors are reported through
+// an error code rather than an exception, since plain (non-JSON) text is the common case for
+// authored values and an exception per value is needlessly expensive.
+bool TryParseJsonValue(const std::string& valueUtf8, ojson& value)
+{
+    json_decoder<ojson> decoder;
+    json_string_reader reader(valueUtf8, decoder);
+
+    std::error_code ec;
+    reader.read(ec);
+    if (ec || !decoder.is_valid())
+    {
+        return false;
+    }
+
+    value = decoder.get_result();
+    return true;
+}
+
+// Loads a JSON document authored either inline in Value or as the path of a file containing it
+// (for example [#OverlayFile]). Text that parses as JSON is taken as the document itself.
+HRESULT LoadJsonDocumentValue(__in_z LPCWSTR wzValue, ojson& document)
+{
+    if (NULL == wzValue || L'\0' == *wzValue)
+    {
+        WcaLog(LOGMSG_STANDARD, "Value must be a JSON document or the path of a file containing one");
+        return E_INVALIDARG;
+    }
+
+    std::string valueUtf8;
+    HRESULT hr = WideToUtf8(wzValue, valueUtf8);
+    if (FAILED(hr))
+    {
+        WcaLog(LOGMSG_STANDARD, "Failed to convert value to UTF-8 (hr=0x%08X)", static_cast<unsigned int>(hr));
+        return hr;
+    }
+
+    if (TryParseJsonValue(valueUtf8, document))
+    {
+        return S_OK;
+    }
+
+    if (!fs::exists(fs::path(wzValue)))
+    {
+        WcaLog(LOGMSG_STANDARD, "Value is neither a JSON document nor an existing file: %ls", wzValue);
+        return E_INVALIDARG;
+    }
+
+    std::ifstream is{ fs::path(wzValue) };
+    if (!is.is_open())
+    {
+        WcaLog(LOGMSG_STANDARD, "Failed to open file for reading: %ls", wzValue);
+        return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+    }
+
+    try {
+        is >> document;
+    }
+    catch (const std::exception& e) {
+        WcaLog(LOGMSG_STANDARD, "Failed to parse JSON file: %ls. Error: %s", wzValue, e.what());
         return E_FAIL;
     }
+    WcaLog(LOGMSG_VERBOSE, "Loaded JSON document from file: %ls", wzValue);
+    return S_OK;
 }
 
 // Parses an authored attribute value into a JSON value. Values that parse as JSON (numbers,
 // booleans, null, objects, arrays, quoted strings) become that typed value; anything else is
 // treated as a plain string. When the value replaces an existing string, the string type is
 // preserved so values like "1.0" stay strings instead of silently becoming numbers.
-json MakeJsonValue(const std::string& valueUtf8, const json* pExisting)
+ojson MakeJsonValue(const std::string& valueUtf8, const ojson* pExisting)
 {
     if (pExisting != NULL && pExisting->is_string())
     {
-        return json(valueUtf8);
+        return ojson(valueUtf8);
     }
 
-    try
+    ojson value;
+    if (!TryParseJsonValue(valueUtf8, value))
     {
-        return json::parse(valueUtf8);
+        value = ojson(valueUtf8);
     }
-    catch (const std::exception&)
+    return value;
+}
+
+// Builds both forms of an authored value up front (see JSON_AUTHORED_VALUE) so callers that apply
+// it to many matched nodes parse the text exactly once.
+JSON_AUTHORED_VALUE MakeAuthoredJsonValue(const std::string& valueUtf8)
+{
+    JSON_AUTHORED_VALUE value;
+    value.text = ojson(valueUtf8);
+    if (!TryParseJsonValue(valueUtf8, value.typed))
     {
-        return json(valueUtf8);
+        value.typed = value.text;
     }
+    return value;
 }
@@ -0,0 +1,129 @@
+#include "stdafx.h"
+#include "JsonFile.h"
+
+HRESULT MergeJson(__in_z LPCWSTR wzFile, const std::string& sElementPath, __in_z LPCWSTR wzValue)
+{
+    try
+    {
+        // Input validation
+        if (NULL == wzFile || L'\0' == *wzFile)
+        {
+            WcaLog(LOGMSG_STANDARD, "Invalid file path parameter");
+            return E_INVALIDARG;
+        }
+
+        if (sElementPath.empty())
+        {
+            WcaLog(LOGMSG_STANDARD, "Invalid element path parameter");
+            return E_INVALIDARG;
+        }
+
+        if (fs::exists(fs::path(wzFile))) {
+            // The overlay is given inline or as the path of an overlay file. The file and the overlay
+            // keep their member order, so the file is written in the same order whether the overlay
+            // is streamed or merged in memory: members stay where they are and added ones follow.
+            ojson overlay;
+            HRESULT hr = LoadJsonDocumentValue(wzValue, overlay);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            // An overlay of a whole large file is streamed from the file into its replacement
+            // rather than merged into the parsed document. If streaming fails (for instance on a
+            // malformed file) the file is left untouched and the in-memory path below reports why.
+            std::error_code sizeEc;
+            if (sElementPath == "$" && fs::file_size(fs::path(wzFile), sizeEc) >= JSON_STREAM_MIN_BYTES && !sizeEc)
+            {
+                std::error_code streamEc;
+                hr = RewriteJsonFile(wzFile, [&overlay](std::istream& input, json_visitor& output, std::error_code& ec)
+                    {
+                        mergepatch::stream_apply_merge_patch(input, overlay, output, ec);
+                    }, streamEc);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+                if (S_OK == hr)
+                {
+                    WcaLog(LOGMSG_STANDARD, "Successfully merged JSON overlay while streaming file: %ls", wzFile);
+                    return S_OK;
+                }
+                WcaLog(LOGMSG_VERBOSE, "JSON overlay was not streamed (%s); merging it in memory", streamEc.message().c_str());
+            }
+
+            ojson j;
+            std::ifstream is{ fs::path(wzFile) };
+
+            if (!is.is_open())
+            {
+                WcaLog(LOGMSG_STANDARD, "Failed to open file for reading: %ls", wzFile);
+                return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+            }
+
+            // Parse JSON with error handling
+            try {
+                is >> j;
+            }
+            catch (const std::exception& e) {
+                is.close();
+                WcaLog(LOGMSG_STANDARD, "Failed to parse JSON file: %ls. Error: %s", wzFile, e.what());
+                return E_FAIL;
+            }
+            is.close();
+
+            WcaLog(LOGMSG_STANDARD, "Merging JSON overlay at: %s", sElementPath.c_str());
+
+            if (sElementPath == "$")
+            {
+                // Merging into the whole file needs no path evaluation, and the overlay is not
+                // needed afterwards, so its values are moved into the file
+                mergepatch::apply_merge_patch(j, std::move(overlay));
+            }
+            else
+            {
+                size_t matchCount = 0;
+                auto f = [&overlay, &matchCount](const jsonpath::path_node& /*path*/, ojson& value)
+                    {
+                        ++matchCount;
+                        mergepatch::apply_merge_patch(value, overlay);
+                    };
+                jsonpath::json_replace(j, sElementPath, f);
+
+                if (0 == matchCount)
+                {
+                    WcaLog(LOGMSG_STANDARD, "Element not found at path: %s", sElementPath.c_str());
+                    return HRESULT_FROM_WIN32(ERROR_OBJECT_NOT_FOUND);
+                }
+            }
+
+            WcaLog(LOGMSG_STANDARD, "Successfully merged JSON overlay");
+
+            hr = WriteJsonOutput(wzFile, j);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+        else {
+            WcaLog(LOGMSG_STANDARD, "Unable to locate file: %ls", wzFile);
+            return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        }
+        return S_OK;
+    }
+    catch (_com_error& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "Encountered COM error: %ls", e.ErrorMessage());
+        return E_FAIL;
+    }
+    catch (std::exception& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "Encountered error %s", e.what());
+        return E_FAIL;
+    }
+    catch (...)
+    {
+        WcaLog(LOGMSG_STANDARD, "Encountered unknown error");
+        return E_FAIL;
+    }
+}
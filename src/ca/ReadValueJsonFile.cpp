@@ -1,6 +1,219 @@
 #include "stdafx.h"
 #include "JsonFile.h"
 
+// Indexing a document costs about two recursive descents, so the index is only built when at
+// least two more of the rows answered one by one reuse it after the one that builds it
+#define READVALUE_INDEX_MIN_ROWS 3
+
+// Each row answered on its own stops at its first match, which a walk answering several rows at
+// once cannot do, so the walk only pays off once this many rows would each search the document
+#define READVALUE_WALK_MIN_ROWS 5
+
+// The answer to one readValue row, computed together with the other rows that read the same file
+struct ReadValueAnswer
+{
+    bool found = false;
+    std::string value;  // UTF-8
+    std::string error;  // why the query failed, if it did
+};
+
+static bool IsReadValueRow(const JSON_FILE_CHANGE* pxfc)
+{
+    if (!WcaIsInstalling(pxfc->isInstalled, pxfc->isAction))
+    {
+        return false;
+    }
+    std::bitset<32> flags(pxfc->iJsonFlags);
+    return flags.test(FLAG_READVALUE) &&
+        !flags.test(FLAG_DELETEVALUE) &&
+        !flags.test(FLAG_SETVALUE) &&
+        !flags.test(FLAG_REPLACEJSONVALUE) &&
+        !flags.test(FLAG_CREATEVALUE);
+}
+
+// Records the first match of each row's path as its answer
+static void SetReadValueAnswers(const std::vector<const JSON_FILE_CHANGE*>& rows,
+    std::vector<jsonpath::value_or_pointer<ojson, const ojson&>>&& matches,
+    std::map<const JSON_FILE_CHANGE*, ReadValueAnswer>& answers)
+{
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        ReadValueAnswer& answer = answers[rows[i]];
+        if (NULL != matches[i].ptr())
+        {
+            try
+            {
+                answer.value = matches[i].value().as<std::string>();
+                answer.found = true;
+            }
+            catch (const std::exception& e)
+            {
+                answer.error = e.what();
+            }
+        }
+    }
+}
+
+// Looks up the first match of each row's expression in fileJson. pIndex, if not null, serves the
+// expressions that descend to a member name, e.g. $..name.
+static void FindFirstMatches(const std::vector<const JSON_FILE_CHANGE*>& rows,
+    const std::vector<std::shared_ptr<const jsonpath::jsonpath_expression<ojson>>>& exprs,
+    const ojson& fileJson, jsonpath::key_index<ojson>* pIndex,
+    std::map<const JSON_FILE_CHANGE*, ReadValueAnswer>& answers)
+{
+    std::vector<const JSON_FILE_CHANGE*> answered;
+    std::vector<jsonpath::value_or_pointer<ojson, const ojson&>> matches;
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        try
+        {
+            matches.push_back(pIndex && exprs[i]->uses_key_index() ? exprs[i]->first(fileJson, *pIndex) : exprs[i]->first(fileJson));
+            answered.push_back(rows[i]);
+        }
+        catch (const std::exception& e)
+        {
+            answers[rows[i]].error = e.what();
+        }
+    }
+
+    SetReadValueAnswers(answered, std::move(matches), answers);
+}
+
+// Answers pxfcFirst and every later readValue row for the same file from fileJson, which is
+// parsed once for all of them. When enough rows search the document (wildcards, slices, $..name),
+// the rows whose paths one walk can evaluate are answered together by a single walk over fileJson;
+// the others (filters, unions, negative indices and the like) are answered row by row. Rows whose
+// path cannot be converted are left to the caller.
+static void AnswerReadValueRows(const JSON_FILE_CHANGE* pxfcFirst, const ojson& fileJson,
+    std::map<const JSON_FILE_CHANGE*, ReadValueAnswer>& answers)
+{
+    jsonpath::stream_query<ojson> query;
+    std::vector<const JSON_FILE_CHANGE*> walked;
+    std::vector<std::shared_ptr<const jsonpath::jsonpath_expression<ojson>>> walkedExprs;
+    size_t cSearching = 0;
+    std::vector<const JSON_FILE_CHANGE*> rows;
+    std::vector<std::shared_ptr<const jsonpath::jsonpath_expression<ojson>>> exprs;
+    size_t cIndexed = 0;
+    for (const JSON_FILE_CHANGE* pxfc = pxfcFirst; pxfc; pxfc = pxfc->pxfcNext)
+    {
+        if (!IsReadValueRow(pxfc) || 0 != wcscmp(pxfc->wzFile, pxfcFirst->wzFile))
+        {
+            continue;
+        }
+        std::string elementPath;
+        if (FAILED(WideToUtf8(pxfc->pwzElementPath, elementPath)))
+        {
+            continue;
+        }
+        try
+        {
+            auto expr = jsonpath::cached_expression<ojson>(elementPath);
+            if (query.npos != query.add(expr))
+            {
+                if (!query.singular(query.size() - 1))
+                {
+                    ++cSearching;
+                }
+                walked.push_back(pxfc);
+                walkedExprs.push_back(std::move(expr));
+                continue;
+            }
+            if (expr->uses_key_index())
+            {
+                ++cIndexed;
+            }
+            rows.push_back(pxfc);
+            exprs.push_back(std::move(expr));
+        }
+        catch (const std::exception& e)
+        {
+            answers[pxfc].error = e.what();
+        }
+    }
+
+    if (cSearching >= READVALUE_WALK_MIN_ROWS)
+    {
+        SetReadValueAnswers(walked, query.first(fileJson), answers);
+    }
+    else
+    {
+        for (size_t i = 0; i < walked.size(); ++i)
+        {
+            if (walkedExprs[i]->uses_key_index())
+            {
+                ++cIndexed;
+            }
+            rows.push_back(walked[i]);
+            exprs.push_back(std::move(walkedExprs[i]));
+        }
+    }
+
+    if (cIndexed >= READVALUE_INDEX_MIN_ROWS)
+    {
+        jsonpath::key_index<ojson> index(fileJson);
+        FindFirstMatches(rows, exprs, fileJson, &index, answers);
+    }
+    else
+    {
+        FindFirstMatches(rows, exprs, fileJson, NULL, answers);
+    }
+}
+
+// As AnswerReadValueRows, but for a large file whose paths can all be evaluated while the file is
+// read, so that only the matched values are held in memory. The rest of the file is still read,
+// so a malformed file fails here as it would when parsed. Returns false, answering nothing, if
+// the file is small or a path needs the parsed document.
+static bool StreamReadValueRows(const JSON_FILE_CHANGE* pxfcFirst,
+    std::map<const JSON_FILE_CHANGE*, ReadValueAnswer>& answers)
+{
+    std::error_code ec;
+    if (fs::file_size(fs::path(pxfcFirst->wzFile), ec) < JSON_STREAM_MIN_BYTES || ec)
+    {
+        return false;
+    }
+
+    jsonpath::stream_query<ojson> query;
+    std::vector<const JSON_FILE_CHANGE*> rows;
+    std::map<const JSON_FILE_CHANGE*, ReadValueAnswer> errors;
+    for (const JSON_FILE_CHANGE* pxfc = pxfcFirst; pxfc; pxfc = pxfc->pxfcNext)
+    {
+        if (!IsReadValueRow(pxfc) || 0 != wcscmp(pxfc->wzFile, pxfcFirst->wzFile))
+        {
+            continue;
+        }
+        std::string elementPath;
+        if (FAILED(WideToUtf8(pxfc->pwzElementPath, elementPath)))
+        {
+            continue;
+        }
+        try
+        {
+            if (query.npos == query.add(elementPath))
+            {
+                return false;
+            }
+            rows.push_back(pxfc);
+        }
+        catch (const std::exception& e)
+        {
+            errors[pxfc].error = e.what();
+        }
+    }
+
+    std::ifstream is{ fs::path(pxfcFirst->wzFile) };
+    jsoncons::json_stream_cursor cursor(is);
+    auto matches = query.first(cursor);
+    while (!cursor.done())
+    {
+        cursor.next();
+    }
+    cursor.check_done();
+
+    answers.insert(errors.begin(), errors.end());
+    SetReadValueAnswers(rows, std::move(matches), answers);
+    return true;
+}
+
 /******************************************************************
  * ReadValueJsonFile - entry point for JsonFile Custom Action
  *****************************************************************/
@@ -22,6 +235,9 @@ extern "C" UINT WINAPI ReadValueJsonFile(
 
     DWORD cFiles = 0;
 
+    // The readValue rows for a file are answered together when the first of them is reached
+    std::map<const JSON_FILE_CHANGE*, ReadValueAnswer> answers;
+
     // initialize
     hr = WcaInitialize(hInstall, "ReadValueJsonFile");
     ExitOnFailure(hr, "failed to initialize")
@@ -59,12 +275,6 @@ extern "C" UINT WINAPI ReadValueJsonFile(
                 {
                     try
                     {
-                        std::ifstream is{ fs::path(pxfc->wzFile) };
-                        auto fileJson = jsoncons::json::parse(is);
-                        is.close();
-
-                        WcaLog(LOGMSG_STANDARD, "Parsed File");
-
                         std::string elementPath;
                         HRESULT hrPath = WideToUtf8(pxfc->pwzElementPath, elementPath);
                         if (FAILED(hrPath))
@@ -75,25 +285,44 @@ extern "C" UINT WINAPI ReadValueJsonFile(
                         }
                         else
                         {
-                            jsoncons::json result = jsonpath::json_query(fileJson, elementPath);
+                            auto answer = answers.find(pxfc);
+                            if (answer == answers.end())
+                            {
+                                if (StreamReadValueRows(pxfc, answers))
+                                {
+                                    WcaLog(LOGMSG_STANDARD, "Queried file while reading it");
+                                }
+                                else
+                                {
+                                    std::ifstream is{ fs::path(pxfc->wzFile) };
+                                    auto fileJson = ojson::parse(is);
+                                    is.close();
+
+                                    WcaLog(LOGMSG_STANDARD, "Parsed File");
+
+                                    AnswerReadValueRows(pxfc, fileJson, answers);
+                                }
+                                answer = answers.find(pxfc);
+                            }
 
                             WcaLog(LOGMSG_STANDARD, "Completed query of json file");
 
-                            if (result.empty()) {
+                            if (!answer->second.error.empty()) {
+                                WcaLog(LOGMSG_STANDARD, "Failed to read value for property %ls: %s. Setting default.",
+                                    pxfc->pwzProperty, answer->second.error.c_str());
+                                WcaSetProperty(pxfc->pwzProperty, pxfc->pwzDefaultValue);
+                            }
+                            else if (!answer->second.found) {
                                 WcaLog(LOGMSG_STANDARD, "No results found for %s, setting default", elementPath.c_str());
                                 WcaSetProperty(pxfc->pwzProperty, pxfc->pwzDefaultValue);
                             }
                             else {
-                                WcaLog(LOGMSG_STANDARD, "Found %d results for %s", static_cast<int>(result.size()), elementPath.c_str());
-
-                                // json_query returns an array of matches; use the first match.
-                                jsoncons::json match = (result.is_array() && !result.empty()) ? result.at(0) : result;
-                                std::string valueUtf8 = match.as<std::string>();
+                                WcaLog(LOGMSG_STANDARD, "Found a result for %s", elementPath.c_str());
 
                                 // jsoncons stores strings as UTF-8; convert back to UTF-16 so the MSI
                                 // property preserves non-ASCII characters (CA2W would assume ANSI).
                                 std::wstring wideValue;
-                                HRESULT hrValue = Utf8ToWide(valueUtf8.c_str(), wideValue);
+                                HRESULT hrValue = Utf8ToWide(answer->second.value.c_str(), wideValue);
                                 if (SUCCEEDED(hrValue))
                                 {
                                     WcaSetProperty(pxfc->pwzProperty, wideValue.c_str());
@@ -21,7 +21,7 @@ HRESULT RemoveJsonArrayElement(__in_z LPCWSTR wzFile, const std::string& sElemen
         HRESULT hr = S_OK;
 
         if (fs::exists(fs::path(wzFile))) {
-            json j;
+            ojson j;
             std::ifstream is{ fs::path(wzFile) };
 
             if (!is.is_open())
@@ -47,18 +47,11 @@ HRESULT RemoveJsonArrayElement(__in_z LPCWSTR wzFile, const std::string& sElemen
                     return hr;
                 }
 
-                // Parse the value to match
-                json valueToMatch;
-                try {
-                    valueToMatch = json::parse(valueUtf8);
-                }
-                catch (const std::exception&) {
-                    // If parsing fails, treat as a string value
-                    valueToMatch = json(valueUtf8);
-                }
+                // Parse the value to match (plain text that is not JSON becomes a string value)
+                ojson valueToMatch = MakeJsonValue(valueUtf8, NULL);
 
                 // Find and remove matching elements
-                auto f = [valueToMatch](const std::string& /*path*/, json& value)
+                auto f = [&valueToMatch](const jsonpath::path_node& /*path*/, ojson& value)
                     {
                         if (value.is_array())
                         {
@@ -86,19 +79,12 @@ HRESULT RemoveJsonArrayElement(__in_z LPCWSTR wzFile, const std::string& sElemen
                     arrayPath = arrayPath.substr(0, filterPos);
                 }
 
-                jsonpath::json_replace(j, arrayPath, f);
+                jsonpath::cached_expression<ojson>(arrayPath)->resolve(j).update(f);
             }
             else
             {
                 // Remove elements directly using the path (with filters or indices)
-                auto expr = jsonpath::make_expression<json>(sElementPath);
-                std::vector<jsonpath::json_location> locations = expr.select_paths(j,
-                    jsonpath::result_options::sort_descending);
-
-                for (const auto& location : locations)
-                {
-                    jsonpath::remove(j, location);
-                }
+                jsonpath::cached_expression<ojson>(sElementPath)->resolve(j).remove();
             }
 
             WcaLog(LOGMSG_STANDARD, "Successfully removed elements from array");
@@ -88,7 +88,8 @@ extern "C" UINT __stdcall SchedJsonFile(
             // Skip entries that don't carry a deferred write action.
             if (!(flags.test(FLAG_DELETEVALUE) || flags.test(FLAG_SETVALUE) || flags.test(FLAG_REPLACEJSONVALUE) ||
                   flags.test(FLAG_CREATEVALUE) || flags.test(FLAG_APPENDARRAY) || flags.test(FLAG_INSERTARRAY) ||
-                  flags.test(FLAG_REMOVEARRAYELEMENT) || flags.test(FLAG_DISTINCTVALUES)))
+                  flags.test(FLAG_REMOVEARRAYELEMENT) || flags.test(FLAG_DISTINCTVALUES) || flags.test(FLAG_APPLYJSONPATCH) ||
+                  flags.test(FLAG_MERGEJSON)))
             {
                 WcaLog(LOGMSG_VERBOSE, "Unknown or no action flag set, skipping entry for file: %ls", pxfc->wzFile);
                 continue;
@@ -36,7 +36,7 @@ HRESULT SetJsonPathObject(__in_z LPCWSTR wzFile, const std::string& sElementPath
         }
 
         if (fs::exists(fs::path(wzFile))) {
-            json j;
+            ojson j;
             SetLastError(0);
             std::ifstream is{ fs::path(wzFile) };
 
@@ -50,9 +50,9 @@ HRESULT SetJsonPathObject(__in_z LPCWSTR wzFile, const std::string& sElementPath
             is >> j;
             is.close();
 
-            json obj;
+            ojson obj;
             try {
-                obj = json::parse(valueUtf8);
+                obj = ojson::parse(valueUtf8);
                 WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Parsed replacement JSON value for path '%s'", sElementPath.c_str());
             }
             catch (const std::exception& e) {
@@ -61,24 +61,21 @@ HRESULT SetJsonPathObject(__in_z LPCWSTR wzFile, const std::string& sElementPath
                 return E_FAIL;
             }
 
-            auto query = jsonpath::json_query(j, sElementPath);
-
-            if (query.empty())
+            auto matches = jsonpath::cached_expression<ojson>(sElementPath)->resolve(j);
+            if (matches.empty())
             {
                 WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - No elements found at path '%s' in file '%ls' to replace", 
                        sElementPath.c_str(), wzFile);
                 return HRESULT_FROM_WIN32(ERROR_OBJECT_NOT_FOUND);
             }
 
-            WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Found %d element(s) at path '%s' in file '%ls' to replace", 
-                   query.size(), sElementPath.c_str(), wzFile);
-
-            auto f = [obj](const std::string& /*path*/, json& value)
+            matches.update([&obj](const jsonpath::path_node& /*path*/, ojson& value)
                 {
                     value = obj;
-                };
+                });
 
-            jsonpath::json_replace(j, sElementPath, f);
+            WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Replaced %d element(s) at path '%s' in file '%ls'", 
+                   static_cast<int>(matches.size()), sElementPath.c_str(), wzFile);
 
             WcaLog(LOGMSG_STANDARD, "WixJsonFile: Successfully replaced JSON object at path '%s' in file '%ls'", 
                    sElementPath.c_str(), wzFile);
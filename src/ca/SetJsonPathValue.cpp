@@ -48,27 +48,32 @@ HRESULT SetJsonPathValue(__in_z LPCWSTR wzFile, const std::string& sElementPath,
 
             WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Opened file '%ls'", wzFile);
 
-            json j = json::parse(is);
+            ojson j = ojson::parse(is);
             is.close();
             WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Successfully parsed JSON file '%ls'", wzFile);
 
             if (createValue) {
                 std::error_code ec;
 
-                // Preserve the string type when overwriting an existing string value; otherwise
-                // parse the authored value so numbers/booleans/objects become typed JSON.
-                const json* pExisting = NULL;
-                std::error_code ecGet;
-                const json& existing = jsonpointer::get(j, sElementPath, ecGet);
-                if (!ecGet)
+                // The pointer is compiled once and used for both the lookup and the add
+                jsonpointer::compiled_json_pointer location = jsonpointer::compiled_json_pointer::compile(sElementPath, ec);
+                if (!ec)
                 {
-                    pExisting = &existing;
-                }
+                    // Preserve the string type when overwriting an existing string value; otherwise
+                    // parse the authored value so numbers/booleans/objects become typed JSON.
+                    const ojson* pExisting = NULL;
+                    std::error_code ecGet;
+                    const ojson& existing = jsonpointer::get(j, location, ecGet);
+                    if (!ecGet)
+                    {
+                        pExisting = &existing;
+                    }
 
-                // jsonpointer::add sets the value whether or not the path exists (insert_or_assign),
-                // with create_if_missing=true so intermediate objects are created, allowing a nested
-                // pointer (e.g. /Application/Name) to be built from an empty/partial document.
-                jsonpointer::add(j, sElementPath, MakeJsonValue(valueUtf8, pExisting), true, ec);
+                    // jsonpointer::add sets the value whether or not the path exists (insert_or_assign),
+                    // with create_if_missing=true so intermediate objects are created, allowing a nested
+                    // pointer (e.g. /Application/Name) to be built from an empty/partial document.
+                    jsonpointer::add(j, location, MakeJsonValue(valueUtf8, pExisting), true, ec);
+                }
 
                 if (ec) {
                     WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - JSONPointer add failed for path '%s' in file '%ls': %s",
@@ -85,20 +90,21 @@ HRESULT SetJsonPathValue(__in_z LPCWSTR wzFile, const std::string& sElementPath,
             }
             else {
 
-                json query = jsonpath::json_query(j, sElementPath);
-
-                WcaLog(LOGMSG_VERBOSE, "WixJsonFile: JSONPath query '%s' found %d element(s) in file '%ls'",
-                       sElementPath.c_str(), query.size(), wzFile);
-
-                if (!query.empty()) {
+                // Resolve the matches once; the same locations are then updated in place
+                // without evaluating the expression a second time.
+                auto matches = jsonpath::cached_expression<ojson>(sElementPath)->resolve(j);
+                if (!matches.empty()) {
                     // Type-preserving update: existing string values stay strings; anything else
                     // takes the parsed (typed) form of the authored value with string fallback.
-                    auto f = [valueUtf8](const std::string& /*path*/, json& value)
+                    // The value is parsed once here, not once per matched node.
+                    const JSON_AUTHORED_VALUE authored = MakeAuthoredJsonValue(valueUtf8);
+                    matches.update([&authored](const jsonpath::path_node& /*path*/, ojson& value)
                         {
-                            value = MakeJsonValue(valueUtf8, &value);
-                        };
+                            value = authored.For(&value);
+                        });
 
-                    jsonpath::json_replace(j, sElementPath, f);
+                    WcaLog(LOGMSG_VERBOSE, "WixJsonFile: JSONPath query '%s' matched %d element(s) in file '%ls'",
+                           sElementPath.c_str(), static_cast<int>(matches.size()), wzFile);
 
                     WcaLog(LOGMSG_STANDARD, "WixJsonFile: Successfully updated path '%s' in file '%ls' with value '%s'",
                            sElementPath.c_str(), wzFile, valueUtf8.c_str());
@@ -139,3 +145,136 @@ HRESULT SetJsonPathValue(__in_z LPCWSTR wzFile, const std::string& sElementPath,
         return E_FAIL;
     }
 }
+
+HRESULT SetJsonPointerValues(__in_z LPCWSTR wzFile, const std::vector<JSON_POINTER_WRITE>& writes, __in_z LPCWSTR wzSchemaFile)
+{
+    try
+    {
+        // Input validation
+        if (NULL == wzFile || L'\0' == *wzFile)
+        {
+            WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Invalid file path parameter");
+            return E_INVALIDARG;
+        }
+
+        HRESULT hr = S_OK;
+
+        // Without a file there is nothing to share between the writes; each one reports the
+        // missing file (or is skipped by OnlyIfExists) exactly as it would on its own.
+        if (!fs::exists(fs::path(wzFile)))
+        {
+            for (const JSON_POINTER_WRITE& write : writes)
+            {
+                hr = UpdateJsonFile(wzFile, write.sElementPath.c_str(), write.sValue.c_str(), write.iFlags, -1, wzSchemaFile);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+            }
+            return S_OK;
+        }
+
+        std::ifstream is{ fs::path(wzFile) };
+        if (!is.is_open())
+        {
+            WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to open file stream for '%ls'", wzFile);
+            return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+        }
+        ojson j = ojson::parse(is);
+        is.close();
+        WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Successfully parsed JSON file '%ls' for %d JSON Pointer writes", wzFile, static_cast<int>(writes.size()));
+
+        // Each write sees the document as left by the previous ones, as if each row had been
+        // applied to the file in turn. Consecutive pointers usually share a deep prefix, which
+        // the resolver walks once.
+        jsonpointer::prefix_resolver<ojson> resolver(j);
+        bool written = false;
+        bool lastSkipped = false;
+        for (const JSON_POINTER_WRITE& write : writes)
+        {
+            if (write.sElementPath.empty())
+            {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Invalid element path parameter for file '%ls'", wzFile);
+                return E_INVALIDARG;
+            }
+
+            std::string elementPath;
+            hr = WideToUtf8(write.sElementPath.c_str(), elementPath);
+            if (FAILED(hr))
+            {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to convert element path '%ls' to UTF-8 for file '%ls' (hr=0x%08X)", write.sElementPath.c_str(), wzFile, static_cast<unsigned int>(hr));
+                return hr;
+            }
+
+            std::error_code ec;
+            jsonpointer::compiled_json_pointer location = jsonpointer::compiled_json_pointer::compile(elementPath, ec);
+            ojson* pExisting = ec ? NULL : resolver.find(location);
+
+            lastSkipped = (write.iFlags & (1 << FLAG_ONLYIFEXISTS)) && NULL == pExisting;
+            if (lastSkipped)
+            {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Skipping operation - path does not exist and OnlyIfExists=yes: '%ls'", write.sElementPath.c_str());
+                continue;
+            }
+
+            std::string valueUtf8;
+            hr = WideToUtf8(write.sValue.c_str(), valueUtf8);
+            if (FAILED(hr))
+            {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Failed to convert value to UTF-8 for path '%s' in file '%ls' (hr=0x%08X)", elementPath.c_str(), wzFile, static_cast<unsigned int>(hr));
+                return hr;
+            }
+
+            if (!ec)
+            {
+                resolver.add(location, MakeJsonValue(valueUtf8, pExisting), true, ec);
+            }
+            if (ec) {
+                WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - JSONPointer add failed for path '%s' in file '%ls': %s",
+                       elementPath.c_str(), wzFile, ec.message().c_str());
+                return E_FAIL;
+            }
+            written = true;
+            WcaLog(LOGMSG_VERBOSE, "WixJsonFile: Successfully set path '%s' in file '%ls'", elementPath.c_str(), wzFile);
+        }
+
+        if (written)
+        {
+            hr = WriteJsonOutput(wzFile, j);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+
+        // Only the last write of a batch can ask for validation, and as for a single row it is
+        // not validated when OnlyIfExists skipped it
+        if (!writes.empty() && !lastSkipped && (writes.back().iFlags & (1 << FLAG_VALIDATESCHEMA)) &&
+            wzSchemaFile != NULL && L'\0' != *wzSchemaFile)
+        {
+            WcaLog(LOGMSG_VERBOSE, "Validating JSON against schema: %ls", wzSchemaFile);
+            hr = ValidateJsonSchema(wzFile, wzSchemaFile);
+            if (FAILED(hr))
+            {
+                WcaLog(LOGMSG_STANDARD, "Schema validation failed");
+                return hr;
+            }
+        }
+        return S_OK;
+    }
+    catch (_com_error& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Encountered COM error while processing file '%ls': %ls", wzFile, e.ErrorMessage());
+        return E_FAIL;
+    }
+    catch (std::exception& e)
+    {
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Encountered exception while processing file '%ls': %s", wzFile, e.what());
+        return E_FAIL;
+    }
+    catch (...)
+    {
+        WcaLog(LOGMSG_STANDARD, "WixJsonFile: Error - Encountered unknown error while processing file '%ls'", wzFile);
+        return E_FAIL;
+    }
+}
@@ -37,7 +37,8 @@ HRESULT UpdateJsonFile(
     // already exists. createJsonPointerValue uses JSON Pointer syntax; all other actions use JSONPath.
     bool isWriteAction = flags.test(FLAG_SETVALUE) || flags.test(FLAG_CREATEVALUE) || flags.test(FLAG_REPLACEJSONVALUE) ||
                          flags.test(FLAG_DELETEVALUE) || flags.test(FLAG_APPENDARRAY) || flags.test(FLAG_INSERTARRAY) ||
-                         flags.test(FLAG_REMOVEARRAYELEMENT) || flags.test(FLAG_DISTINCTVALUES);
+                         flags.test(FLAG_REMOVEARRAYELEMENT) || flags.test(FLAG_DISTINCTVALUES) ||
+                         flags.test(FLAG_APPLYJSONPATCH) || flags.test(FLAG_MERGEJSON);
 
     // Check if file exists before attempting to parse
     if (!fs::exists(fs::path(wzFile)))
@@ -106,11 +107,16 @@ HRESULT UpdateJsonFile(
 
     WcaLog(LOGMSG_VERBOSE, "Element path: %ls", wzElementPath);
 
-    if (onlyIfExists && isWriteAction)
+    // The root of a file that parses always exists, and every action parses or streams the file
+    // and fails if it is malformed, so the root needs no check. This keeps a streamed patch or
+    // merge of a large file from parsing it first.
+    bool isRootPath = !flags.test(FLAG_CREATEVALUE) && elementPath == "$";
+
+    if (onlyIfExists && isWriteAction && !isRootPath)
     {
         try
         {
-            json j;
+            ojson j;
             std::ifstream is{ fs::path(wzFile) };
             if (is.is_open())
             {
@@ -132,7 +138,7 @@ HRESULT UpdateJsonFile(
                 }
                 else
                 {
-                    pathExists = !jsonpath::json_query(j, elementPath).empty();
+                    pathExists = jsonpath::cached_expression<ojson>(elementPath)->exists(j);
                 }
 
                 if (!pathExists)
@@ -188,6 +194,14 @@ HRESULT UpdateJsonFile(
         WcaLog(LOGMSG_VERBOSE, "Removing duplicates from JSON array");
         hr = DistinctJsonArray(wzFile, elementPath);
     }
+    else if (flags.test(FLAG_APPLYJSONPATCH)) {
+        WcaLog(LOGMSG_VERBOSE, "Applying JSON Patch");
+        hr = ApplyJsonPatch(wzFile, elementPath, wzValue);
+    }
+    else if (flags.test(FLAG_MERGEJSON)) {
+        WcaLog(LOGMSG_VERBOSE, "Merging JSON overlay");
+        hr = MergeJson(wzFile, elementPath, wzValue);
+    }
 
     // Validate against schema if specified and if the operation succeeded
     if (SUCCEEDED(hr) && flags.test(FLAG_VALIDATESCHEMA) && wzSchemaFile != NULL && L'\0' != *wzSchemaFile)
@@ -0,0 +1,70 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_DETAIL_FLATTENED_OBJECT_HPP
+#define JSONCONS_DETAIL_FLATTENED_OBJECT_HPP
+
+#include <algorithm> // std::sort, std::is_sorted
+#include <iterator> // std::make_move_iterator
+#include <type_traits>
+#include <utility> // std::move, std::pair
+#include <vector>
+
+#include <jsoncons/json_object.hpp>
+
+namespace jsoncons {
+namespace detail {
+
+    // The members of a flattened document (jsonpointer::flatten, jsonpath::flatten). Their keys
+    // are distinct by construction, so the result is built from all of them at once instead of
+    // being searched for each one.
+    template <typename Json,typename KeyT = typename Json::string_type>
+    using flattened_members = std::vector<std::pair<KeyT,Json>>;
+
+    // True if Object keeps its members in insertion order
+    template <typename Object>
+    struct is_order_preserving_object : std::false_type {};
+
+    template <typename KeyT,typename Json,template <typename,typename> class SequenceContainer>
+    struct is_order_preserving_object<order_preserving_json_object<KeyT,Json,SequenceContainer>> : std::true_type {};
+
+    // A sorted object takes the members in key order, so each one is appended. Members of
+    // objects are often flattened in that order already.
+    template <typename Json,typename KeyT>
+    void make_flattened_object(flattened_members<Json,KeyT>& members, Json& result, std::false_type)
+    {
+        using member_type = typename flattened_members<Json,KeyT>::value_type;
+
+        auto less = [](const member_type& a, const member_type& b) {return a.first < b.first;};
+        if (!std::is_sorted(members.begin(), members.end(), less))
+        {
+            std::sort(members.begin(), members.end(), less);
+        }
+        result.reserve(members.size());
+        for (auto& member : members)
+        {
+            result.try_emplace(member.first, std::move(member.second));
+        }
+    }
+
+    // An order preserving object keeps the members in the order they were flattened in
+    template <typename Json,typename KeyT>
+    void make_flattened_object(flattened_members<Json,KeyT>& members, Json& result, std::true_type)
+    {
+        result.insert(sorted_unique_range_tag(), std::make_move_iterator(members.begin()), std::make_move_iterator(members.end()));
+    }
+
+    // Builds result, an object, from members, choosing by how Json stores its objects
+    template <typename Json,typename KeyT>
+    void make_flattened_object(flattened_members<Json,KeyT>& members, Json& result)
+    {
+        make_flattened_object(members, result, is_order_preserving_object<typename Json::object>());
+    }
+
+} // namespace detail
+} // namespace jsoncons
+
+#endif // JSONCONS_DETAIL_FLATTENED_OBJECT_HPP
@@ -0,0 +1,1449 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_UTILITY_REGEX_HPP
+#define JSONCONS_UTILITY_REGEX_HPP
+
+#include <jsoncons/config/compiler_support.hpp>
+
+#if defined(JSONCONS_HAS_STD_REGEX)
+
+#include <algorithm> // std::search
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <utility> // std::move
+#include <vector>
+
+#include <jsoncons/config/jsoncons_config.hpp>
+
+namespace jsoncons {
+namespace utility {
+
+    // An ECMAScript regular expression for the searches made by JSONPath (=~ and tokenize) and
+    // JSON Schema (pattern and patternProperties). Patterns made of literals, ., character classes,
+    // the \d \w \s escapes, groups, alternation, greedy and lazy quantifiers and the ^ $ \b \B
+    // assertions are compiled to an automaton and searched in time linear in the length of the
+    // input. Any other pattern (back references, lookaround and the like) is handed to
+    // std::basic_regex, which also reports invalid patterns by throwing std::regex_error.
+    //
+    // search() runs a deterministic automaton built from the program when the pattern has no
+    // \b or \B and the automaton stays small; otherwise, and for split(), the program is run as a
+    // Pike VM, which keeps all threads in step so that no input position is visited twice.
+    template <typename CharT>
+    class basic_regex_matcher
+    {
+    public:
+        using char_type = CharT;
+        using string_view_type = jsoncons::basic_string_view<CharT>;
+    private:
+        using code_point = uint32_t;
+
+        enum class opcode : uint8_t
+        {
+            character,
+            any,
+            char_class,
+            split,
+            jump,
+            assert_begin,
+            assert_end,
+            word_boundary,
+            not_word_boundary,
+            match
+        };
+
+        struct instruction
+        {
+            opcode op;
+            code_point c;     // character, or index of a char_class
+            std::size_t x;    // jump target, or preferred split target
+            std::size_t y;    // other split target
+        };
+
+        struct char_class
+        {
+            bool bits[256];
+            std::vector<std::pair<code_point,code_point>> ranges; // code points above 255
+            bool negated;
+
+            char_class()
+                : bits(), negated(false)
+            {
+            }
+
+            void add(code_point first, code_point last, bool icase)
+            {
+                for (code_point c = first; c <= last && c < 256; ++c)
+                {
+                    bits[c] = true;
+                    if (icase)
+                    {
+                        bits[to_lower(c)] = true;
+                        bits[to_upper(c)] = true;
+                    }
+                }
+                if (last >= 256)
+                {
+                    ranges.emplace_back(first < 256 ? 256 : first, last);
+                }
+            }
+
+            bool contains(code_point c) const
+            {
+                bool found = false;
+                if (c < 256)
+                {
+                    found = bits[c];
+                }
+                else
+                {
+                    for (const auto& r : ranges)
+                    {
+                        if (c >= r.first && c <= r.second)
+                        {
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+                return found != negated;
+            }
+        };
+
+        // Parse tree of a supported pattern
+        enum class node_kind : uint8_t {empty, character, any, char_class, assertion, concat, alternation, repeat};
+
+        struct node
+        {
+            node_kind kind;
+            opcode assertion;
+            code_point c;
+            std::size_t min_count;
+            std::size_t max_count; // unbounded_repeat for no upper bound
+            bool greedy;
+            std::vector<node> children;
+
+            explicit node(node_kind kind)
+                : kind(kind), assertion(opcode::match), c(0), min_count(0), max_count(0), greedy(true)
+            {
+            }
+        };
+
+        static constexpr std::size_t unbounded_repeat = static_cast<std::size_t>(-1);
+        // Counted repetition is expanded, so an automaton is only built up to this size
+        static constexpr std::size_t max_program_size = 10000;
+        static constexpr code_point max_code_point = static_cast<code_point>(-1);
+        // The deterministic automaton is only built for programs up to this size, and given up
+        // once its transition table would grow past max_dfa_entries
+        static constexpr std::size_t max_dfa_program_size = 1000;
+        static constexpr std::size_t max_dfa_entries = 1 << 16;
+        static constexpr uint8_t accepts_here = 1;
+        static constexpr uint8_t accepts_at_end = 2;
+
+        // Parses the supported subset of ECMAScript pattern syntax. Anything outside it, including
+        // syntax errors, makes the parser give up and leave the pattern to std::basic_regex.
+        class parser
+        {
+            const CharT* p_;
+            const CharT* end_;
+            bool icase_;
+            std::vector<char_class>& classes_;
+        public:
+            parser(const CharT* first, const CharT* last, bool icase, std::vector<char_class>& classes)
+                : p_(first), end_(last), icase_(icase), classes_(classes)
+            {
+            }
+
+            bool parse(node& result)
+            {
+                return parse_disjunction(result) && p_ == end_;
+            }
+        private:
+            bool parse_disjunction(node& result)
+            {
+                node alt(node_kind::alternation);
+                alt.children.emplace_back(node_kind::concat);
+                if (!parse_alternative(alt.children.back()))
+                {
+                    return false;
+                }
+                while (p_ != end_ && *p_ == '|')
+                {
+                    ++p_;
+                    alt.children.emplace_back(node_kind::concat);
+                    if (!parse_alternative(alt.children.back()))
+                    {
+                        return false;
+                    }
+                }
+                if (alt.children.size() == 1)
+                {
+                    result = std::move(alt.children.front());
+                }
+                else
+                {
+                    result = std::move(alt);
+                }
+                return true;
+            }
+
+            bool parse_alternative(node& seq)
+            {
+                while (p_ != end_ && *p_ != '|' && *p_ != ')')
+                {
+                    node atom(node_kind::empty);
+                    bool quantifiable = true;
+                    switch (*p_)
+                    {
+                        case '^':
+                            ++p_;
+                            atom.kind = node_kind::assertion;
+                            atom.assertion = opcode::assert_begin;
+                            quantifiable = false;
+                            break;
+                        case '$':
+                            ++p_;
+                            atom.kind = node_kind::assertion;
+                            atom.assertion = opcode::assert_end;
+                            quantifiable = false;
+                            break;
+                        case '.':
+                            ++p_;
+                            atom.kind = node_kind::any;
+                            break;
+                        case '(':
+                            ++p_;
+                            if (p_ != end_ && *p_ == '?')
+                            {
+                                if (end_ - p_ < 2 || p_[1] != ':')
+                                {
+                                    return false; // lookaround and named groups
+                                }
+                                p_ += 2;
+                            }
+                            if (!parse_disjunction(atom) || p_ == end_ || *p_ != ')')
+                            {
+                                return false;
+                            }
+                            ++p_;
+                            break;
+                        case '[':
+                            ++p_;
+                            if (!parse_class(atom))
+                            {
+                                return false;
+                            }
+                            break;
+                        case '\\':
+                            ++p_;
+                            if (p_ == end_)
+                            {
+                                return false;
+                            }
+                            if (*p_ == 'b' || *p_ == 'B')
+                            {
+                                atom.kind = node_kind::assertion;
+                                atom.assertion = *p_ == 'b' ? opcode::word_boundary : opcode::not_word_boundary;
+                                quantifiable = false;
+                                ++p_;
+                            }
+                            else if (!parse_escape(atom, false))
+                            {
+                                return false;
+                            }
+                            break;
+                        case '*': case '+': case '?': case '{': case '}': case ']':
+                            return false;
+                        default:
+                            atom.kind = node_kind::character;
+                            atom.c = static_cast<code_point>(static_cast<typename std::make_unsigned<CharT>::type>(*p_));
+                            ++p_;
+                            break;
+                    }
+                    if (p_ != end_ && (*p_ == '*' || *p_ == '+' || *p_ == '?' || *p_ == '{'))
+                    {
+                        if (!quantifiable)
+                        {
+                            return false;
+                        }
+                        node rep(node_kind::repeat);
+                        if (!parse_quantifier(rep))
+                        {
+                            return false;
+                        }
+                        rep.children.push_back(std::move(atom));
+                        seq.children.push_back(std::move(rep));
+                    }
+                    else
+                    {
+                        seq.children.push_back(std::move(atom));
+                    }
+                }
+                return true;
+            }
+
+            bool parse_quantifier(node& rep)
+            {
+                switch (*p_)
+                {
+                    case '*':
+                        rep.min_count = 0;
+                        rep.max_count = unbounded_repeat;
+                        ++p_;
+                        break;
+                    case '+':
+                        rep.min_count = 1;
+                        rep.max_count = unbounded_repeat;
+                        ++p_;
+                        break;
+                    case '?':
+                        rep.min_count = 0;
+                        rep.max_count = 1;
+                        ++p_;
+                        break;
+                    default: // '{'
+                        ++p_;
+                        if (!parse_count(rep.min_count))
+                        {
+                            return false;
+                        }
+                        rep.max_count = rep.min_count;
+                        if (p_ != end_ && *p_ == ',')
+                        {
+                            ++p_;
+                            rep.max_count = unbounded_repeat;
+                            if (p_ != end_ && *p_ != '}' && !parse_count(rep.max_count))
+                            {
+                                return false;
+                            }
+                        }
+                        if (p_ == end_ || *p_ != '}' || rep.max_count < rep.min_count)
+                        {
+                            return false;
+                        }
+                        ++p_;
+                        break;
+                }
+                if (p_ != end_ && *p_ == '?')
+                {
+                    rep.greedy = false;
+                    ++p_;
+                }
+                return true;
+            }
+
+            bool parse_count(std::size_t& n)
+            {
+                if (p_ == end_ || *p_ < '0' || *p_ > '9')
+                {
+                    return false;
+                }
+                n = 0;
+                while (p_ != end_ && *p_ >= '0' && *p_ <= '9')
+                {
+                    n = n*10 + static_cast<std::size_t>(*p_ - '0');
+                    if (n > max_program_size)
+                    {
+                        return false;
+                    }
+                    ++p_;
+                }
+                return true;
+            }
+
+            // Parses the escape after a backslash into a character or a character class
+            bool parse_escape(node& atom, bool in_class)
+            {
+                CharT e = *p_++;
+                switch (e)
+                {
+                    case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+                    {
+                        char_class cls;
+                        add_class_escape(cls, e);
+                        atom.kind = node_kind::char_class;
+                        atom.c = static_cast<code_point>(classes_.size());
+                        classes_.push_back(std::move(cls));
+                        return true;
+                    }
+                    case 't': atom.c = '\t'; break;
+                    case 'n': atom.c = '\n'; break;
+                    case 'r': atom.c = '\r'; break;
+                    case 'f': atom.c = '\f'; break;
+                    case 'v': atom.c = '\v'; break;
+                    case 'b':
+                        if (!in_class)
+                        {
+                            return false;
+                        }
+                        atom.c = '\b';
+                        break;
+                    case '0':
+                        if (p_ != end_ && *p_ >= '0' && *p_ <= '9')
+                        {
+                            return false;
+                        }
+                        atom.c = 0;
+                        break;
+                    case 'x':
+                        if (!parse_hex(2, atom.c))
+                        {
+                            return false;
+                        }
+                        break;
+                    case 'u':
+                        if (!parse_hex(4, atom.c))
+                        {
+                            return false;
+                        }
+                        break;
+                    default:
+                        // Identity escapes of punctuation; letters and digits (back references,
+                        // \c, \p and the like) are left to std::basic_regex
+                        if ((e >= '0' && e <= '9') || (e >= 'a' && e <= 'z') || (e >= 'A' && e <= 'Z') || e == '_' ||
+                            static_cast<code_point>(static_cast<typename std::make_unsigned<CharT>::type>(e)) > 0x7f)
+                        {
+                            return false;
+                        }
+                        atom.c = static_cast<code_point>(e);
+                        break;
+                }
+                if (sizeof(CharT) == 1 && atom.c > 0xff)
+                {
+                    return false;
+                }
+                atom.kind = node_kind::character;
+                return true;
+            }
+
+            bool parse_hex(int digits, code_point& c)
+            {
+                c = 0;
+                for (int i = 0; i < digits; ++i)
+                {
+                    if (p_ == end_)
+                    {
+                        return false;
+                    }
+                    CharT h = *p_++;
+                    c <<= 4;
+                    if (h >= '0' && h <= '9')
+                    {
+                        c += static_cast<code_point>(h - '0');
+                    }
+                    else if (h >= 'a' && h <= 'f')
+                    {
+                        c += static_cast<code_point>(h - 'a' + 10);
+                    }
+                    else if (h >= 'A' && h <= 'F')
+                    {
+                        c += static_cast<code_point>(h - 'A' + 10);
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void add_class_escape(char_class& cls, CharT e)
+            {
+                switch (e)
+                {
+                    case 'd':
+                        cls.add('0', '9', false);
+                        break;
+                    case 'D':
+                        cls.add(0, '0' - 1, false);
+                        cls.add('9' + 1, max_code_point, false);
+                        break;
+                    case 'w':
+                        cls.add('0', '9', false);
+                        cls.add('A', 'Z', false);
+                        cls.add('_', '_', false);
+                        cls.add('a', 'z', false);
+                        break;
+                    case 'W':
+                        cls.add(0, '0' - 1, false);
+                        cls.add('9' + 1, 'A' - 1, false);
+                        cls.add('Z' + 1, '_' - 1, false);
+                        cls.add('_' + 1, 'a' - 1, false);
+                        cls.add('z' + 1, max_code_point, false);
+                        break;
+                    case 's':
+                        cls.add('\t', '\r', false);
+                        cls.add(' ', ' ', false);
+                        break;
+                    default: // 'S'
+                        cls.add(0, '\t' - 1, false);
+                        cls.add('\r' + 1, ' ' - 1, false);
+                        cls.add(' ' + 1, max_code_point, false);
+                        break;
+                }
+            }
+
+            bool parse_class(node& atom)
+            {
+                char_class cls;
+                if (p_ != end_ && *p_ == '^')
+                {
+                    cls.negated = true;
+                    ++p_;
+                }
+                if (p_ == end_ || *p_ == ']')
+                {
+                    return false; // [] and [^]
+                }
+                while (p_ != end_ && *p_ != ']')
+                {
+                    code_point first = 0;
+                    bool is_char = true;
+                    if (!parse_class_atom(cls, first, is_char))
+                    {
+                        return false;
+                    }
+                    if (p_ != end_ && *p_ == '-' && end_ - p_ > 1 && p_[1] != ']')
+                    {
+                        ++p_;
+                        code_point last = 0;
+                        bool last_is_char = true;
+                        if (!is_char || !parse_class_atom(cls, last, last_is_char) || !last_is_char || last < first)
+                        {
+                            return false;
+                        }
+                        cls.add(first, last, icase_);
+                    }
+                    else if (is_char)
+                    {
+                        cls.add(first, first, icase_);
+                    }
+                }
+                if (p_ == end_)
+                {
+                    return false;
+                }
+                ++p_;
+                atom.kind = node_kind::char_class;
+                atom.c = static_cast<code_point>(classes_.size());
+                classes_.push_back(std::move(cls));
+                return true;
+            }
+
+            // Reads one character of a class, or adds a class escape such as \d to cls
+            bool parse_class_atom(char_class& cls, code_point& c, bool& is_char)
+            {
+                if (*p_ == '[')
+                {
+                    return false; // [:alpha:] and the like
+                }
+                if (*p_ != '\\')
+                {
+                    c = static_cast<code_point>(static_cast<typename std::make_unsigned<CharT>::type>(*p_));
+                    ++p_;
+                    return true;
+                }
+                ++p_;
+                if (p_ == end_)
+                {
+                    return false;
+                }
+                CharT e = *p_;
+                if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S')
+                {
+                    ++p_;
+                    add_class_escape(cls, e);
+                    is_char = false;
+                    return true;
+                }
+                if (e == '-')
+                {
+                    ++p_;
+                    c = '-';
+                    return true;
+                }
+                node atom(node_kind::empty);
+                if (!parse_escape(atom, true))
+                {
+                    return false;
+                }
+                c = atom.c;
+                return true;
+            }
+        };
+
+        std::vector<instruction> program_;
+        std::vector<char_class> classes_;
+        bool icase_;
+        bool is_linear_;
+        bool has_exact_spans_;
+        bool anchored_; // the pattern starts with ^
+        std::basic_string<CharT> literal_; // set if the pattern is a plain case-sensitive string
+        std::basic_regex<CharT> fallback_;
+
+        // Deterministic automaton for search(). Bytes that every instruction treats alike share a
+        // column of the transition table; state 0 is the state before the first character.
+        bool has_dfa_;
+        std::size_t dfa_dead_state_; // the state no match can be reached from, if there is one
+        std::size_t dfa_class_count_;
+        std::vector<uint16_t> dfa_byte_class_;
+        std::vector<uint32_t> dfa_transitions_; // state * dfa_class_count_ + byte class
+        std::vector<uint8_t> dfa_accepts_;      // accepts_here and accepts_at_end bits per state
+    public:
+        basic_regex_matcher(const string_view_type& pattern, bool icase = false)
+            : icase_(icase), is_linear_(false), has_exact_spans_(false), anchored_(false),
+              has_dfa_(false), dfa_dead_state_(static_cast<std::size_t>(-1)), dfa_class_count_(0)
+        {
+            node root(node_kind::empty);
+            parser p(pattern.data(), pattern.data() + pattern.size(), icase, classes_);
+            if (p.parse(root) && emit(root))
+            {
+                instruction ins{opcode::match, 0, 0, 0};
+                program_.push_back(ins);
+                is_linear_ = program_.size() <= max_program_size;
+            }
+            if (is_linear_)
+            {
+                anchored_ = program_.front().op == opcode::assert_begin;
+                if (!icase)
+                {
+                    set_literal(root);
+                }
+                if (literal_.empty())
+                {
+                    build_dfa();
+                }
+            }
+            else
+            {
+                program_.clear();
+                classes_.clear();
+            }
+            // Where empty matches, and matches of repeated groups that can be empty such as
+            // (a*)*, begin and end is up to the std::regex implementation, so split leaves
+            // patterns that can match the empty string to std::basic_regex
+            has_exact_spans_ = is_linear_ && !is_nullable(root) && !has_empty_loop(root);
+            if (!has_exact_spans_)
+            {
+                std::regex::flag_type options = std::regex_constants::ECMAScript;
+                if (icase)
+                {
+                    options |= std::regex_constants::icase;
+                }
+                fallback_ = std::basic_regex<CharT>(pattern.data(), pattern.size(), options);
+            }
+        }
+
+        basic_regex_matcher(const basic_regex_matcher&) = delete;
+        basic_regex_matcher& operator=(const basic_regex_matcher&) = delete;
+
+        // True if the pattern is matched by the automaton rather than by std::basic_regex
+        bool is_linear() const
+        {
+            return is_linear_;
+        }
+
+        // Returns true if the pattern matches somewhere in s, as std::regex_search
+        bool search(const string_view_type& s) const
+        {
+            if (!is_linear_)
+            {
+                return std::regex_search(s.data(), s.data() + s.size(), fallback_);
+            }
+            if (has_dfa_)
+            {
+                const CharT* end = s.data() + s.size();
+                std::size_t state = 0;
+                for (const CharT* p = s.data(); ; ++p)
+                {
+                    uint8_t accepts = dfa_accepts_[state];
+                    if (accepts & accepts_here)
+                    {
+                        return true;
+                    }
+                    if (p == end)
+                    {
+                        return (accepts & accepts_at_end) != 0;
+                    }
+                    code_point c = code_at(p);
+                    if (c > 0xff)
+                    {
+                        break; // the table only covers single bytes
+                    }
+                    state = dfa_transitions_[state*dfa_class_count_ + dfa_byte_class_[c]];
+                    if (state == dfa_dead_state_)
+                    {
+                        return false;
+                    }
+                }
+            }
+            const CharT* first = nullptr;
+            const CharT* last = nullptr;
+            return find(s.data(), s.data() + s.size(), s.data(), true, first, last);
+        }
+
+        // Calls f with each piece of s between matches of the pattern, as
+        // std::regex_token_iterator with submatch -1
+        template <typename F>
+        void split(const string_view_type& s, F f) const
+        {
+            const CharT* begin = s.data();
+            const CharT* end = s.data() + s.size();
+            if (!has_exact_spans_)
+            {
+                std::regex_token_iterator<const CharT*> rit(begin, end, fallback_, -1);
+                std::regex_token_iterator<const CharT*> rend;
+                for (; rit != rend; ++rit)
+                {
+                    f(string_view_type((*rit).first, static_cast<std::size_t>((*rit).second - (*rit).first)));
+                }
+                return;
+            }
+
+            // The pattern cannot match the empty string, so each match ends past the previous one
+            const CharT* prefix = begin;
+            const CharT* first = nullptr;
+            const CharT* last = nullptr;
+            bool found = false;
+            while (find(begin, end, prefix, false, first, last))
+            {
+                f(string_view_type(prefix, static_cast<std::size_t>(first - prefix)));
+                prefix = last;
+                found = true;
+            }
+            if (!found || prefix != end)
+            {
+                f(string_view_type(prefix, static_cast<std::size_t>(end - prefix)));
+            }
+        }
+
+    private:
+        static code_point to_lower(code_point c)
+        {
+            return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+        }
+
+        static code_point to_upper(code_point c)
+        {
+            return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+        }
+
+        static bool is_word(code_point c)
+        {
+            return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+        }
+
+        static bool is_line_terminator(code_point c)
+        {
+            return c == '\n' || c == '\r' || c == 0x2028 || c == 0x2029;
+        }
+
+        static code_point code_at(const CharT* p)
+        {
+            return static_cast<code_point>(static_cast<typename std::make_unsigned<CharT>::type>(*p));
+        }
+
+        void set_literal(const node& n)
+        {
+            if (n.kind == node_kind::character)
+            {
+                literal_.push_back(static_cast<CharT>(n.c));
+                return;
+            }
+            if (n.kind != node_kind::concat || n.children.empty())
+            {
+                return;
+            }
+            for (const auto& child : n.children)
+            {
+                if (child.kind != node_kind::character)
+                {
+                    literal_.clear();
+                    return;
+                }
+                literal_.push_back(static_cast<CharT>(child.c));
+            }
+        }
+
+        static bool is_nullable(const node& n)
+        {
+            switch (n.kind)
+            {
+                case node_kind::character:
+                case node_kind::any:
+                case node_kind::char_class:
+                    return false;
+                case node_kind::concat:
+                    for (const auto& child : n.children)
+                    {
+                        if (!is_nullable(child))
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                case node_kind::alternation:
+                    for (const auto& child : n.children)
+                    {
+                        if (is_nullable(child))
+                        {
+                            return true;
+                        }
+                    }
+                    return false;
+                case node_kind::repeat:
+                    return n.min_count == 0 || is_nullable(n.children.front());
+                default:
+                    return true;
+            }
+        }
+
+        static bool has_empty_loop(const node& n)
+        {
+            if (n.kind == node_kind::repeat && n.max_count > 1 && is_nullable(n.children.front()))
+            {
+                return true;
+            }
+            for (const auto& child : n.children)
+            {
+                if (has_empty_loop(child))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::size_t emit_instruction(opcode op, code_point c = 0, std::size_t x = 0, std::size_t y = 0)
+        {
+            instruction ins{op, c, x, y};
+            program_.push_back(ins);
+            return program_.size() - 1;
+        }
+
+        bool emit(const node& n)
+        {
+            if (program_.size() > max_program_size)
+            {
+                return false;
+            }
+            switch (n.kind)
+            {
+                case node_kind::empty:
+                    return true;
+                case node_kind::character:
+                    emit_instruction(opcode::character, icase_ ? to_lower(n.c) : n.c);
+                    return true;
+                case node_kind::any:
+                    emit_instruction(opcode::any);
+                    return true;
+                case node_kind::char_class:
+                    emit_instruction(opcode::char_class, n.c);
+                    return true;
+                case node_kind::assertion:
+                    emit_instruction(n.assertion);
+                    return true;
+                case node_kind::concat:
+                    for (const auto& child : n.children)
+                    {
+                        if (!emit(child))
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                case node_kind::alternation:
+                {
+                    // split L1, L2; L1: e1; jump end; L2: split ...; en
+                    std::vector<std::size_t> jumps;
+                    for (std::size_t i = 0; i < n.children.size(); ++i)
+                    {
+                        std::size_t split = 0;
+                        bool is_last = i + 1 == n.children.size();
+                        if (!is_last)
+                        {
+                            split = emit_instruction(opcode::split);
+                            program_[split].x = program_.size();
+                        }
+                        if (!emit(n.children[i]))
+                        {
+                            return false;
+                        }
+                        if (!is_last)
+                        {
+                            jumps.push_back(emit_instruction(opcode::jump));
+                            program_[split].y = program_.size();
+                        }
+                    }
+                    for (auto j : jumps)
+                    {
+                        program_[j].x = program_.size();
+                    }
+                    return true;
+                }
+                default: // repeat
+                {
+                    const node& body = n.children.front();
+                    for (std::size_t i = 0; i < n.min_count; ++i)
+                    {
+                        if (!emit(body))
+                        {
+                            return false;
+                        }
+                    }
+                    if (n.max_count == unbounded_repeat)
+                    {
+                        // L1: split L2, L3; L2: body; jump L1; L3:
+                        std::size_t split = emit_instruction(opcode::split);
+                        std::size_t enter = program_.size();
+                        if (!emit(body))
+                        {
+                            return false;
+                        }
+                        emit_instruction(opcode::jump, 0, split);
+                        set_split(split, enter, program_.size(), n.greedy);
+                        return true;
+                    }
+                    for (std::size_t i = n.min_count; i < n.max_count; ++i)
+                    {
+                        // split L1, L2; L1: body; L2:
+                        std::size_t split = emit_instruction(opcode::split);
+                        std::size_t enter = program_.size();
+                        if (!emit(body))
+                        {
+                            return false;
+                        }
+                        set_split(split, enter, program_.size(), n.greedy);
+                    }
+                    return true;
+                }
+            }
+        }
+
+        void set_split(std::size_t split, std::size_t enter, std::size_t skip, bool greedy)
+        {
+            program_[split].x = greedy ? enter : skip;
+            program_[split].y = greedy ? skip : enter;
+        }
+
+        static bool is_consuming(opcode op)
+        {
+            return op == opcode::character || op == opcode::any || op == opcode::char_class;
+        }
+
+        // Adds to states the instructions reachable from pc without consuming input that consume
+        // input, match, or (unless at_end) assert the end of input
+        void add_dfa_closure(std::size_t pc, bool at_begin, bool at_end, std::vector<bool>& seen,
+            std::vector<std::size_t>& pending, std::vector<std::size_t>& states) const
+        {
+            pending.clear();
+            pending.push_back(pc);
+            while (!pending.empty())
+            {
+                std::size_t i = pending.back();
+                pending.pop_back();
+                if (seen[i])
+                {
+                    continue;
+                }
+                seen[i] = true;
+                const instruction& ins = program_[i];
+                switch (ins.op)
+                {
+                    case opcode::split:
+                        pending.push_back(ins.y);
+                        pending.push_back(ins.x);
+                        break;
+                    case opcode::jump:
+                        pending.push_back(ins.x);
+                        break;
+                    case opcode::assert_begin:
+                        if (at_begin)
+                        {
+                            pending.push_back(i + 1);
+                        }
+                        break;
+                    case opcode::assert_end:
+                        if (at_end)
+                        {
+                            pending.push_back(i + 1);
+                        }
+                        else
+                        {
+                            states.push_back(i);
+                        }
+                        break;
+                    default:
+                        states.push_back(i);
+                        break;
+                }
+            }
+        }
+
+        // Builds the deterministic automaton for search() by subset construction. A state is the
+        // set of instructions the Pike VM would have threads on, plus a fresh start at every
+        // position, so the automaton accepts as soon as a match ends anywhere in the input.
+        void build_dfa()
+        {
+            if (program_.size() > max_dfa_program_size)
+            {
+                return;
+            }
+            for (const auto& ins : program_)
+            {
+                if (ins.op == opcode::word_boundary || ins.op == opcode::not_word_boundary)
+                {
+                    return;
+                }
+            }
+
+            // Group the bytes by the instructions they match
+            std::vector<unsigned char> representatives;
+            {
+                std::map<std::vector<bool>,uint16_t> signatures;
+                dfa_byte_class_.resize(256);
+                for (code_point c = 0; c < 256; ++c)
+                {
+                    std::vector<bool> signature;
+                    for (const auto& ins : program_)
+                    {
+                        if (is_consuming(ins.op))
+                        {
+                            signature.push_back(matches(ins, c));
+                        }
+                    }
+                    auto it = signatures.find(signature);
+                    if (it == signatures.end())
+                    {
+                        it = signatures.emplace(std::move(signature), static_cast<uint16_t>(representatives.size())).first;
+                        representatives.push_back(static_cast<unsigned char>(c));
+                    }
+                    dfa_byte_class_[c] = it->second;
+                }
+            }
+            dfa_class_count_ = representatives.size();
+
+            std::vector<bool> seen(program_.size());
+            std::vector<std::size_t> pending;
+
+            // Threads started at a position other than the first
+            std::vector<std::size_t> restart;
+            add_dfa_closure(0, false, false, seen, pending, restart);
+
+            // The start state is told apart from any later state with the same threads by a
+            // marker past the end of the program, as only there does ^ hold
+            std::vector<std::vector<std::size_t>> states(1);
+            std::fill(seen.begin(), seen.end(), false);
+            add_dfa_closure(0, true, false, seen, pending, states[0]);
+            std::sort(states[0].begin(), states[0].end());
+            states[0].push_back(program_.size());
+            std::map<std::vector<std::size_t>,std::size_t> ids;
+            ids.emplace(states[0], 0);
+
+            for (std::size_t id = 0; id < states.size(); ++id)
+            {
+                for (std::size_t k = 0; k < dfa_class_count_; ++k)
+                {
+                    std::fill(seen.begin(), seen.end(), false);
+                    std::vector<std::size_t> next;
+                    for (auto pc : restart)
+                    {
+                        seen[pc] = true;
+                        next.push_back(pc);
+                    }
+                    for (auto pc : states[id])
+                    {
+                        if (pc < program_.size() && is_consuming(program_[pc].op) && matches(program_[pc], representatives[k]))
+                        {
+                            add_dfa_closure(pc + 1, false, false, seen, pending, next);
+                        }
+                    }
+                    std::sort(next.begin(), next.end());
+                    auto it = ids.find(next);
+                    if (it == ids.end())
+                    {
+                        if ((states.size() + 1)*dfa_class_count_ > max_dfa_entries)
+                        {
+                            dfa_byte_class_.clear();
+                            dfa_transitions_.clear();
+                            return;
+                        }
+                        if (next.empty())
+                        {
+                            dfa_dead_state_ = states.size();
+                        }
+                        it = ids.emplace(next, states.size()).first;
+                        states.push_back(std::move(next));
+                    }
+                    dfa_transitions_.push_back(static_cast<uint32_t>(it->second));
+                }
+            }
+
+            dfa_accepts_.resize(states.size());
+            for (std::size_t id = 0; id < states.size(); ++id)
+            {
+                for (auto pc : states[id])
+                {
+                    if (pc == program_.size())
+                    {
+                        continue;
+                    }
+                    if (program_[pc].op == opcode::match)
+                    {
+                        dfa_accepts_[id] |= accepts_here | accepts_at_end;
+                    }
+                    else if (program_[pc].op == opcode::assert_end)
+                    {
+                        std::fill(seen.begin(), seen.end(), false);
+                        std::vector<std::size_t> at_end;
+                        add_dfa_closure(pc + 1, id == 0, true, seen, pending, at_end);
+                        for (auto end_pc : at_end)
+                        {
+                            if (program_[end_pc].op == opcode::match)
+                            {
+                                dfa_accepts_[id] |= accepts_at_end;
+                            }
+                        }
+                    }
+                }
+            }
+            has_dfa_ = true;
+        }
+
+        struct thread
+        {
+            std::size_t pc;
+            const CharT* start;
+        };
+
+        // Adds the thread at pc and everything reachable from it without consuming input, in
+        // priority order, skipping instructions already on the list for this position
+        void add_thread(std::vector<thread>& list, std::size_t* marks, std::size_t generation,
+            std::vector<std::size_t>& pending, std::size_t pc, const CharT* start,
+            const CharT* begin, const CharT* end, const CharT* pos) const
+        {
+            pending.clear();
+            std::size_t i = pc;
+            for (;;)
+            {
+                bool follow = false;
+                if (marks[i] != generation)
+                {
+                    marks[i] = generation;
+                    const instruction& ins = program_[i];
+                    switch (ins.op)
+                    {
+                        case opcode::split:
+                            pending.push_back(ins.y);
+                            i = ins.x;
+                            follow = true;
+                            break;
+                        case opcode::jump:
+                            i = ins.x;
+                            follow = true;
+                            break;
+                        case opcode::assert_begin:
+                            follow = pos == begin;
+                            ++i;
+                            break;
+                        case opcode::assert_end:
+                            follow = pos == end;
+                            ++i;
+                            break;
+                        case opcode::word_boundary:
+                        case opcode::not_word_boundary:
+                        {
+                            bool before = pos != begin && is_word(code_at(pos - 1));
+                            bool after = pos != end && is_word(code_at(pos));
+                            follow = (before != after) == (ins.op == opcode::word_boundary);
+                            ++i;
+                            break;
+                        }
+                        default:
+                            list.push_back(thread{i, start});
+                            break;
+                    }
+                }
+                if (!follow)
+                {
+                    if (pending.empty())
+                    {
+                        break;
+                    }
+                    i = pending.back();
+                    pending.pop_back();
+                }
+            }
+        }
+
+        bool matches(const instruction& ins, code_point c) const
+        {
+            switch (ins.op)
+            {
+                case opcode::character:
+                    return (icase_ ? to_lower(c) : c) == ins.c;
+                case opcode::any:
+                    return !is_line_terminator(c);
+                default: // char_class
+                    return classes_[ins.c].contains(c);
+            }
+        }
+
+        // Finds the leftmost match starting at or after from, preferring alternatives and
+        // quantifier choices in the order a backtracking ECMAScript matcher tries them. With
+        // any_match, returns as soon as any match is found.
+        bool find(const CharT* begin, const CharT* end, const CharT* from, bool any_match,
+            const CharT*& match_first, const CharT*& match_last) const
+        {
+            if (!literal_.empty())
+            {
+                if (static_cast<std::size_t>(end - from) < literal_.size())
+                {
+                    return false;
+                }
+                const CharT* p = std::search(from, end, literal_.begin(), literal_.end());
+                if (p == end)
+                {
+                    return false;
+                }
+                match_first = p;
+                match_last = p + literal_.size();
+                return true;
+            }
+
+            scratch& sc = thread_scratch();
+            if (sc.marks.size() < program_.size())
+            {
+                sc.marks.resize(program_.size(), 0);
+            }
+            std::size_t* marks = sc.marks.data();
+            std::size_t generation = sc.generation;
+            std::vector<thread>& clist = sc.clist;
+            std::vector<thread>& nlist = sc.nlist;
+            clist.clear();
+
+            const instruction& first_ins = program_.front();
+            const bool skip_ahead = first_ins.op == opcode::character || first_ins.op == opcode::char_class;
+
+            bool matched = false;
+            for (const CharT* pos = from; ; ++pos)
+            {
+                if (!matched && (!anchored_ || pos == begin))
+                {
+                    if (clist.empty())
+                    {
+                        if (skip_ahead)
+                        {
+                            // No thread is running, so move to the next position where the
+                            // first instruction can match
+                            while (pos != end && !matches(first_ins, code_at(pos)))
+                            {
+                                ++pos;
+                            }
+                        }
+                        ++generation;
+                    }
+                    add_thread(clist, marks, generation, sc.pending, 0, pos, begin, end, pos);
+                }
+                if (clist.empty())
+                {
+                    if (matched || anchored_ || pos == end)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                ++generation;
+                nlist.clear();
+                for (const auto& t : clist)
+                {
+                    const instruction& ins = program_[t.pc];
+                    if (ins.op == opcode::match)
+                    {
+                        matched = true;
+                        match_first = t.start;
+                        match_last = pos;
+                        break; // lower priority threads are cut off
+                    }
+                    if (pos != end && matches(ins, code_at(pos)))
+                    {
+                        add_thread(nlist, marks, generation, sc.pending, t.pc + 1, t.start, begin, end, pos + 1);
+                    }
+                }
+                if (matched && any_match)
+                {
+                    break;
+                }
+                clist.swap(nlist);
+                if (pos == end)
+                {
+                    break;
+                }
+            }
+            sc.generation = generation;
+            return matched;
+        }
+
+        // Thread lists and marks reused by every search made on a thread. The generation only
+        // increases, so marks left by an earlier search never look current.
+        struct scratch
+        {
+            std::vector<thread> clist;
+            std::vector<thread> nlist;
+            std::vector<std::size_t> marks;
+            std::vector<std::size_t> pending;
+            std::size_t generation;
+
+            scratch()
+                : generation(0)
+            {
+            }
+        };
+
+        static scratch& thread_scratch()
+        {
+            static thread_local scratch sc;
+            return sc;
+        }
+    };
+
+    using regex_matcher = basic_regex_matcher<char>;
+
+    // A thread-safe, least-recently-used cache of compiled regular expressions keyed by pattern
+    // and case sensitivity. Patterns that fail to compile are not cached.
+    template <typename CharT>
+    class regex_matcher_cache
+    {
+    public:
+        using matcher_type = basic_regex_matcher<CharT>;
+        using matcher_pointer = std::shared_ptr<const matcher_type>;
+        using string_view_type = typename matcher_type::string_view_type;
+
+        static constexpr std::size_t default_capacity = 256;
+    private:
+        using key_type = std::basic_string<CharT>;
+        using entry_type = std::pair<key_type,matcher_pointer>;
+        using list_type = std::list<entry_type>;
+
+        std::size_t capacity_;
+        mutable std::mutex mutex_;
+        list_type entries_; // most recently used first
+        std::unordered_map<key_type,typename list_type::iterator> index_;
+        std::size_t hits_;
+        std::size_t misses_;
+    public:
+        explicit regex_matcher_cache(std::size_t capacity = default_capacity)
+            : capacity_(capacity == 0 ? 1 : capacity), hits_(0), misses_(0)
+        {
+        }
+
+        regex_matcher_cache(const regex_matcher_cache&) = delete;
+        regex_matcher_cache& operator=(const regex_matcher_cache&) = delete;
+
+        // Returns the compiled form of pattern, compiling it on a miss. Throws std::regex_error
+        // if the pattern is invalid.
+        matcher_pointer get(const string_view_type& pattern, bool icase = false)
+        {
+            key_type key;
+            key.reserve(pattern.size() + 1);
+            key.push_back(icase ? 'i' : '-');
+            key.append(pattern.data(), pattern.size());
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = index_.find(key);
+                if (it != index_.end())
+                {
+                    ++hits_;
+                    entries_.splice(entries_.begin(), entries_, it->second);
+                    return it->second->second;
+                }
+                ++misses_;
+            }
+
+            // Compile without holding the lock; if another thread compiled the same pattern
+            // meanwhile, its entry is kept and returned
+            matcher_pointer matcher = std::make_shared<const matcher_type>(pattern, icase);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end())
+            {
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->second;
+            }
+            entries_.emplace_front(key, matcher);
+            index_.emplace(std::move(key), entries_.begin());
+            while (entries_.size() > capacity_)
+            {
+                index_.erase(entries_.back().first);
+                entries_.pop_back();
+            }
+            return matcher;
+        }
+
+        std::size_t hits() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return hits_;
+        }
+
+        std::size_t misses() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return misses_;
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return entries_.size();
+        }
+
+        std::size_t capacity() const
+        {
+            return capacity_;
+        }
+
+        // Drops all entries and resets the hit and miss counters
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index_.clear();
+            entries_.clear();
+            hits_ = 0;
+            misses_ = 0;
+        }
+    };
+
+    // The process-wide cache shared by JSONPath and JSON Schema
+    template <typename CharT>
+    regex_matcher_cache<CharT>& default_regex_matcher_cache()
+    {
+        static regex_matcher_cache<CharT> cache;
+        return cache;
+    }
+
+    // Returns the compiled form of pattern from the process-wide cache
+    template <typename CharT>
+    std::shared_ptr<const basic_regex_matcher<CharT>> cached_regex_matcher(const jsoncons::basic_string_view<CharT>& pattern,
+        bool icase = false)
+    {
+        return default_regex_matcher_cache<CharT>().get(pattern, icase);
+    }
+
+} // namespace utility
+} // namespace jsoncons
+
+#endif // defined(JSONCONS_HAS_STD_REGEX)
+
+#endif // JSONCONS_UTILITY_REGEX_HPP
@@ -8,7 +8,9 @@
 #define JSONCONS_EXT_JSONPATCH_JSONPATCH_HPP
 
 #include <algorithm> // std::min
+#include <cmath> // std::sqrt
 #include <cstddef>
+#include <memory> // std::unique_ptr
 #include <string>
 #include <system_error>
 #include <utility> // std::move
@@ -17,6 +19,7 @@
 #include <jsoncons/json_type.hpp>
 
 #include <jsoncons_ext/jsonpatch/jsonpatch_error.hpp>
+#include <jsoncons_ext/jsonpatch/structural_index.hpp>
 #include <jsoncons_ext/jsonpointer/jsonpointer.hpp>
 
 namespace jsoncons { 
@@ -110,7 +113,7 @@ namespace detail {
 
         std::error_code ec;
 
-        Json val = jsonpointer::get(root, pointer, ec);
+        const Json& val = jsonpointer::get(root, pointer, ec);
         if (ec || !val.is_array())
         {
             return location;
@@ -122,9 +125,15 @@ namespace detail {
         return jsonpointer::basic_json_pointer<char_type>(std::move(tokens));
     }
 
-    enum class op_type {add,remove,replace};
+    // How to undo an applied operation: add value at path, remove path, replace path with value,
+    // or take the value at path back to from (move), restoring value at path if it displaced one
+    // (move_replace)
+    enum class op_type {add,remove,replace,move,move_replace};
     enum class state_type {begin,abort,commit};
 
+    // The undo log of a patch being applied. Values displaced by an operation are moved into the
+    // log rather than copied, and the parsed pointers are moved in with them, so a patch that
+    // succeeds costs no copies of the subtrees it replaces or removes.
     template <typename Json>
     struct operation_unwinder
     {
@@ -137,9 +146,15 @@ namespace detail {
             op_type op;
             json_pointer_type path;
             Json value;
+            json_pointer_type from;
 
-            entry(op_type Op, const json_pointer_type& Path, const Json& Value)
-                : op(Op), path(Path), value(Value)
+            entry(op_type Op, json_pointer_type&& Path, Json&& Value)
+                : op(Op), path(std::move(Path)), value(std::move(Value))
+            {
+            }
+
+            entry(op_type Op, json_pointer_type&& Path, Json&& Value, json_pointer_type&& From)
+                : op(Op), path(std::move(Path)), value(std::move(Value)), from(std::move(From))
             {
             }
 
@@ -170,7 +185,7 @@ namespace detail {
                 {
                     if ((*it).op == op_type::add)
                     {
-                        jsonpointer::add(target,(*it).path,(*it).value,ec);
+                        jsonpointer::add(target,(*it).path,std::move((*it).value),ec);
                         if (JSONCONS_UNLIKELY(ec))
                         {
                             //std::cout << "add: " << (*it).path << '\n';
@@ -188,69 +203,524 @@ namespace detail {
                     }
                     else if ((*it).op == op_type::replace)
                     {
-                        jsonpointer::replace(target,(*it).path,(*it).value,ec);
+                        jsonpointer::replace(target,(*it).path,std::move((*it).value),ec);
                         if (JSONCONS_UNLIKELY(ec))
                         {
                             //std::cout << "replace: " << (*it).path << '\n';
                             break;
                         }
                     }
+                    else
+                    {
+                        Json& moved = jsonpointer::get(target,(*it).path,ec);
+                        if (JSONCONS_UNLIKELY(ec))
+                        {
+                            break;
+                        }
+                        Json val = std::move(moved);
+                        if ((*it).op == op_type::move_replace)
+                        {
+                            moved = std::move((*it).value);
+                        }
+                        else
+                        {
+                            jsonpointer::remove(target,(*it).path,ec);
+                            if (JSONCONS_UNLIKELY(ec))
+                            {
+                                break;
+                            }
+                        }
+                        jsonpointer::add(target,(*it).from,std::move(val),ec);
+                        if (JSONCONS_UNLIKELY(ec))
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    // Arrays are diffed by aligning equal elements, so that inserting or removing an element
+    // produces one add or remove rather than a replace of every element after it. Alignment
+    // is abandoned, and elements are compared by position, when the differing part of the
+    // arrays has more than array_diff_max_elements elements, or needs more than
+    // array_diff_max_edits adds and removes, or more than array_diff_max_comparisons
+    // element comparisons.
+    constexpr std::size_t array_diff_max_elements = 100000;
+    constexpr std::size_t array_diff_max_edits = 1000;
+    constexpr std::size_t array_diff_max_comparisons = 4000000;
+
+    // A value's place in a structural_index, or no index if it has not been hashed
+    template <typename Json>
+    struct hashed_value
+    {
+        const structural_index<Json>* index;
+        std::size_t entry;
+    };
+
+    // The elements of an array, or the member values of an object, with their places in a
+    // structural_index. If the container is not in an index, its elements are hashed one by
+    // one as aligning needs them, each into an index of its own, until an eighth of them have
+    // been; the container is then indexed as a whole. Either way the places are passed down
+    // when diffing the children, so no subtree is hashed twice on the way down.
+    template <typename Json>
+    class hashed_children
+    {
+        const Json& container_;
+        hashed_value<Json> hashed_;
+        std::vector<hashed_value<Json>> children_;
+        std::vector<std::unique_ptr<structural_index<Json>>> indexes_;
+        std::vector<std::uint64_t> hashes_;
+        std::vector<unsigned char> compares_;
+        std::unique_ptr<structural_index<Json>> index_;
+    public:
+        hashed_children(const Json& container, hashed_value<Json> hashed)
+            : container_(container), hashed_(hashed)
+        {
+        }
+
+        // The place of child i, if it has been hashed
+        hashed_value<Json> operator[](std::size_t i)
+        {
+            place();
+            return children_.empty() ? hashed_value<Json>{nullptr, 0} : children_[i];
+        }
+
+        // Compares array element i with element j of other. Elements are compared directly
+        // until one of them has been compared a few times, and then by hash first: the elements
+        // compared over and over are those of a long alignment search, where most comparisons
+        // fail.
+        bool equal_element(std::size_t i, hashed_children& other, std::size_t j)
+        {
+            if ((counted(i) | other.counted(j)) && element_hash(i) != other.element_hash(j))
+            {
+                return false;
+            }
+            return container_[i] == other.container_[j];
+        }
+    private:
+        // Counts a comparison of element i, returning true once it has been compared often
+        bool counted(std::size_t i)
+        {
+            if (compares_.empty())
+            {
+                compares_.assign(container_.size(), 0);
+            }
+            if (compares_[i] < 4)
+            {
+                ++compares_[i];
+                return false;
+            }
+            return true;
+        }
+
+        std::uint64_t element_hash(std::size_t i)
+        {
+            if (hashes_.empty())
+            {
+                hashes_.assign(container_.size(), 0);
+            }
+            if (hashes_[i] == 0) // not yet computed, or a zero hash computed again
+            {
+                hashes_[i] = compute_hash(i);
+            }
+            return hashes_[i];
+        }
+
+        std::uint64_t compute_hash(std::size_t i)
+        {
+            const Json& element = container_[i];
+            if (!is_container(element))
+            {
+                return scalar_hash(element);
+            }
+            place();
+            if (children_.empty())
+            {
+                children_.assign(container_.size(), hashed_value<Json>{nullptr, 0});
+            }
+            if (children_[i].index == nullptr)
+            {
+                if ((indexes_.size() + 1) * 8 < container_.size())
+                {
+                    indexes_.push_back(jsoncons::make_unique<structural_index<Json>>(element));
+                    children_[i] = hashed_value<Json>{indexes_.back().get(), 0};
+                }
+                else
+                {
+                    index_ = jsoncons::make_unique<structural_index<Json>>(container_);
+                    hashed_ = hashed_value<Json>{index_.get(), 0};
+                    children_.clear();
+                    place();
+                }
+            }
+            return children_[i].index->hash(children_[i].entry);
+        }
+
+        // Finds the places of the children in the container's index
+        void place()
+        {
+            if (hashed_.index == nullptr || !children_.empty())
+            {
+                return;
+            }
+            children_.reserve(container_.size());
+            std::size_t entry = hashed_.entry + 1;
+            auto add = [&](const Json& val)
+            {
+                if (is_container(val))
+                {
+                    children_.push_back(hashed_value<Json>{hashed_.index, entry});
+                    entry = hashed_.index->next(entry);
+                }
+                else
+                {
+                    children_.push_back(hashed_value<Json>{nullptr, 0});
+                }
+            };
+            if (container_.is_object())
+            {
+                for (const auto& member : container_.object_range())
+                {
+                    add(member.value());
+                }
+            }
+            else
+            {
+                for (const auto& element : container_.array_range())
+                {
+                    add(element);
                 }
             }
         }
     };
 
     template <typename Json>
-    Json from_diff(const Json& source, const Json& target, const typename Json::string_view_type& path)
+    void push_remove_op(Json& result, const std::basic_string<typename Json::char_type>& path)
     {
         using char_type = typename Json::char_type;
 
-        Json result = typename Json::array();
+        Json val(json_object_arg);
+        val.insert_or_assign(jsonpatch_names<char_type>::op_name(), jsonpatch_names<char_type>::remove_name());
+        val.insert_or_assign(jsonpatch_names<char_type>::path_name(), path);
+        result.push_back(std::move(val));
+    }
+
+    template <typename Json>
+    void push_add_op(Json& result, const std::basic_string<typename Json::char_type>& path, const Json& value)
+    {
+        using char_type = typename Json::char_type;
+
+        Json val(json_object_arg);
+        val.insert_or_assign(jsonpatch_names<char_type>::op_name(), jsonpatch_names<char_type>::add_name());
+        val.insert_or_assign(jsonpatch_names<char_type>::path_name(), path);
+        val.insert_or_assign(jsonpatch_names<char_type>::value_name(), value);
+        result.push_back(std::move(val));
+    }
+
+    template <typename Json>
+    void diff_values(const Json& source, const Json& target, const typename Json::string_view_type& path,
+        hashed_value<Json> source_hashed, hashed_value<Json> target_hashed, Json& result);
+
+    template <typename Json>
+    std::basic_string<typename Json::char_type> array_element_path(const typename Json::string_view_type& path, std::size_t index)
+    {
+        std::basic_string<typename Json::char_type> ss(path);
+        ss.push_back('/');
+        jsoncons::utility::from_integer(index, ss);
+        return ss;
+    }
+
+    // Diffs source[first, source_last) against target[first, target_last) element by element.
+    // If differ is set, the elements at each position are known to differ.
+    template <typename Json>
+    void diff_positional_array(const Json& source, const Json& target, std::size_t first,
+        std::size_t source_last, std::size_t target_last, const typename Json::string_view_type& path,
+        hashed_children<Json>& source_children, hashed_children<Json>& target_children, Json& result,
+        bool differ = false)
+    {
+        std::size_t common = first + (std::min)(source_last - first, target_last - first);
+        for (std::size_t i = first; i < common; ++i)
+        {
+            if (differ || !(source[i] == target[i]))
+            {
+                diff_values(source[i], target[i], array_element_path<Json>(path, i), source_children[i], target_children[i], result);
+            }
+        }
+        // Element in source, not in target - remove
+        for (std::size_t i = source_last; i-- > target_last;)
+        {
+            push_remove_op(result, array_element_path<Json>(path, i));
+        }
+        // Element in target, not in source - add, 
+        // Fix contributed by Alexander rog13
+        for (std::size_t i = source_last; i < target_last; ++i)
+        {
+            push_add_op(result, array_element_path<Json>(path, i), target[i]);
+        }
+    }
+
+    enum class edit_kind {keep, remove, insert};
+
+    // Finds the shortest sequence of element removals and insertions that turns n source
+    // elements into m target elements (Myers' O(ND) algorithm), as one edit per source and
+    // target element in order. equal(i, j) compares source element i with target element j.
+    // Returns false if that takes more than max_edits or the limits above allow.
+    template <typename Equal>
+    bool shortest_edit_script(std::ptrdiff_t n, std::ptrdiff_t m, Equal equal, std::vector<edit_kind>& script,
+        std::size_t max_edits = array_diff_max_edits)
+    {
+        // v[k + max_d] is the furthest source index reached on diagonal k = x - y. The
+        // values for diagonals -d..d are kept after each step d for the backtrack.
+        // Each step d compares at most n + m elements
+        const std::ptrdiff_t max_d = (std::min)({n + m,
+            static_cast<std::ptrdiff_t>((std::min)(max_edits, array_diff_max_edits)),
+            static_cast<std::ptrdiff_t>(array_diff_max_comparisons / static_cast<std::size_t>(n + m))});
+        std::vector<std::ptrdiff_t> v(static_cast<std::size_t>(2 * max_d + 3), 0);
+        std::vector<std::ptrdiff_t> trace;
+
+        // Searches for at most limit steps, appending v to trace after each step if record is
+        // set. Returns the number of edits, or -1 if more are needed
+        auto search = [&](std::ptrdiff_t limit, bool record)
+        {
+            std::fill(v.begin(), v.end(), 0);
+            std::ptrdiff_t edits = -1;
+            for (std::ptrdiff_t d = 0; d <= limit && edits < 0; ++d)
+            {
+                for (std::ptrdiff_t k = -d; k <= d; k += 2)
+                {
+                    std::ptrdiff_t x = (k == -d || (k != d && v[k - 1 + max_d + 1] < v[k + 1 + max_d + 1]))
+                        ? v[k + 1 + max_d + 1]
+                        : v[k - 1 + max_d + 1] + 1;
+                    std::ptrdiff_t y = x - k;
+                    while (x < n && y < m && equal(x, y))
+                    {
+                        ++x;
+                        ++y;
+                    }
+                    v[k + max_d + 1] = x;
+                    if (x >= n && y >= m)
+                    {
+                        edits = d;
+                    }
+                }
+                if (record)
+                {
+                    trace.insert(trace.end(), v.begin() + (max_d + 1 - d), v.begin() + (max_d + 2 + d));
+                }
+            }
+            return edits;
+        };
+
+        // The edits are counted before the search is repeated to record it for the walk back,
+        // so that arrays too different to align are given up on without building the trace
+        const std::ptrdiff_t edits = search(max_d, false);
+        if (edits < 0)
+        {
+            return false;
+        }
+        trace.reserve(static_cast<std::size_t>((edits + 1) * (edits + 1)));
+        if (search(edits, true) != edits)
+        {
+            return false; // equal answered differently the second time
+        }
+
+        // Walk back from the end, recording for each source and target element whether it
+        // is kept (aligned with an equal element) or removed/inserted
+        script.clear();
+        script.reserve(static_cast<std::size_t>(n + m));
+        std::ptrdiff_t x = n;
+        std::ptrdiff_t y = m;
+        for (std::ptrdiff_t d = edits; d > 0; --d)
+        {
+            // The slice for step d-1 starts at offset (d-1)^2 and covers diagonals -(d-1)..d-1
+            const std::ptrdiff_t* prev = trace.data() + (d - 1) * (d - 1) + (d - 1);
+            std::ptrdiff_t k = x - y;
+            bool inserted = (k == -d || (k != d && prev[k - 1] < prev[k + 1]));
+            std::ptrdiff_t prev_k = inserted ? k + 1 : k - 1;
+            std::ptrdiff_t prev_x = prev[prev_k];
+            std::ptrdiff_t prev_y = prev_x - prev_k;
+            while (x > prev_x + (inserted ? 0 : 1) && y > prev_y + (inserted ? 1 : 0))
+            {
+                script.push_back(edit_kind::keep);
+                --x;
+                --y;
+            }
+            script.push_back(inserted ? edit_kind::insert : edit_kind::remove);
+            x = prev_x;
+            y = prev_y;
+        }
+        while (x > 0)
+        {
+            script.push_back(edit_kind::keep);
+            --x;
+        }
+        std::reverse(script.begin(), script.end());
+        return true;
+    }
+
+    // Diffs source[first, source_last) against target[first, target_last) by aligning equal
+    // elements with shortest_edit_script. A removal and an insertion at the same place are
+    // diffed as a changed element. Returns false, having emitted nothing, if the arrays exceed
+    // max_edits or the limits above.
+    template <typename Json>
+    bool diff_aligned_array(const Json& source, const Json& target, std::size_t first,
+        std::size_t source_last, std::size_t target_last, const typename Json::string_view_type& path,
+        hashed_children<Json>& source_children, hashed_children<Json>& target_children, Json& result,
+        std::size_t max_edits = array_diff_max_edits)
+    {
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(source_last - first);
+        const std::ptrdiff_t m = static_cast<std::ptrdiff_t>(target_last - first);
+        if (n == 0 || m == 0)
+        {
+            return false; // positional diffing is already minimal
+        }
+        if (static_cast<std::size_t>(n + m) > array_diff_max_elements)
+        {
+            return false;
+        }
+
+        auto equal = [&](std::ptrdiff_t i, std::ptrdiff_t j)
+        {
+            return source_children.equal_element(first + i, target_children, first + j);
+        };
+
+        std::vector<edit_kind> script;
+        if (!shortest_edit_script(n, m, equal, script, max_edits))
+        {
+            return false;
+        }
+
+        // Operations are applied in order, so paths use the element's index in the array
+        // as it stands after the preceding operations
+        std::size_t index = first;
+        std::size_t source_index = first;
+        std::size_t target_index = first;
+        std::size_t pos = 0;
+        while (pos < script.size())
+        {
+            if (script[pos] == edit_kind::keep)
+            {
+                ++index;
+                ++source_index;
+                ++target_index;
+                ++pos;
+                continue;
+            }
+            std::size_t removed = 0;
+            std::size_t inserted = 0;
+            for (; pos < script.size() && script[pos] != edit_kind::keep; ++pos)
+            {
+                if (script[pos] == edit_kind::remove)
+                {
+                    ++removed;
+                }
+                else
+                {
+                    ++inserted;
+                }
+            }
+            std::size_t changed = (std::min)(removed, inserted);
+            for (std::size_t i = 0; i < changed; ++i)
+            {
+                if (!(source[source_index + i] == target[target_index + i]))
+                {
+                    diff_values(source[source_index + i], target[target_index + i], array_element_path<Json>(path, index),
+                        source_children[source_index + i], target_children[target_index + i], result);
+                }
+                ++index;
+            }
+            for (std::size_t i = changed; i < removed; ++i)
+            {
+                push_remove_op(result, array_element_path<Json>(path, index));
+            }
+            for (std::size_t i = changed; i < inserted; ++i)
+            {
+                push_add_op(result, array_element_path<Json>(path, index), target[target_index + i]);
+                ++index;
+            }
+            source_index += removed;
+            target_index += inserted;
+        }
+        return true;
+    }
 
-        if (source == target)
+    // Diffs source[first, last) against target[first, last), arrays of the same length. An
+    // insertion and a removal shift the elements between them, which a positional diff
+    // replaces one by one, so only where three or more elements in a row differ can aligning
+    // the arrays take fewer operations. Shorter runs of differences are diffed by position.
+    // A run that needs many edits to align has been reordered rather than shifted, and is no
+    // shorter aligned, so the search is given up once it would cost more than a few
+    // comparisons per element (d edits take about d*d/2).
+    template <typename Json>
+    void diff_same_size_array(const Json& source, const Json& target, std::size_t first, std::size_t last,
+        const typename Json::string_view_type& path,
+        hashed_children<Json>& source_children, hashed_children<Json>& target_children, Json& result)
+    {
+        std::size_t i = first;
+        while (i < last)
         {
-            return result;
+            std::size_t run_last = i + 1;
+            while (run_last < last && !(source[run_last] == target[run_last]))
+            {
+                ++run_last;
+            }
+            if (run_last - i < 3 ||
+                !diff_aligned_array(source, target, i, run_last, run_last, path, source_children, target_children, result,
+                                    static_cast<std::size_t>(std::sqrt(16.0 * static_cast<double>(run_last - i)))))
+            {
+                diff_positional_array(source, target, i, run_last, run_last, path, source_children, target_children, result, true);
+            }
+            i = run_last;
+            while (i < last && source[i] == target[i])
+            {
+                ++i;
+            }
         }
+    }
+
+    template <typename Json>
+    void diff_values(const Json& source, const Json& target, const typename Json::string_view_type& path,
+        hashed_value<Json> source_hashed, hashed_value<Json> target_hashed, Json& result)
+    {
+        using char_type = typename Json::char_type;
 
         if (source.is_array() && target.is_array())
         {
-            std::size_t common = (std::min)(source.size(),target.size());
-            for (std::size_t i = 0; i < common; ++i)
-            {
-                std::basic_string<char_type> ss(path); 
-                ss.push_back('/');
-                jsoncons::utility::from_integer(i,ss);
-                auto temp_diff = from_diff(source[i],target[i],ss);
-                result.insert(result.array_range().end(),temp_diff.array_range().begin(),temp_diff.array_range().end());
-            }
-            // Element in source, not in target - remove
-            for (std::size_t i = source.size(); i-- > target.size();)
-            {
-                std::basic_string<char_type> ss(path); 
-                ss.push_back('/');
-                jsoncons::utility::from_integer(i,ss);
-                Json val(json_object_arg);
-                val.insert_or_assign(jsonpatch_names<char_type>::op_name(), jsonpatch_names<char_type>::remove_name());
-                val.insert_or_assign(jsonpatch_names<char_type>::path_name(), ss);
-                result.push_back(std::move(val));
-            }
-            // Element in target, not in source - add, 
-            // Fix contributed by Alexander rog13
-            for (std::size_t i = source.size(); i < target.size(); ++i)
-            {
-                const auto& a = target[i];
-                std::basic_string<char_type> ss(path); 
-                ss.push_back('/');
-                jsoncons::utility::from_integer(i,ss);
-                Json val(json_object_arg);
-                val.insert_or_assign(jsonpatch_names<char_type>::op_name(), jsonpatch_names<char_type>::add_name());
-                val.insert_or_assign(jsonpatch_names<char_type>::path_name(), ss);
-                val.insert_or_assign(jsonpatch_names<char_type>::value_name(), a);
-                result.push_back(std::move(val));
+            // Elements that are equal at both ends need no operations, only the differing
+            // middle of the arrays is diffed
+            const std::size_t source_size = source.size();
+            const std::size_t target_size = target.size();
+            std::size_t prefix = 0;
+            while (prefix < source_size && prefix < target_size && source[prefix] == target[prefix])
+            {
+                ++prefix;
+            }
+            std::size_t suffix = 0;
+            while (suffix < source_size - prefix && suffix < target_size - prefix &&
+                   source[source_size - 1 - suffix] == target[target_size - 1 - suffix])
+            {
+                ++suffix;
+            }
+            hashed_children<Json> source_children(source, source_hashed);
+            hashed_children<Json> target_children(target, target_hashed);
+            if (source_size == target_size)
+            {
+                diff_same_size_array(source, target, prefix, source_size - suffix, path, source_children, target_children, result);
+            }
+            else if (!diff_aligned_array(source, target, prefix, source_size - suffix, target_size - suffix, path,
+                                         source_children, target_children, result))
+            {
+                diff_positional_array(source, target, prefix, source_size - suffix, target_size - suffix, path,
+                                      source_children, target_children, result);
             }
         }
         else if (source.is_object() && target.is_object())
         {
+            hashed_children<Json> source_children(source, source_hashed);
+            hashed_children<Json> target_children(target, target_hashed);
+            std::size_t i = 0;
             for (const auto& a : source.object_range())
             {
                 std::basic_string<char_type> ss(path);
@@ -259,8 +729,11 @@ namespace detail {
                 auto it = target.find(a.key());
                 if (it != target.object_range().end())
                 {
-                    auto temp_diff = from_diff(a.value(),(*it).value(),ss);
-                    result.insert(result.array_range().end(),temp_diff.array_range().begin(),temp_diff.array_range().end());
+                    if (!(a.value() == (*it).value()))
+                    {
+                        diff_values(a.value(),(*it).value(),ss,
+                            source_children[i], target_children[static_cast<std::size_t>(it - target.object_range().begin())], result);
+                    }
                 }
                 else
                 {
@@ -269,6 +742,7 @@ namespace detail {
                     val.insert_or_assign(jsonpatch_names<char_type>::path_name(), ss);
                     result.push_back(std::move(val));
                 }
+                ++i;
             }
             for (const auto& a : target.object_range())
             {
@@ -294,8 +768,6 @@ namespace detail {
             val.insert_or_assign(jsonpatch_names<char_type>::value_name(), target);
             result.push_back(std::move(val));
         }
-
-        return result;
     }
 
 } // namespace detail
@@ -316,6 +788,9 @@ void apply_patch(Json& target, const Json& patch, std::error_code& ec)
    jsoncons::jsonpatch::detail::operation_unwinder<Json> unwinder(target);
    std::error_code local_ec;
 
+    // Each operation logs at most one undo entry
+    unwinder.stack.reserve(patch.size());
+
     // Validate  
      
     for (const auto& operation : patch.array_range())
@@ -349,7 +824,7 @@ void apply_patch(Json& target, const Json& patch, std::error_code& ec)
 
         if (op ==jsoncons::jsonpatch::detail::jsonpatch_names<char_type>::test_name())
         {
-            Json val = jsonpointer::get(target,location,local_ec);
+            const Json& val = jsonpointer::get(target,location,local_ec);
             if (local_ec)
             {
                 ec = jsonpatch_errc::test_failed;
@@ -379,57 +854,56 @@ void apply_patch(Json& target, const Json& patch, std::error_code& ec)
                 unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                 return;
             }
-            Json val = it_value->value();
             auto npath = jsonpatch::detail::definite_path(target,location);
 
             std::error_code insert_ec;
-            jsonpointer::add_if_absent(target,npath,val,insert_ec); // try insert without replace
-            if (insert_ec) // try a replace
+            // Adding at the root replaces the document, so it is undone as a replace
+            if (!npath.empty())
+            {
+                jsonpointer::add_if_absent(target,npath,it_value->value(),insert_ec); // try insert without replace
+            }
+            if (npath.empty() || insert_ec) // replace
             {
                 std::error_code select_ec;
-                Json orig_val = jsonpointer::get(target,npath,select_ec);
+                Json& slot = jsonpointer::get(target,npath,select_ec);
                 if (select_ec) // shouldn't happen
                 {
                     ec = jsonpatch_errc::add_failed;
                     unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                     return;
                 }
-                std::error_code replace_ec;
-                jsonpointer::replace(target,npath,val,replace_ec);
-                if (replace_ec)
-                {
-                    ec = jsonpatch_errc::add_failed;
-                    unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
-                    return;
-                }
-                unwinder.stack.emplace_back(detail::op_type::replace,npath,orig_val);
+                Json orig_val = std::move(slot);
+                slot = it_value->value();
+                unwinder.stack.emplace_back(detail::op_type::replace,std::move(npath),std::move(orig_val));
             }
             else // insert without replace succeeded
             {
-                unwinder.stack.emplace_back(detail::op_type::remove,npath,Json::null());
+                unwinder.stack.emplace_back(detail::op_type::remove,std::move(npath),Json(null_type()));
             }
         }
         else if (op ==jsoncons::jsonpatch::detail::jsonpatch_names<char_type>::remove_name())
         {
-            Json val = jsonpointer::get(target,location,local_ec);
+            Json& slot = jsonpointer::get(target,location,local_ec);
             if (local_ec)
             {
                 ec = jsonpatch_errc::remove_failed;
                 unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                 return;
             }
+            Json val = std::move(slot);
             jsonpointer::remove(target,location,local_ec);
             if (local_ec)
             {
+                slot = std::move(val); // remove fails before changing anything
                 ec = jsonpatch_errc::remove_failed;
                 unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                 return;
             }
-            unwinder.stack.emplace_back(detail::op_type::add, location, val);
+            unwinder.stack.emplace_back(detail::op_type::add, std::move(location), std::move(val));
         }
         else if (op ==jsoncons::jsonpatch::detail::jsonpatch_names<char_type>::replace_name())
         {
-            Json val = jsonpointer::get(target,location,local_ec);
+            Json& slot = jsonpointer::get(target,location,local_ec);
             if (local_ec)
             {
                 ec = jsonpatch_errc::replace_failed;
@@ -443,14 +917,9 @@ void apply_patch(Json& target, const Json& patch, std::error_code& ec)
                 unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                 return;
             }
-            jsonpointer::replace(target, location, it_value->value(), local_ec);
-            if (local_ec)
-            {
-                ec = jsonpatch_errc::replace_failed;
-                unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
-                return;
-            }
-            unwinder.stack.emplace_back(detail::op_type::replace,location,val);
+            Json val = std::move(slot);
+            slot = it_value->value();
+            unwinder.stack.emplace_back(detail::op_type::replace,std::move(location),std::move(val));
         }
         else if (op ==jsoncons::jsonpatch::detail::jsonpatch_names<char_type>::move_name())
         {
@@ -470,48 +939,49 @@ void apply_patch(Json& target, const Json& patch, std::error_code& ec)
                 return;
             }
 
-            Json val = jsonpointer::get(target, from_pointer, local_ec);
+            Json& source = jsonpointer::get(target, from_pointer, local_ec);
             if (local_ec)
             {
                 ec = jsonpatch_errc::move_failed;
                 unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                 return;
             }
+            Json val = std::move(source);
             jsonpointer::remove(target, from_pointer, local_ec);
             if (local_ec)
             {
+                source = std::move(val); // remove fails before changing anything
                 ec = jsonpatch_errc::move_failed;
                 unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                 return;
             }
-            unwinder.stack.emplace_back(detail::op_type::add, from_pointer, val);
-            // add
+            // add, keeping val if it cannot be placed so it can go back to from
             std::error_code insert_ec;
             auto npath = jsonpatch::detail::definite_path(target,location);
-            jsonpointer::add_if_absent(target,npath,val,insert_ec); // try insert without replace
-            if (insert_ec) // try a replace
+            // Adding at the root replaces the document, so it is undone as a replace
+            if (!npath.empty())
+            {
+                jsonpointer::add_if_absent(target,npath,std::move(val),insert_ec); // try insert without replace
+            }
+            if (npath.empty() || insert_ec) // replace
             {
                 std::error_code select_ec;
-                Json orig_val = jsonpointer::get(target,npath,select_ec);
-                if (select_ec) // shouldn't happen
-                {
-                    ec = jsonpatch_errc::copy_failed;
-                    unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
-                    return;
-                }
-                std::error_code replace_ec;
-                jsonpointer::replace(target, npath, val, replace_ec);
-                if (replace_ec)
+                Json& slot = jsonpointer::get(target,npath,select_ec);
+                if (select_ec)
                 {
-                    ec = jsonpatch_errc::copy_failed;
+                    std::error_code restore_ec;
+                    jsonpointer::add(target, from_pointer, std::move(val), restore_ec);
+                    ec = jsonpatch_errc::move_failed;
                     unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                     return;
                 }
-                unwinder.stack.emplace_back(jsoncons::jsonpatch::detail::op_type::replace,npath,orig_val);
+                Json orig_val = std::move(slot);
+                slot = std::move(val);
+                unwinder.stack.emplace_back(detail::op_type::move_replace,std::move(npath),std::move(orig_val),std::move(from_pointer));
             }
             else
             {
-                unwinder.stack.emplace_back(detail::op_type::remove,npath,Json::null());
+                unwinder.stack.emplace_back(detail::op_type::move,std::move(npath),Json(null_type()),std::move(from_pointer));
             }
         }
         else if (op ==jsoncons::jsonpatch::detail::jsonpatch_names<char_type>::copy_name())
@@ -534,30 +1004,28 @@ void apply_patch(Json& target, const Json& patch, std::error_code& ec)
             // add
             auto npath = jsonpatch::detail::definite_path(target,location);
             std::error_code insert_ec;
-            jsonpointer::add_if_absent(target,npath,val,insert_ec); // try insert without replace
-            if (insert_ec) // Failed, try a replace
+            // Adding at the root replaces the document, so it is undone as a replace
+            if (!npath.empty())
+            {
+                jsonpointer::add_if_absent(target,npath,std::move(val),insert_ec); // try insert without replace
+            }
+            if (npath.empty() || insert_ec) // replace
             {
                 std::error_code select_ec;
-                Json orig_val = jsonpointer::get(target,npath, select_ec);
+                Json& slot = jsonpointer::get(target,npath, select_ec);
                 if (select_ec) // shouldn't happen
                 {
                     ec = jsonpatch_errc::copy_failed;
                     unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
                     return;
                 }
-                std::error_code replace_ec;
-                jsonpointer::replace(target, npath, val,replace_ec);
-                if (replace_ec)
-                {
-                    ec = jsonpatch_errc::copy_failed;
-                    unwinder.state =jsoncons::jsonpatch::detail::state_type::abort;
-                    return;
-                }
-                unwinder.stack.emplace_back(jsoncons::jsonpatch::detail::op_type::replace,npath,orig_val);
+                Json orig_val = std::move(slot);
+                slot = std::move(val);
+                unwinder.stack.emplace_back(jsoncons::jsonpatch::detail::op_type::replace,std::move(npath),std::move(orig_val));
             }
             else
             {
-                unwinder.stack.emplace_back(detail::op_type::remove,npath,Json::null());
+                unwinder.stack.emplace_back(detail::op_type::remove,std::move(npath),Json(null_type()));
             }
         }
     }
@@ -571,7 +1039,13 @@ template <typename Json>
 Json from_diff(const Json& source, const Json& target)
 {
     std::basic_string<typename Json::char_type> path;
-    return jsoncons::jsonpatch::detail::from_diff(source, target, path);
+    Json result = typename Json::array();
+    if (!(source == target))
+    {
+        jsoncons::jsonpatch::detail::diff_values(source, target, path,
+            jsoncons::jsonpatch::detail::hashed_value<Json>{nullptr, 0}, jsoncons::jsonpatch::detail::hashed_value<Json>{nullptr, 0}, result);
+    }
+    return result;
 }
 
 template <typename Json>
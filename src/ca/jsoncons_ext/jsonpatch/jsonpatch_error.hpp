@@ -25,7 +25,8 @@ namespace jsonpatch {
         remove_failed,
         replace_failed,
         move_failed,
-        copy_failed
+        copy_failed,
+        stream_unsupported
 
     };
 
@@ -55,6 +56,8 @@ namespace jsonpatch {
                     return "JSON Patch move operation failed";
                 case jsonpatch_errc::copy_failed:
                     return "JSON Patch copy operation failed";
+                case jsonpatch_errc::stream_unsupported:
+                    return "JSON Patch cannot be applied in a single pass";
                 default:
                     return "Unknown JSON Patch error";
             }
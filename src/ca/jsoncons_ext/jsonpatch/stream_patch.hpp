@@ -0,0 +1,639 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATCH_STREAM_PATCH_HPP
+#define JSONCONS_EXT_JSONPATCH_STREAM_PATCH_HPP
+
+#include <algorithm> // std::sort
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility> // std::move
+#include <vector>
+
+#include <jsoncons/config/jsoncons_config.hpp>
+#include <jsoncons/json_filter.hpp>
+#include <jsoncons/json_reader.hpp>
+#include <jsoncons/json_type.hpp>
+#include <jsoncons/json_visitor.hpp>
+#include <jsoncons/source.hpp>
+
+#include <jsoncons_ext/jsonpatch/jsonpatch.hpp>
+#include <jsoncons_ext/jsonpatch/jsonpatch_error.hpp>
+#include <jsoncons_ext/jsonpointer/jsonpointer.hpp>
+#include <jsoncons_ext/mergepatch/mergepatch.hpp>
+
+namespace jsoncons {
+namespace jsonpatch {
+
+namespace detail {
+
+    enum class stream_edit_kind { descend, assign, remove };
+
+    // One node of the edit tree a patch is compiled into before streaming. A descend node holds
+    // the edits below a container, keyed by member name (or "-" for an append to an array); a
+    // leaf assigns or removes the value it is reached by. Nodes point into the patch, which must
+    // outlive the tree.
+    template <typename Json>
+    struct stream_edit
+    {
+        using string_type = std::basic_string<typename Json::char_type>;
+
+        stream_edit_kind kind = stream_edit_kind::descend;
+        bool must_exist = false;                        // fail with errc when the target is missing
+        jsonpatch_errc errc = jsonpatch_errc::success;
+        std::vector<const Json*> values;                // assigned values; appends keep them all
+        const Json* merge_patch = nullptr;              // set when the value is merged member by member
+        std::map<string_type, std::unique_ptr<stream_edit>> children;
+        std::size_t order = 0;                          // position among its parent's edits in the patch
+        bool applied = false;
+    };
+
+    // Builds the edit tree for the add, replace and remove operations of a JSON Patch. Other
+    // operations, operations on the root, and operations whose paths overlap (other than
+    // repeated adds to one path, such as several appends to an array) depend on the order they
+    // are applied in and are reported as stream_unsupported. Edits by array index look like
+    // member names here and are only rejected by stream_edit_filter once it reaches the array.
+    template <typename Json>
+    std::unique_ptr<stream_edit<Json>> make_stream_patch_edits(const Json& patch, std::error_code& ec)
+    {
+        using char_type = typename Json::char_type;
+        using string_type = std::basic_string<char_type>;
+        using names = jsonpatch_names<char_type>;
+        using edit_type = stream_edit<Json>;
+
+        auto root = jsoncons::make_unique<edit_type>();
+        root->must_exist = true;
+        if (!patch.is_array())
+        {
+            ec = jsonpatch_errc::invalid_patch;
+            return nullptr;
+        }
+
+        for (const auto& operation : patch.array_range())
+        {
+            if (!operation.is_object())
+            {
+                ec = jsonpatch_errc::invalid_patch;
+                return nullptr;
+            }
+            auto it_op = operation.find(names::op_name());
+            auto it_path = operation.find(names::path_name());
+            if (it_op == operation.object_range().end() || it_path == operation.object_range().end() ||
+                !it_op->value().is_string() || !it_path->value().is_string())
+            {
+                ec = jsonpatch_errc::invalid_patch;
+                return nullptr;
+            }
+            string_type op = it_op->value().template as<string_type>();
+
+            stream_edit_kind kind;
+            jsonpatch_errc errc;
+            bool must_exist = true;
+            if (op == names::add_name())
+            {
+                kind = stream_edit_kind::assign;
+                errc = jsonpatch_errc::add_failed;
+                must_exist = false;
+            }
+            else if (op == names::replace_name())
+            {
+                kind = stream_edit_kind::assign;
+                errc = jsonpatch_errc::replace_failed;
+            }
+            else if (op == names::remove_name())
+            {
+                kind = stream_edit_kind::remove;
+                errc = jsonpatch_errc::remove_failed;
+            }
+            else
+            {
+                ec = jsonpatch_errc::stream_unsupported;
+                return nullptr;
+            }
+
+            const Json* value = nullptr;
+            if (kind == stream_edit_kind::assign)
+            {
+                auto it_value = operation.find(names::value_name());
+                if (it_value == operation.object_range().end())
+                {
+                    ec = jsonpatch_errc::invalid_patch;
+                    return nullptr;
+                }
+                value = std::addressof(it_value->value());
+            }
+
+            std::error_code parse_ec;
+            auto location = jsonpointer::basic_json_pointer<char_type>::parse(it_path->value().template as<string_type>(), parse_ec);
+            if (parse_ec)
+            {
+                ec = jsonpatch_errc::invalid_patch;
+                return nullptr;
+            }
+            if (location.empty())
+            {
+                ec = jsonpatch_errc::stream_unsupported;
+                return nullptr;
+            }
+
+            if (root->errc == jsonpatch_errc::success)
+            {
+                root->errc = errc;
+            }
+            edit_type* parent = root.get();
+            for (auto it = location.begin(); it != location.rbegin().base() - 1; ++it)
+            {
+                auto& child = parent->children[*it];
+                if (!child)
+                {
+                    child = jsoncons::make_unique<edit_type>();
+                    child->order = parent->children.size();
+                    child->must_exist = true;
+                    child->errc = errc;
+                }
+                else if (child->kind != stream_edit_kind::descend)
+                {
+                    ec = jsonpatch_errc::stream_unsupported;
+                    return nullptr;
+                }
+                parent = child.get();
+            }
+
+            auto& leaf = parent->children[*location.rbegin()];
+            if (!leaf)
+            {
+                leaf = jsoncons::make_unique<edit_type>();
+                leaf->order = parent->children.size();
+                leaf->kind = kind;
+                leaf->must_exist = must_exist;
+                leaf->errc = errc;
+            }
+            else if (leaf->kind != stream_edit_kind::assign || leaf->must_exist || kind != stream_edit_kind::assign || must_exist)
+            {
+                ec = jsonpatch_errc::stream_unsupported;
+                return nullptr;
+            }
+            if (value != nullptr)
+            {
+                leaf->values.push_back(value);
+            }
+        }
+        return root;
+    }
+
+    // Builds the edits for a merge patch object below node, following RFC 7396: null removes a
+    // member, an object is merged into it and anything else replaces it.
+    template <typename Json>
+    void add_stream_merge_edits(stream_edit<Json>& node, const Json& patch)
+    {
+        using edit_type = stream_edit<Json>;
+
+        node.merge_patch = std::addressof(patch);
+        for (const auto& member : patch.object_range())
+        {
+            auto child = jsoncons::make_unique<edit_type>();
+            child->order = node.children.size();
+            if (member.value().is_null())
+            {
+                child->kind = stream_edit_kind::remove;
+            }
+            else if (member.value().is_object())
+            {
+                add_stream_merge_edits(*child, member.value());
+            }
+            else
+            {
+                child->kind = stream_edit_kind::assign;
+                child->values.push_back(std::addressof(member.value()));
+            }
+            node.children.emplace(typename edit_type::string_type(member.key()), std::move(child));
+        }
+    }
+
+    template <typename Json>
+    std::unique_ptr<stream_edit<Json>> make_stream_merge_edits(const Json& patch)
+    {
+        auto root = jsoncons::make_unique<stream_edit<Json>>();
+        if (patch.is_object())
+        {
+            add_stream_merge_edits(*root, patch);
+        }
+        else
+        {
+            root->kind = stream_edit_kind::assign;
+            root->values.push_back(std::addressof(patch));
+        }
+        return root;
+    }
+
+    // Passes the events of a document through to a destination, applying an edit tree on the
+    // way: edited members are replaced or dropped as they are read, and edits whose targets
+    // never appear are completed when their container ends. Only the stack of open containers is
+    // kept, so memory is bounded by the nesting depth of the document and the size of the patch.
+    template <typename Json>
+    class stream_edit_filter : public basic_json_visitor<typename Json::char_type>
+    {
+    public:
+        using char_type = typename Json::char_type;
+        using typename basic_json_visitor<char_type>::string_view_type;
+        using edit_type = stream_edit<Json>;
+    private:
+        using child_type = typename decltype(edit_type::children)::value_type;
+
+        // Forwards a dumped value without the flush that ends Json::dump
+        class value_filter : public basic_json_filter<char_type>
+        {
+        public:
+            using basic_json_filter<char_type>::basic_json_filter;
+        private:
+            void visit_flush() override
+            {
+            }
+        };
+
+        basic_json_visitor<char_type>& destination_;
+        value_filter value_destination_;
+        std::vector<edit_type*> stack_;  // the edits of each open container, null when it passes through
+        edit_type* pending_;             // the edit for the next value
+        std::size_t skip_depth_;         // nesting within a value being replaced or dropped
+        typename edit_type::string_type key_;  // the member name being looked up
+        std::vector<const child_type*> missing_;  // the members complete_object adds
+
+    public:
+        stream_edit_filter(edit_type& root, basic_json_visitor<char_type>& destination)
+            : destination_(destination), value_destination_(destination), pending_(std::addressof(root)), skip_depth_(0)
+        {
+        }
+
+    private:
+        edit_type* take_pending()
+        {
+            edit_type* edit = pending_;
+            pending_ = nullptr;
+            return edit;
+        }
+
+        void emit_merged(const edit_type& edit, std::error_code& ec)
+        {
+            Json merged(json_object_arg);
+            mergepatch::apply_merge_patch(merged, *edit.merge_patch);
+            merged.dump(value_destination_, ec);
+        }
+
+        // The value an assign or remove edit is reached by is replaced by the assigned value, or dropped
+        void replace_value(edit_type& edit, std::error_code& ec)
+        {
+            edit.applied = true;
+            if (edit.kind == stream_edit_kind::assign)
+            {
+                edit.values.back()->dump(value_destination_, ec);
+            }
+        }
+
+        // Applies the edit for a scalar; returns true when the scalar passes through unchanged
+        bool begin_scalar(std::error_code& ec)
+        {
+            if (skip_depth_ > 0)
+            {
+                return false;
+            }
+            edit_type* edit = take_pending();
+            if (edit == nullptr)
+            {
+                return true;
+            }
+            if (edit->kind != stream_edit_kind::descend)
+            {
+                replace_value(*edit, ec);
+            }
+            else if (edit->merge_patch != nullptr)
+            {
+                // Merging an object into anything but an object replaces it
+                edit->applied = true;
+                emit_merged(*edit, ec);
+            }
+            else
+            {
+                ec = edit->errc;
+            }
+            return false;
+        }
+
+        // Adds the members of an object that edits target but the document did not have, in the
+        // order the patch gives them, as applying the patch to a document that keeps member order
+        // would
+        void complete_object(edit_type& edit, const ser_context& context, std::error_code& ec)
+        {
+            missing_.clear();
+            for (auto& child : edit.children)
+            {
+                if (!child.second->applied)
+                {
+                    missing_.push_back(std::addressof(child));
+                }
+            }
+            std::sort(missing_.begin(), missing_.end(),
+                [](const child_type* a, const child_type* b) { return a->second->order < b->second->order; });
+
+            for (const child_type* child : missing_)
+            {
+                edit_type& member = *child->second;
+                member.applied = true;
+                if (member.kind == stream_edit_kind::assign && !member.must_exist)
+                {
+                    destination_.key(string_view_type(child->first.data(), child->first.size()), context, ec);
+                    if (!ec)
+                    {
+                        member.values.back()->dump(value_destination_, ec);
+                    }
+                }
+                else if (member.merge_patch != nullptr)
+                {
+                    destination_.key(string_view_type(child->first.data(), child->first.size()), context, ec);
+                    if (!ec)
+                    {
+                        emit_merged(member, ec);
+                    }
+                }
+                else if (member.must_exist)
+                {
+                    ec = member.errc;
+                }
+                if (ec)
+                {
+                    return;
+                }
+            }
+        }
+
+        // Arrays are only edited by appending to them; edits of their elements would need the
+        // element positions the edits before them leave behind
+        static bool is_append(const edit_type& edit)
+        {
+            if (edit.children.size() != 1)
+            {
+                return false;
+            }
+            const auto& child = *edit.children.begin();
+            return child.first == jsonpatch_names<char_type>::dash_name() &&
+                child.second->kind == stream_edit_kind::assign && !child.second->must_exist;
+        }
+
+        void visit_flush() override
+        {
+            destination_.flush();
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_begin_object(semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (skip_depth_ > 0)
+            {
+                ++skip_depth_;
+                JSONCONS_VISITOR_RETURN;
+            }
+            edit_type* edit = take_pending();
+            if (edit != nullptr && edit->kind != stream_edit_kind::descend)
+            {
+                replace_value(*edit, ec);
+                skip_depth_ = 1;
+                JSONCONS_VISITOR_RETURN;
+            }
+            if (edit != nullptr)
+            {
+                edit->applied = true;
+            }
+            stack_.push_back(edit);
+            destination_.begin_object(tag, context, ec);
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_end_object(const ser_context& context, std::error_code& ec) override
+        {
+            if (skip_depth_ > 0)
+            {
+                --skip_depth_;
+                JSONCONS_VISITOR_RETURN;
+            }
+            edit_type* edit = stack_.back();
+            stack_.pop_back();
+            if (edit != nullptr)
+            {
+                complete_object(*edit, context, ec);
+                if (ec)
+                {
+                    JSONCONS_VISITOR_RETURN;
+                }
+            }
+            destination_.end_object(context, ec);
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_begin_array(semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (skip_depth_ > 0)
+            {
+                ++skip_depth_;
+                JSONCONS_VISITOR_RETURN;
+            }
+            edit_type* edit = take_pending();
+            if (edit != nullptr && edit->kind != stream_edit_kind::descend)
+            {
+                replace_value(*edit, ec);
+                skip_depth_ = 1;
+                JSONCONS_VISITOR_RETURN;
+            }
+            if (edit != nullptr && edit->merge_patch != nullptr)
+            {
+                edit->applied = true;
+                emit_merged(*edit, ec);
+                skip_depth_ = 1;
+                JSONCONS_VISITOR_RETURN;
+            }
+            if (edit != nullptr)
+            {
+                if (!is_append(*edit))
+                {
+                    ec = jsonpatch_errc::stream_unsupported;
+                    JSONCONS_VISITOR_RETURN;
+                }
+                edit->applied = true;
+            }
+            stack_.push_back(edit);
+            destination_.begin_array(tag, context, ec);
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_end_array(const ser_context& context, std::error_code& ec) override
+        {
+            if (skip_depth_ > 0)
+            {
+                --skip_depth_;
+                JSONCONS_VISITOR_RETURN;
+            }
+            edit_type* edit = stack_.back();
+            stack_.pop_back();
+            if (edit != nullptr)
+            {
+                edit_type& append = *edit->children.begin()->second;
+                append.applied = true;
+                for (const Json* value : append.values)
+                {
+                    value->dump(value_destination_, ec);
+                    if (ec)
+                    {
+                        JSONCONS_VISITOR_RETURN;
+                    }
+                }
+            }
+            destination_.end_array(context, ec);
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_key(const string_view_type& name, const ser_context& context, std::error_code& ec) override
+        {
+            if (skip_depth_ > 0)
+            {
+                JSONCONS_VISITOR_RETURN;
+            }
+            edit_type* parent = stack_.back();
+            if (parent != nullptr)
+            {
+                key_.assign(name.data(), name.size());
+                auto it = parent->children.find(key_);
+                if (it != parent->children.end())
+                {
+                    pending_ = it->second.get();
+                    if (pending_->kind == stream_edit_kind::remove)
+                    {
+                        // The member is dropped with its value
+                        JSONCONS_VISITOR_RETURN;
+                    }
+                }
+            }
+            destination_.key(name, context, ec);
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_null(semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.null_value(tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_bool(bool value, semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.bool_value(value, tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_string(const string_view_type& value, semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.string_value(value, tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_byte_string(const byte_string_view& value, semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.byte_string_value(value, tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_uint64(uint64_t value, semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.uint64_value(value, tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_int64(int64_t value, semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.int64_value(value, tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+
+        JSONCONS_VISITOR_RETURN_TYPE visit_double(double value, semantic_tag tag, const ser_context& context, std::error_code& ec) override
+        {
+            if (begin_scalar(ec))
+            {
+                destination_.double_value(value, tag, context, ec);
+            }
+            JSONCONS_VISITOR_RETURN;
+        }
+    };
+
+    template <typename Json>
+    void stream_apply_edits(std::basic_istream<typename Json::char_type>& is, stream_edit<Json>& root,
+        basic_json_visitor<typename Json::char_type>& visitor, std::error_code& ec)
+    {
+        using char_type = typename Json::char_type;
+
+        stream_edit_filter<Json> filter(root, visitor);
+        basic_json_reader<char_type,stream_source<char_type>> reader(is, filter);
+        reader.read(ec);
+    }
+
+} // namespace detail
+
+    // Reads a document from is and writes it to visitor with a JSON Patch applied, without
+    // building the document. The add, replace and remove operations are supported, with array
+    // edits limited to appends ("-"); other operations, and operations whose paths overlap,
+    // report jsonpatch_errc::stream_unsupported before anything is written. An index into an
+    // array cannot be told from a member name until the array is read, so an array edit other
+    // than an append reports stream_unsupported when its array is reached, and an operation
+    // whose target is missing reports the error apply_patch would when its container ends;
+    // either way part of the output has been written and should be discarded. Members keep the
+    // order they are read in, and added members follow them in the order of the patch.
+    template <typename Json>
+    void stream_apply_patch(std::basic_istream<typename Json::char_type>& is, const Json& patch,
+        basic_json_visitor<typename Json::char_type>& visitor, std::error_code& ec)
+    {
+        auto root = detail::make_stream_patch_edits(patch, ec);
+        if (ec)
+        {
+            return;
+        }
+        detail::stream_apply_edits(is, *root, visitor, ec);
+    }
+
+} // namespace jsonpatch
+
+namespace mergepatch {
+
+    // Reads a document from is and writes it to visitor with a merge patch applied, without
+    // building the document. Every merge patch can be applied in one pass. Members keep the
+    // order they are read in, and added members follow them in the order of the patch.
+    template <typename Json>
+    void stream_apply_merge_patch(std::basic_istream<typename Json::char_type>& is, const Json& patch,
+        basic_json_visitor<typename Json::char_type>& visitor, std::error_code& ec)
+    {
+        auto root = jsonpatch::detail::make_stream_merge_edits(patch);
+        jsonpatch::detail::stream_apply_edits(is, *root, visitor, ec);
+    }
+
+} // namespace mergepatch
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATCH_STREAM_PATCH_HPP
@@ -0,0 +1,568 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATCH_STRUCTURAL_DIFF_HPP
+#define JSONCONS_EXT_JSONPATCH_STRUCTURAL_DIFF_HPP
+
+#include <algorithm> // std::sort, std::is_sorted, std::lower_bound
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory> // std::addressof
+#include <string>
+#include <type_traits> // std::remove_reference
+#include <unordered_map>
+#include <utility> // std::forward
+#include <vector>
+
+#include <jsoncons/json_type.hpp>
+#include <jsoncons/utility/write_number.hpp>
+
+#include <jsoncons_ext/jsonpatch/jsonpatch.hpp>
+#include <jsoncons_ext/jsonpatch/structural_index.hpp>
+#include <jsoncons_ext/jsonpointer/jsonpointer.hpp>
+
+namespace jsoncons {
+namespace jsonpatch {
+
+namespace detail {
+
+    // Diffs two indexed documents into JSON Patch operations, handed to the callback one at a
+    // time. Subtrees with equal hashes are skipped without being visited, so the work done
+    // follows the changed paths: the members or elements of each container on them, and the
+    // values added or replaced. A member removed from an object and one added to it with an
+    // equal value, and likewise an element removed from an array and one inserted into it, are
+    // emitted as a move.
+    template <typename Json,typename Callback>
+    class structural_differ
+    {
+        using char_type = typename Json::char_type;
+        using string_type = std::basic_string<char_type>;
+        using string_view_type = typename Json::string_view_type;
+        using index_type = structural_index<Json>;
+
+        static constexpr std::size_t npos = (std::numeric_limits<std::size_t>::max)();
+
+        // A value with its index entry, or npos if it is not an array or object
+        struct node
+        {
+            const Json* value;
+            std::size_t entry;
+            string_view_type key; // for object members
+        };
+
+        const index_type& source_;
+        const index_type& target_;
+        Callback& callback_;
+        string_type path_;
+    public:
+        structural_differ(const index_type& source, const index_type& target, Callback& callback)
+            : source_(source), target_(target), callback_(callback)
+        {
+        }
+
+        void diff()
+        {
+            diff(root(source_), root(target_));
+        }
+    private:
+        static node root(const index_type& index)
+        {
+            return node{std::addressof(index.root()), is_container(index.root()) ? 0 : npos, string_view_type()};
+        }
+
+        static void children(const index_type& index, const node& parent, std::vector<node>& result)
+        {
+            result.reserve(parent.value->size());
+            std::size_t e = parent.entry + 1;
+            auto add = [&](const Json& val, const string_view_type& key)
+            {
+                if (is_container(val))
+                {
+                    result.push_back(node{std::addressof(val), e, key});
+                    e = index.next(e);
+                }
+                else
+                {
+                    result.push_back(node{std::addressof(val), npos, key});
+                }
+            };
+            if (parent.value->is_object())
+            {
+                for (const auto& member : parent.value->object_range())
+                {
+                    add(member.value(), member.key());
+                }
+            }
+            else
+            {
+                for (const auto& element : parent.value->array_range())
+                {
+                    add(element, string_view_type());
+                }
+            }
+        }
+
+        std::uint64_t source_hash(const node& n) const
+        {
+            return n.entry != npos ? source_.hash(n.entry) : scalar_hash(*n.value);
+        }
+
+        std::uint64_t target_hash(const node& n) const
+        {
+            return n.entry != npos ? target_.hash(n.entry) : scalar_hash(*n.value);
+        }
+
+        bool same(const node& s, const node& t) const
+        {
+            if (s.entry != npos || t.entry != npos)
+            {
+                return s.entry != npos && t.entry != npos && source_.hash(s.entry) == target_.hash(t.entry);
+            }
+            return *s.value == *t.value;
+        }
+
+        void diff(const node& s, const node& t)
+        {
+            if (same(s, t))
+            {
+                return;
+            }
+            if (s.entry != npos && t.entry != npos && s.value->type() == t.value->type())
+            {
+                if (s.value->is_object())
+                {
+                    diff_objects(s, t);
+                }
+                else
+                {
+                    diff_arrays(s, t);
+                }
+            }
+            else
+            {
+                emit(jsonpatch_names<char_type>::replace_name(), nullptr, t.value);
+            }
+        }
+
+        // Pairs removed source values with inserted target values that are equal to them.
+        // moved_to[r] and moved_from[i] are set for each pair, by position in removed and
+        // inserted.
+        void pair_moves(const std::vector<node>& removed, const std::vector<node>& inserted,
+                        std::vector<std::size_t>& moved_to, std::vector<std::size_t>& moved_from) const
+        {
+            moved_to.assign(removed.size(), npos);
+            moved_from.assign(inserted.size(), npos);
+
+            struct bucket
+            {
+                std::vector<std::size_t> items;
+                std::size_t next = 0; // items before next are all paired
+            };
+            std::unordered_map<std::uint64_t,bucket> buckets;
+            for (std::size_t r = 0; r < removed.size(); ++r)
+            {
+                buckets[source_hash(removed[r])].items.push_back(r);
+            }
+            for (std::size_t i = 0; i < inserted.size(); ++i)
+            {
+                auto it = buckets.find(target_hash(inserted[i]));
+                if (it == buckets.end())
+                {
+                    continue;
+                }
+                bucket& b = it->second;
+                for (std::size_t k = b.next; k < b.items.size(); ++k)
+                {
+                    const std::size_t r = b.items[k];
+                    if (moved_to[r] == npos && same(removed[r], inserted[i]))
+                    {
+                        moved_to[r] = i;
+                        moved_from[i] = r;
+                        break;
+                    }
+                }
+                while (b.next < b.items.size() && moved_to[b.items[b.next]] != npos)
+                {
+                    ++b.next;
+                }
+            }
+        }
+
+        void diff_objects(const node& s, const node& t)
+        {
+            std::vector<node> source_children;
+            std::vector<node> target_children;
+            children(source_, s, source_children);
+            children(target_, t, target_children);
+
+            // Target members by key, for finding the source members in them
+            std::vector<std::size_t> order(target_children.size());
+            for (std::size_t j = 0; j < order.size(); ++j)
+            {
+                order[j] = j;
+            }
+            auto less = [&](std::size_t a, std::size_t b) {return target_children[a].key < target_children[b].key;};
+            if (!std::is_sorted(order.begin(), order.end(), less))
+            {
+                std::sort(order.begin(), order.end(), less);
+            }
+
+            std::vector<std::size_t> match(source_children.size(), npos);
+            std::vector<bool> matched(target_children.size(), false);
+            std::vector<node> removed;
+            std::vector<std::size_t> removed_members;
+            for (std::size_t i = 0; i < source_children.size(); ++i)
+            {
+                const string_view_type key = source_children[i].key;
+                auto it = std::lower_bound(order.begin(), order.end(), key,
+                    [&](std::size_t j, const string_view_type& k) {return target_children[j].key < k;});
+                if (it != order.end() && target_children[*it].key == key)
+                {
+                    match[i] = *it;
+                    matched[*it] = true;
+                }
+                else
+                {
+                    removed.push_back(source_children[i]);
+                    removed_members.push_back(i);
+                }
+            }
+            std::vector<node> inserted;
+            for (std::size_t j = 0; j < target_children.size(); ++j)
+            {
+                if (!matched[j])
+                {
+                    inserted.push_back(target_children[j]);
+                }
+            }
+            std::vector<std::size_t> moved_to;
+            std::vector<std::size_t> moved_from;
+            pair_moves(removed, inserted, moved_to, moved_from);
+
+            const std::size_t length = path_.size();
+            std::size_t r = 0;
+            for (std::size_t i = 0; i < source_children.size(); ++i)
+            {
+                push_member(source_children[i].key);
+                if (match[i] != npos)
+                {
+                    diff(source_children[i], target_children[match[i]]);
+                }
+                else if (moved_to[r++] == npos)
+                {
+                    emit(jsonpatch_names<char_type>::remove_name(), nullptr, nullptr);
+                }
+                path_.resize(length);
+            }
+            for (std::size_t i = 0; i < inserted.size(); ++i)
+            {
+                push_member(inserted[i].key);
+                if (moved_from[i] != npos)
+                {
+                    string_type from(path_, 0, length);
+                    from.push_back('/');
+                    jsonpointer::escape(removed[moved_from[i]].key, from);
+                    emit(jsonpatch_names<char_type>::move_name(), &from, nullptr);
+                }
+                else
+                {
+                    emit(jsonpatch_names<char_type>::add_name(), nullptr, inserted[i].value);
+                }
+                path_.resize(length);
+            }
+        }
+
+        void diff_arrays(const node& s, const node& t)
+        {
+            std::vector<node> source_children;
+            std::vector<node> target_children;
+            children(source_, s, source_children);
+            children(target_, t, target_children);
+
+            // Elements that are equal at both ends need no operations
+            const std::size_t source_size = source_children.size();
+            const std::size_t target_size = target_children.size();
+            std::size_t first = 0;
+            while (first < source_size && first < target_size && same(source_children[first], target_children[first]))
+            {
+                ++first;
+            }
+            std::size_t suffix = 0;
+            while (suffix < source_size - first && suffix < target_size - first &&
+                   same(source_children[source_size - 1 - suffix], target_children[target_size - 1 - suffix]))
+            {
+                ++suffix;
+            }
+            const std::size_t source_last = source_size - suffix;
+            const std::size_t target_last = target_size - suffix;
+
+            const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(source_last - first);
+            const std::ptrdiff_t m = static_cast<std::ptrdiff_t>(target_last - first);
+            // Elements compare by hash, so unlike jsonpatch::from_diff only the number of
+            // comparisons limits the arrays that are aligned
+            std::vector<edit_kind> script;
+            if (n > 0 && m > 0 &&
+                shortest_edit_script(n, m, [&](std::ptrdiff_t i, std::ptrdiff_t j) {return same(source_children[first + i], target_children[first + j]);}, script))
+            {
+                diff_aligned(source_children, target_children, first, script);
+                return;
+            }
+
+            // Positionally, as jsonpatch::from_diff does
+            const std::size_t common = first + (std::min)(source_last - first, target_last - first);
+            const std::size_t length = path_.size();
+            for (std::size_t i = first; i < common; ++i)
+            {
+                push_index(i);
+                diff(source_children[i], target_children[i]);
+                path_.resize(length);
+            }
+            for (std::size_t i = source_last; i-- > target_last;)
+            {
+                push_index(i);
+                emit(jsonpatch_names<char_type>::remove_name(), nullptr, nullptr);
+                path_.resize(length);
+            }
+            for (std::size_t i = source_last; i < target_last; ++i)
+            {
+                push_index(i);
+                emit(jsonpatch_names<char_type>::add_name(), nullptr, target_children[i].value);
+                path_.resize(length);
+            }
+        }
+
+        // Emits the script for source[first, ...) and target[first, ...). Each run of removals
+        // and insertions between kept elements is emitted removals first. A removed element that
+        // moves to an insertion emitted after it is left in place until then; one that moves to
+        // an insertion emitted before it is moved out of the elements still ahead. Otherwise a
+        // run's plain removals are diffed against its leading plain insertions, as changed
+        // elements, and the rest are removed or added.
+        void diff_aligned(const std::vector<node>& source_children, const std::vector<node>& target_children,
+                          std::size_t first, const std::vector<edit_kind>& script)
+        {
+            // Removed and inserted elements in script order
+            std::vector<node> removed;
+            std::vector<node> inserted;
+            std::vector<std::size_t> removed_index; // source positions of the removed elements
+            {
+                std::size_t source = first;
+                std::size_t target = first;
+                for (edit_kind kind : script)
+                {
+                    switch (kind)
+                    {
+                        case edit_kind::keep:
+                            ++source;
+                            ++target;
+                            break;
+                        case edit_kind::remove:
+                            removed.push_back(source_children[source]);
+                            removed_index.push_back(source++);
+                            break;
+                        case edit_kind::insert:
+                            inserted.push_back(target_children[target++]);
+                            break;
+                    }
+                }
+            }
+            std::vector<std::size_t> moved_to;
+            std::vector<std::size_t> moved_from;
+            pair_moves(removed, inserted, moved_to, moved_from);
+
+            std::vector<std::size_t> changed_to(removed.size(), npos);
+            std::vector<bool> changed(inserted.size(), false);
+
+            std::vector<bool> moved_ahead(removed.size(), false); // moved out before being reached
+            std::vector<std::pair<std::size_t,std::size_t>> left; // (removed, position) left in place until moved
+            std::vector<std::size_t> ahead;                       // removed elements moved out so far
+
+            const std::size_t length = path_.size();
+            std::size_t index = first;  // where the next element goes
+            std::size_t source = first; // the next source element not yet reached
+            std::size_t r = 0; // next removed element
+            std::size_t i = 0; // next inserted element
+            std::size_t pos = 0;
+            while (pos < script.size())
+            {
+                if (script[pos] == edit_kind::keep)
+                {
+                    ++index;
+                    ++source;
+                    ++pos;
+                    continue;
+                }
+                std::size_t end = pos;
+                std::size_t removals = 0;
+                std::size_t insertions = 0;
+                for (; end < script.size() && script[end] != edit_kind::keep; ++end)
+                {
+                    (script[end] == edit_kind::remove ? removals : insertions) += 1;
+                }
+
+                // Pair the run's plain removals with its leading plain insertions
+                {
+                    std::size_t pr = r;
+                    for (std::size_t pi = i; pi < i + insertions && moved_from[pi] == npos; ++pi)
+                    {
+                        while (pr < r + removals && (moved_to[pr] != npos || moved_ahead[pr]))
+                        {
+                            ++pr;
+                        }
+                        if (pr == r + removals)
+                        {
+                            break;
+                        }
+                        changed_to[pr++] = pi;
+                        changed[pi] = true;
+                    }
+                }
+
+                for (const std::size_t last = r + removals; r < last; ++r, ++source)
+                {
+                    if (moved_ahead[r])
+                    {
+                        continue;
+                    }
+                    if (moved_to[r] != npos)
+                    {
+                        left.emplace_back(r, index++);
+                    }
+                    else if (changed_to[r] != npos)
+                    {
+                        push_index(index++);
+                        diff(removed[r], inserted[changed_to[r]]);
+                        path_.resize(length);
+                    }
+                    else
+                    {
+                        push_index(index);
+                        emit(jsonpatch_names<char_type>::remove_name(), nullptr, nullptr);
+                        path_.resize(length);
+                    }
+                }
+
+                for (const std::size_t last = i + insertions; i < last; ++i)
+                {
+                    if (changed[i])
+                    {
+                        continue;
+                    }
+                    const std::size_t from = moved_from[i];
+                    if (from == npos)
+                    {
+                        push_index(index++);
+                        emit(jsonpatch_names<char_type>::add_name(), nullptr, inserted[i].value);
+                        path_.resize(length);
+                    }
+                    else if (from < r)
+                    {
+                        // Left in place earlier; later elements close up behind it
+                        std::size_t at = 0;
+                        for (std::size_t k = 0; k < left.size(); ++k)
+                        {
+                            if (left[k].first == from)
+                            {
+                                at = left[k].second;
+                                left.erase(left.begin() + static_cast<std::ptrdiff_t>(k));
+                                break;
+                            }
+                        }
+                        for (auto& l : left)
+                        {
+                            if (l.second > at)
+                            {
+                                --l.second;
+                            }
+                        }
+                        emit_move(length, at, index - 1);
+                    }
+                    else
+                    {
+                        // Still ahead, past the elements before it that have not been moved out
+                        std::size_t at = index + (removed_index[from] - source);
+                        for (std::size_t k : ahead)
+                        {
+                            if (k >= source && k < removed_index[from])
+                            {
+                                --at;
+                            }
+                        }
+                        emit_move(length, at, index++);
+                        moved_ahead[from] = true;
+                        ahead.push_back(removed_index[from]);
+                    }
+                }
+                pos = end;
+            }
+        }
+
+        void emit_move(std::size_t length, std::size_t from_index, std::size_t to_index)
+        {
+            string_type from(path_, 0, length);
+            from.push_back('/');
+            jsoncons::utility::from_integer(from_index, from);
+            push_index(to_index);
+            emit(jsonpatch_names<char_type>::move_name(), &from, nullptr);
+            path_.resize(length);
+        }
+
+        void push_member(const string_view_type& key)
+        {
+            path_.push_back('/');
+            jsonpointer::escape(key, path_);
+        }
+
+        void push_index(std::size_t index)
+        {
+            path_.push_back('/');
+            jsoncons::utility::from_integer(index, path_);
+        }
+
+        void emit(const string_type& op, const string_type* from, const Json* value)
+        {
+            Json operation(json_object_arg);
+            operation.insert_or_assign(jsonpatch_names<char_type>::op_name(), op);
+            if (from != nullptr)
+            {
+                operation.insert_or_assign(jsonpatch_names<char_type>::from_name(), *from);
+            }
+            operation.insert_or_assign(jsonpatch_names<char_type>::path_name(), path_);
+            if (value != nullptr)
+            {
+                operation.insert_or_assign(jsonpatch_names<char_type>::value_name(), *value);
+            }
+            callback_(static_cast<const Json&>(operation));
+        }
+    };
+
+} // namespace detail
+
+    // Streams the JSON Patch operations that turn the source document into the target one to
+    // callback, which is called with each operation (a const Json&) in the order they are to
+    // be applied. Identical subtrees are recognized by their hashes, so diffing documents with
+    // few differences costs little beyond building the indexes.
+    template <typename Json,typename Callback>
+    void stream_diff(const structural_index<Json>& source, const structural_index<Json>& target, Callback&& callback)
+    {
+        using callback_type = typename std::remove_reference<Callback>::type;
+
+        detail::structural_differ<Json,callback_type> differ(source, target, callback);
+        differ.diff();
+    }
+
+    template <typename Json,typename Callback>
+    void stream_diff(const Json& source, const Json& target, Callback&& callback)
+    {
+        structural_index<Json> source_index(source);
+        structural_index<Json> target_index(target);
+        stream_diff(source_index, target_index, std::forward<Callback>(callback));
+    }
+
+} // namespace jsonpatch
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATCH_STRUCTURAL_DIFF_HPP
@@ -0,0 +1,202 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATCH_STRUCTURAL_INDEX_HPP
+#define JSONCONS_EXT_JSONPATCH_STRUCTURAL_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <memory> // std::addressof
+#include <vector>
+
+#include <jsoncons/json_type.hpp>
+#include <jsoncons/semantic_tag.hpp>
+
+namespace jsoncons {
+namespace jsonpatch {
+
+namespace detail {
+
+    // splitmix64's finalizer
+    inline std::uint64_t mix_hash(std::uint64_t h) noexcept
+    {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+    inline std::uint64_t bytes_hash(std::uint64_t seed, const void* data, std::size_t length) noexcept
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        std::uint64_t h = mix_hash(seed ^ (static_cast<std::uint64_t>(length) * 0x9e3779b97f4a7c15ULL));
+        for (; length >= 8; p += 8, length -= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = mix_hash(h ^ word);
+        }
+        if (length > 0)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, p, length);
+            h = mix_hash(h ^ word ^ 0xff);
+        }
+        return h;
+    }
+
+    // Numbers of any kind compare by their value as a double
+    inline std::uint64_t number_hash(double d) noexcept
+    {
+        if (d == 0.0)
+        {
+            d = 0.0; // -0.0 compares equal to 0.0
+        }
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return mix_hash(6 ^ mix_hash(bits));
+    }
+
+    // Hash of a value that is not an array or object. Values with equal hashes compare equal
+    // barring collisions, and values that compare equal hash equal, except that a string
+    // holding a big number also compares equal to a plain string of the same text.
+    template <typename Json>
+    std::uint64_t scalar_hash(const Json& val)
+    {
+        switch (val.type())
+        {
+            case json_type::null_value:
+                return mix_hash(1);
+            case json_type::bool_value:
+                return mix_hash(val.template as<bool>() ? 3 : 2);
+            case json_type::int64_value:
+            case json_type::uint64_value:
+            case json_type::half_value:
+            case json_type::double_value:
+                return number_hash(val.template as<double>());
+            case json_type::string_value:
+            {
+                // Strings holding big numbers compare equal to numbers of the same value, and
+                // other strings compare equal whatever their tag
+                if (is_number_tag(val.tag()))
+                {
+                    return number_hash(val.template as<double>());
+                }
+                auto sv = val.as_string_view();
+                return bytes_hash(7, sv.data(), sv.size()*sizeof(typename Json::char_type));
+            }
+            case json_type::byte_string_value:
+            {
+                auto bsv = val.as_byte_string_view();
+                return bytes_hash(8, bsv.data(), bsv.size());
+            }
+            default:
+                return 0;
+        }
+    }
+
+    template <typename Json>
+    bool is_container(const Json& val)
+    {
+        return val.type() == json_type::array_value || val.type() == json_type::object_value;
+    }
+
+} // namespace detail
+
+    // Structural hashes of the arrays and objects of a document, in document order. Two
+    // indexes are diffed with stream_diff, which takes subtrees with equal hashes to be equal
+    // without comparing them, so the index of a document can be built once and kept for
+    // diffing it against later versions. The document must outlive the index and not be
+    // modified while it is in use.
+    template <typename Json>
+    class structural_index
+    {
+        struct entry
+        {
+            std::uint64_t hash;
+            std::size_t next; // the entry following this value's subtree
+        };
+
+        const Json* root_;
+        std::vector<entry> entries_;
+        std::uint64_t hash_;
+    public:
+        explicit structural_index(const Json& root)
+            : root_(std::addressof(root)), hash_(0)
+        {
+            hash_ = index_(root);
+        }
+
+        const Json& root() const
+        {
+            return *root_;
+        }
+
+        // The document's hash. Documents that compare equal (up to member order) usually hash
+        // alike; documents with equal hashes compare equal barring collisions.
+        std::uint64_t hash() const
+        {
+            return hash_;
+        }
+
+        // The arrays and objects of the document are numbered in document (pre-)order, the
+        // root being 0. The first array or object in a container's members or elements follows
+        // it, and each is followed by the one returned by next(entry).
+        std::uint64_t hash(std::size_t entry) const
+        {
+            return entries_[entry].hash;
+        }
+
+        // The entry following the subtree of the array or object at entry
+        std::size_t next(std::size_t entry) const
+        {
+            return entries_[entry].next;
+        }
+    private:
+        std::uint64_t index_(const Json& val)
+        {
+            switch (val.type())
+            {
+                case json_type::array_value:
+                {
+                    const std::size_t e = entries_.size();
+                    entries_.push_back(entry{0, 0});
+                    std::uint64_t h = detail::mix_hash(9 ^ (static_cast<std::uint64_t>(val.size()) << 8));
+                    for (const auto& element : val.array_range())
+                    {
+                        h = detail::mix_hash(h ^ index_(element));
+                    }
+                    entries_[e] = entry{h, entries_.size()};
+                    return h;
+                }
+                case json_type::object_value:
+                {
+                    // Members are summed so that member order does not matter
+                    const std::size_t e = entries_.size();
+                    entries_.push_back(entry{0, 0});
+                    std::uint64_t sum = 0;
+                    for (const auto& member : val.object_range())
+                    {
+                        const std::uint64_t key_hash = detail::bytes_hash(0, member.key().data(), member.key().size()*sizeof(typename Json::char_type));
+                        sum += detail::mix_hash(key_hash * 0x9e3779b97f4a7c15ULL + index_(member.value()));
+                    }
+                    const std::uint64_t h = detail::mix_hash(sum ^ 10 ^ (static_cast<std::uint64_t>(val.size()) << 8));
+                    entries_[e] = entry{h, entries_.size()};
+                    return h;
+                }
+                default:
+                    return detail::scalar_hash(val);
+            }
+        }
+    };
+
+} // namespace jsonpatch
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATCH_STRUCTURAL_INDEX_HPP
@@ -0,0 +1,267 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATH_EVAL_ARENA_HPP
+#define JSONCONS_EXT_JSONPATH_EVAL_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory> // std::allocator_traits
+#include <new>
+#include <type_traits>
+#include <utility> // std::forward
+
+#include <jsoncons/config/jsoncons_config.hpp>
+
+namespace jsoncons {
+namespace jsonpath {
+namespace detail {
+
+    // Supplies the blocks an eval_arena carves its objects from
+    class arena_block_source
+    {
+    public:
+        virtual ~arena_block_source() = default;
+
+        virtual void* allocate_block(std::size_t size) = 0;
+        virtual void deallocate_block(void* block, std::size_t size) noexcept = 0;
+    };
+
+    // Blocks from the temporary allocator of an allocator_set
+    template <typename TempAlloc>
+    class temp_allocator_block_source : public arena_block_source
+    {
+        using unit_allocator_type = typename std::allocator_traits<TempAlloc>::template rebind_alloc<std::max_align_t>;
+        using traits_type = std::allocator_traits<unit_allocator_type>;
+
+        unit_allocator_type alloc_;
+    public:
+        explicit temp_allocator_block_source(const TempAlloc& alloc)
+            : alloc_(alloc)
+        {
+        }
+
+        void* allocate_block(std::size_t size) override
+        {
+            return traits_type::allocate(alloc_, size / sizeof(std::max_align_t));
+        }
+
+        void deallocate_block(void* block, std::size_t size) noexcept override
+        {
+            traits_type::deallocate(alloc_, static_cast<std::max_align_t*>(block), size / sizeof(std::max_align_t));
+        }
+    };
+
+    // Holds the values and path nodes created while evaluating an expression. Objects are placed
+    // one after another in fixed-size blocks and destroyed together with the arena, in reverse
+    // order of creation. Blocks come from the given source or, by default, from a small free list
+    // kept per thread, so repeated evaluations on a thread reuse the same few blocks instead of
+    // allocating every temporary.
+    class eval_arena
+    {
+    public:
+        static constexpr std::size_t block_size = 4096;
+        static constexpr std::size_t pooled_blocks = 32;
+    private:
+        struct block_header
+        {
+            block_header* next;
+            arena_block_source* source; // null if the block belongs to the thread's free list
+        };
+
+        struct destructor
+        {
+            void (*destroy)(void*);
+            void* object;
+            destructor* next;
+        };
+
+        struct block_pool
+        {
+            block_header* free{nullptr};
+            std::size_t count{0};
+
+            block_pool() = default;
+            block_pool(const block_pool&) = delete;
+            block_pool& operator=(const block_pool&) = delete;
+
+            ~block_pool()
+            {
+                while (free != nullptr)
+                {
+                    block_header* next = free->next;
+                    ::operator delete(free);
+                    free = next;
+                }
+            }
+        };
+
+        static constexpr std::size_t header_size = (sizeof(block_header) + alignof(std::max_align_t) - 1) /
+            alignof(std::max_align_t) * alignof(std::max_align_t);
+
+        arena_block_source* source_;
+        block_header* blocks_;
+        char* next_;
+        char* end_;
+        destructor* destructors_;
+    public:
+        explicit eval_arena(arena_block_source* source = nullptr) noexcept
+            : source_(source), blocks_(nullptr), next_(nullptr), end_(nullptr), destructors_(nullptr)
+        {
+        }
+
+        eval_arena(const eval_arena&) = delete;
+        eval_arena& operator=(const eval_arena&) = delete;
+
+        ~eval_arena() noexcept
+        {
+            while (destructors_ != nullptr)
+            {
+                destructors_->destroy(destructors_->object);
+                destructors_ = destructors_->next;
+            }
+            while (blocks_ != nullptr)
+            {
+                block_header* next = blocks_->next;
+                release(blocks_);
+                blocks_ = next;
+            }
+        }
+
+        template <typename T,typename... Args>
+        T* create(Args&& ... args)
+        {
+            static_assert(sizeof(T) + alignof(T) + sizeof(destructor) <= block_size - header_size, "object too large for an arena block");
+
+            T* ptr = ::new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            register_destructor(ptr, std::is_trivially_destructible<T>());
+            return ptr;
+        }
+
+        // True if ptr points into one of the arena's blocks
+        bool owns(const void* ptr) const noexcept
+        {
+            const char* p = static_cast<const char*>(ptr);
+            for (const block_header* b = blocks_; b != nullptr; b = b->next)
+            {
+                const char* first = reinterpret_cast<const char*>(b);
+                if (p >= first && p < first + block_size)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        void* allocate(std::size_t size, std::size_t alignment)
+        {
+            char* p = align(next_, alignment);
+            if (p == nullptr || p + size > end_)
+            {
+                block_header* b = acquire();
+                b->next = blocks_;
+                blocks_ = b;
+                end_ = reinterpret_cast<char*>(b) + block_size;
+                p = align(reinterpret_cast<char*>(b) + header_size, alignment);
+            }
+            next_ = p + size;
+            return p;
+        }
+
+        template <typename T>
+        void register_destructor(T*, std::true_type) noexcept
+        {
+        }
+
+        template <typename T>
+        void register_destructor(T* ptr, std::false_type)
+        {
+            JSONCONS_TRY
+            {
+                destructors_ = ::new(allocate(sizeof(destructor), alignof(destructor)))
+                    destructor{&destroy<T>, ptr, destructors_};
+            }
+            JSONCONS_CATCH(...)
+            {
+                ptr->~T();
+                JSONCONS_RETHROW;
+            }
+        }
+
+        template <typename T>
+        static void destroy(void* object) noexcept
+        {
+            static_cast<T*>(object)->~T();
+        }
+
+        static char* align(char* p, std::size_t alignment) noexcept
+        {
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+            const std::size_t misalignment = static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(p) % alignment);
+            return misalignment == 0 ? p : p + (alignment - misalignment);
+        }
+
+        static block_pool& pool()
+        {
+            static thread_local block_pool blocks;
+            return blocks;
+        }
+
+        block_header* acquire()
+        {
+            block_header* b;
+            if (source_ != nullptr)
+            {
+                b = static_cast<block_header*>(source_->allocate_block(block_size));
+            }
+            else
+            {
+                block_pool& blocks = pool();
+                if (blocks.free != nullptr)
+                {
+                    b = blocks.free;
+                    blocks.free = b->next;
+                    --blocks.count;
+                }
+                else
+                {
+                    b = static_cast<block_header*>(::operator new(block_size));
+                }
+            }
+            b->source = source_;
+            return b;
+        }
+
+        static void release(block_header* b) noexcept
+        {
+            if (b->source != nullptr)
+            {
+                b->source->deallocate_block(b, block_size);
+                return;
+            }
+            block_pool& blocks = pool();
+            if (blocks.count < pooled_blocks)
+            {
+                b->next = blocks.free;
+                blocks.free = b;
+                ++blocks.count;
+            }
+            else
+            {
+                ::operator delete(b);
+            }
+        }
+    };
+
+} // namespace detail
+} // namespace jsonpath
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATH_EVAL_ARENA_HPP
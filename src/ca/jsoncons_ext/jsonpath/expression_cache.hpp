@@ -0,0 +1,155 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATH_EXPRESSION_CACHE_HPP
+#define JSONCONS_EXT_JSONPATH_EXPRESSION_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility> // std::move
+
+#include <jsoncons/config/jsoncons_config.hpp>
+
+#include <jsoncons_ext/jsonpath/jsonpath_expression.hpp>
+#include <jsoncons_ext/jsonpath/token_evaluator.hpp>
+
+namespace jsoncons {
+namespace jsonpath {
+
+    // A thread-safe, least-recently-used cache of compiled JSONPath expressions keyed by path text.
+    // Every expression in a cache is compiled with the cache's custom functions and default
+    // allocators, so those form the rest of the key. A compiled expression is immutable and may be
+    // evaluated from several threads at once; entries are shared, so an evicted expression stays
+    // alive for as long as a caller holds it.
+    template <typename Json>
+    class expression_cache
+    {
+    public:
+        using value_type = typename jsonpath_traits<Json>::value_type;
+        using char_type = typename jsonpath_traits<Json>::char_type;
+        using string_view_type = typename jsonpath_traits<Json>::string_view_type;
+        using expression_type = jsonpath_expression<Json>;
+        using expression_pointer = std::shared_ptr<const expression_type>;
+
+        static constexpr std::size_t default_capacity = 256;
+    private:
+        using key_type = std::basic_string<char_type>;
+        using entry_type = std::pair<key_type,expression_pointer>;
+        using list_type = std::list<entry_type>;
+
+        custom_functions<value_type> functions_;
+        std::size_t capacity_;
+
+        mutable std::mutex mutex_;
+        list_type entries_; // most recently used first
+        std::unordered_map<key_type,typename list_type::iterator> index_;
+        std::size_t hits_;
+        std::size_t misses_;
+    public:
+        explicit expression_cache(std::size_t capacity = default_capacity,
+            const custom_functions<value_type>& functions = custom_functions<value_type>())
+            : functions_(functions), capacity_(capacity == 0 ? 1 : capacity), hits_(0), misses_(0)
+        {
+        }
+
+        expression_cache(const expression_cache&) = delete;
+        expression_cache& operator=(const expression_cache&) = delete;
+
+        // Returns the compiled expression for path, compiling it on a miss. Throws jsonpath_error
+        // if path does not compile; failures are not cached.
+        expression_pointer get(const string_view_type& path)
+        {
+            key_type key(path.data(), path.size());
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = index_.find(key);
+                if (it != index_.end())
+                {
+                    ++hits_;
+                    entries_.splice(entries_.begin(), entries_, it->second);
+                    return it->second->second;
+                }
+                ++misses_;
+            }
+
+            // Compile without holding the lock; if another thread compiled the same path
+            // meanwhile, its entry is kept and returned
+            expression_pointer expr = std::make_shared<const expression_type>(make_expression<Json>(path, functions_));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end())
+            {
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->second;
+            }
+            entries_.emplace_front(key, expr);
+            index_.emplace(std::move(key), entries_.begin());
+            while (entries_.size() > capacity_)
+            {
+                index_.erase(entries_.back().first);
+                entries_.pop_back();
+            }
+            return expr;
+        }
+
+        std::size_t hits() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return hits_;
+        }
+
+        std::size_t misses() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return misses_;
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return entries_.size();
+        }
+
+        std::size_t capacity() const
+        {
+            return capacity_;
+        }
+
+        // Drops all entries and resets the hit and miss counters
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index_.clear();
+            entries_.clear();
+            hits_ = 0;
+            misses_ = 0;
+        }
+    };
+
+    // The process-wide cache used by json_query and json_replace when no custom functions are given
+    template <typename Json>
+    expression_cache<Json>& default_expression_cache()
+    {
+        static expression_cache<Json> cache;
+        return cache;
+    }
+
+    // Returns the compiled form of path from the process-wide cache
+    template <typename Json>
+    std::shared_ptr<const jsonpath_expression<Json>> cached_expression(const typename Json::string_view_type& path)
+    {
+        return default_expression_cache<Json>().get(path);
+    }
+
+} // namespace jsonpath
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATH_EXPRESSION_CACHE_HPP
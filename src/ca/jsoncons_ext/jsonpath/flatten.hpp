@@ -10,10 +10,14 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <utility> // std::move
+#include <vector>
 
 #include <jsoncons/config/compiler_support.hpp>
 #include <jsoncons/utility/read_number.hpp>
 #include <jsoncons/utility/write_number.hpp>
+#include <jsoncons/detail/flattened_object.hpp>
 #include <jsoncons/json_type.hpp>
 #include <jsoncons/semantic_tag.hpp>
 
@@ -23,31 +27,34 @@
 namespace jsoncons { 
 namespace jsonpath {
 
+namespace detail {
+
+    // Adds the members for value, whose key is key. Each level appends its selector to the one
+    // key buffer and truncates it again afterwards, rather than copying its parent's key.
     template <typename Json>
-    void flatten_(const typename Json::string_type& parent_key,
-                  const Json& parent_value,
-                  Json& result)
+    void flatten_(typename Json::string_type& key,
+                  const Json& value,
+                  jsoncons::detail::flattened_members<Json>& members)
     {
-        using char_type = typename Json::char_type;
-        using string_type = std::basic_string<char_type>;
-
-        switch (parent_value.type())
+        const std::size_t length = key.size();
+        switch (value.type())
         {
             case json_type::array_value:
             {
-                if (parent_value.empty())
+                if (value.empty())
                 {
-                    result.try_emplace(parent_key, parent_value);
+                    members.emplace_back(key, value);
                 }
                 else
                 {
-                    for (std::size_t i = 0; i < parent_value.size(); ++i)
+                    std::size_t i = 0;
+                    for (const auto& item : value.array_range())
                     {
-                        string_type key(parent_key);
                         key.push_back('[');
-                        jsoncons::utility::from_integer(i,key);
+                        jsoncons::utility::from_integer(i++,key);
                         key.push_back(']');
-                        flatten_(key, parent_value.at(i), result);
+                        flatten_(key, item, members);
+                        key.resize(length);
                     }
                 }
                 break;
@@ -55,21 +62,21 @@ namespace jsonpath {
 
             case json_type::object_value:
             {
-                if (parent_value.empty())
+                if (value.empty())
                 {
-                    result.try_emplace(parent_key, Json());
+                    members.emplace_back(key, Json());
                 }
                 else
                 {
-                    for (const auto& item : parent_value.object_range())
+                    for (const auto& item : value.object_range())
                     {
-                        string_type key(parent_key);
                         key.push_back('[');
                         key.push_back('\'');
                         escape_string(item.key().data(), item.key().length(), key);
                         key.push_back('\'');
                         key.push_back(']');
-                        flatten_(key, item.value(), result);
+                        flatten_(key, item.value(), members);
+                        key.resize(length);
                     }
                 }
                 break;
@@ -77,18 +84,129 @@ namespace jsonpath {
 
             default:
             {
-                result[parent_key] = parent_value;
+                members.emplace_back(key, value);
                 break;
             }
         }
     }
 
+    // The path the previous key of a flattened document took. Keys usually share a prefix with
+    // the key before them, and the members that prefix names are taken from here instead of
+    // being looked up again.
+    template <typename Json>
+    class unflatten_path
+    {
+        using string_type = typename Json::string_type;
+
+        struct step
+        {
+            string_type name;
+            std::size_t index{0};
+            bool is_index{false};
+            Json* part{nullptr};
+        };
+
+        std::vector<step> steps_;
+        std::size_t count_{0};
+        std::size_t previous_count_{0};
+        bool shared_{true}; // every step of this key so far reached what it did for the previous key
+
+        step& next_step()
+        {
+            if (count_ == steps_.size())
+            {
+                steps_.emplace_back();
+            }
+            return steps_[count_++];
+        }
+    public:
+        void begin()
+        {
+            previous_count_ = count_;
+            count_ = 0;
+            shared_ = true;
+        }
+
+        // Takes member name of part, adding it as value when this is the last step of the key
+        // and as an empty object on the way there
+        Json* name(Json* part, const string_type& name, const Json* value)
+        {
+            const std::size_t i = count_;
+            step& s = next_step();
+            shared_ = shared_ && i < previous_count_ && !s.is_index && s.name == name;
+            if (shared_ && value == nullptr)
+            {
+                part = s.part;
+            }
+            else if (value == nullptr)
+            {
+                auto res = part->try_emplace(name,Json());
+                part = &(res.first->value());
+            }
+            else
+            {
+                auto res = part->try_emplace(name,*value);
+                part = &(res.first->value());
+            }
+            s.name = name;
+            s.is_index = false;
+            s.part = part;
+            return part;
+        }
+
+        // Takes element n of part, which becomes an array if it is not one. value is appended
+        // when this is the last step of the key; otherwise an empty object is appended when n is
+        // past the end. Appending reaches a new element, so it is never shared.
+        template <typename Alloc>
+        Json* index(Json* part, std::size_t n, const Json* value, const Alloc& alloc)
+        {
+            const std::size_t i = count_;
+            step& s = next_step();
+            shared_ = shared_ && i < previous_count_ && s.is_index && s.index == n;
+            if (!part->is_array())
+            {
+                *part = Json(json_array_arg, semantic_tag::none, alloc);
+                shared_ = false;
+            }
+            if (value == nullptr)
+            {
+                if (n+1 > part->size())
+                {
+                    Json& ref = part->emplace_back();
+                    part = std::addressof(ref);
+                    shared_ = false;
+                }
+                else
+                {
+                    Json* element = &part->at(n);
+                    shared_ = shared_ && element == s.part;
+                    part = element;
+                }
+            }
+            else
+            {
+                Json& ref = part->emplace_back(*value);
+                part = std::addressof(ref);
+                shared_ = false;
+            }
+            s.index = n;
+            s.is_index = true;
+            s.part = part;
+            return part;
+        }
+    };
+
+} // namespace detail
+
     template <typename Json>
     Json flatten(const Json& value)
     {
+        jsoncons::detail::flattened_members<Json> members;
+        typename Json::string_type key = {'$'};
+        detail::flatten_(key, value, members);
+
         Json result;
-        typename Json::string_type parent_key = {'$'};
-        flatten_(parent_key, value, result);
+        jsoncons::detail::make_flattened_object(members, result);
         return result;
     }
 
@@ -117,11 +235,14 @@ namespace jsonpath {
         }
 
         Json result;
+        detail::unflatten_path<Json> path;
+        string_type buffer;
 
         for (const auto& item : value.object_range())
         {
             Json* part = &result;
-            string_type buffer;
+            path.begin();
+            buffer.clear();
             unflatten_state state = unflatten_state::start;
 
             auto it = item.key().begin();
@@ -181,16 +302,7 @@ namespace jsonpath {
                         switch (*it)
                         {
                             case '\'':
-                                if (it != last-2)
-                                {
-                                    auto res = part->try_emplace(buffer,Json());
-                                    part = &(res.first->value());
-                                }
-                                else
-                                {
-                                    auto res = part->try_emplace(buffer,item.value());
-                                    part = &(res.first->value());
-                                }
+                                part = path.name(part, buffer, it != last-2 ? nullptr : std::addressof(item.value()));
                                 buffer.clear();
                                 state = unflatten_state::expect_rbracket;
                                 break;
@@ -208,16 +320,7 @@ namespace jsonpath {
                         switch (*it)
                         {
                             case '\"':
-                                if (it != last-2)
-                                {
-                                    auto res = part->try_emplace(buffer,Json());
-                                    part = &(res.first->value());
-                                }
-                                else
-                                {
-                                    auto res = part->try_emplace(buffer,item.value());
-                                    part = &(res.first->value());
-                                }
+                                part = path.name(part, buffer, it != last-2 ? nullptr : std::addressof(item.value()));
                                 buffer.clear();
                                 state = unflatten_state::expect_rbracket;
                                 break;
@@ -318,27 +421,7 @@ namespace jsonpath {
                                 auto r = jsoncons::utility::to_integer(buffer.data(), buffer.size(), n);
                                 if (r)
                                 {
-                                    if (!part->is_array())
-                                    {
-                                        *part = Json(json_array_arg, semantic_tag::none, value.get_allocator());
-                                    }
-                                    if (it != last-1)
-                                    {
-                                        if (n+1 > part->size())
-                                        {
-                                            Json& ref = part->emplace_back();
-                                            part = std::addressof(ref);
-                                        }
-                                        else
-                                        {
-                                            part = &part->at(n);
-                                        }
-                                    }
-                                    else
-                                    {
-                                        Json& ref = part->emplace_back(item.value());
-                                        part = std::addressof(ref);
-                                    }
+                                    part = path.index(part, n, it != last-1 ? nullptr : std::addressof(item.value()), value.get_allocator());
                                 }
                                 buffer.clear();
                                 state = unflatten_state::expect_lbracket;
@@ -16,6 +16,7 @@
 #include <jsoncons/utility/more_type_traits.hpp>
 
 #include <jsoncons_ext/jsonpath/token_evaluator.hpp>
+#include <jsoncons_ext/jsonpath/expression_cache.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath_expression.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath_parser.hpp>
 #include <jsoncons_ext/jsonpath/path_node.hpp>
@@ -47,6 +48,10 @@ namespace jsonpath {
                     result_options options = result_options(),
                     const custom_functions<Json>& functions = custom_functions<Json>())
     {
+        if (functions.begin() == functions.end())
+        {
+            return default_expression_cache<Json>().get(path)->evaluate(root, options);
+        }
         auto expr = make_expression<Json>(path, functions);
         return expr.evaluate(root, options);
     }
@@ -59,10 +64,29 @@ namespace jsonpath {
                result_options options = result_options(),
                const custom_functions<Json>& functions = custom_functions<Json>())
     {
+        if (functions.begin() == functions.end())
+        {
+            default_expression_cache<Json>().get(path)->evaluate(root, callback, options);
+            return;
+        }
         auto expr = make_expression<Json>(path, functions);
         expr.evaluate(root, callback, options);
     }
 
+    template <typename Json>
+    node_list<Json> json_query_nodes(const Json& root,
+                    const typename Json::string_view_type& path, 
+                    result_options options = result_options(),
+                    const custom_functions<Json>& functions = custom_functions<Json>())
+    {
+        if (functions.begin() == functions.end())
+        {
+            return default_expression_cache<Json>().get(path)->select_nodes(root, options);
+        }
+        auto expr = make_expression<Json>(path, functions);
+        return expr.select_nodes(root, options);
+    }
+
     template <typename Json,typename TempAlloc >
     Json json_query(const allocator_set<typename Json::allocator_type,TempAlloc>& aset, 
         const Json& root, const typename Json::string_view_type& path, 
@@ -98,15 +122,22 @@ namespace jsonpath {
         using path_expression_type = typename jsonpath_traits_type::path_expression_type;
         using path_node_type = typename jsonpath_traits_type::path_node_type;
 
+        auto callback = [&new_value](const path_node_type&, reference v)
+        {
+            v = std::forward<T>(new_value);
+        };
+
+        if (funcs.begin() == funcs.end())
+        {
+            default_expression_cache<Json>().get(path)->update(root, callback);
+            return;
+        }
+
         auto resources = jsoncons::make_unique<jsoncons::jsonpath::detail::static_resources<value_type>>(funcs);
         evaluator_type evaluator;
         path_expression_type expr = evaluator.compile(*resources, path);
 
         jsoncons::jsonpath::detail::eval_context<Json,reference> context;
-        auto callback = [&new_value](const path_node_type&, reference v)
-        {
-            v = std::forward<T>(new_value);
-        };
 
         result_options options = result_options::nodups | result_options::path | result_options::sort_descending;
         expr.evaluate(context, root, path_node_type{}, root, callback, options);
@@ -130,7 +161,8 @@ namespace jsonpath {
         evaluator_type evaluator{aset.get_allocator()};
         path_expression_type expr = evaluator.compile(*resources, path);
 
-        jsoncons::jsonpath::detail::eval_context<Json,reference> context{aset.get_allocator()};
+        jsoncons::jsonpath::detail::temp_allocator_block_source<TempAlloc> blocks{aset.get_temp_allocator()};
+        jsoncons::jsonpath::detail::eval_context<Json,reference> context{aset.get_allocator(), &blocks};
         auto callback = [&new_value](const path_node_type&, reference v)
         {
             v = Json(std::forward<T>(new_value), semantic_tag::none);
@@ -152,16 +184,23 @@ namespace jsonpath {
         using path_expression_type = typename jsonpath_traits_type::path_expression_type;
         using path_node_type = typename jsonpath_traits_type::path_node_type;
 
+        auto f = [&callback](const path_node_type& path, reference val)
+        {
+            callback(to_basic_string(path), val);
+        };
+
+        if (funcs.begin() == funcs.end())
+        {
+            default_expression_cache<Json>().get(path)->update(root, f);
+            return;
+        }
+
         auto resources = jsoncons::make_unique<jsoncons::jsonpath::detail::static_resources<value_type>>(funcs);
         evaluator_type evaluator;
         path_expression_type expr = evaluator.compile(*resources, path);
 
         jsoncons::jsonpath::detail::eval_context<Json,reference> context;
 
-        auto f = [&callback](const path_node_type& path, reference val)
-        {
-            callback(to_basic_string(path), val);
-        };
         result_options options = result_options::nodups | result_options::path | result_options::sort_descending;
         expr.evaluate(context, root, path_node_type{}, root, f, options);
     }
@@ -184,7 +223,8 @@ namespace jsonpath {
         evaluator_type evaluator{aset.get_allocator()};
         path_expression_type expr = evaluator.compile(*resources, path);
 
-        jsoncons::jsonpath::detail::eval_context<Json,reference> context{aset.get_allocator()};
+        jsoncons::jsonpath::detail::temp_allocator_block_source<TempAlloc> blocks{aset.get_temp_allocator()};
+        jsoncons::jsonpath::detail::eval_context<Json,reference> context{aset.get_allocator(), &blocks};
 
         auto f = [&callback](const path_node_type& path, reference val)
         {
@@ -194,10 +234,27 @@ namespace jsonpath {
         expr.evaluate(context, root, path_node_type{}, root, f, options);
     }
 
-    // Legacy replace function
-    template <typename Json,typename UnaryCallback>
-    typename std::enable_if<ext_traits::is_unary_function_object<UnaryCallback,Json>::value,void>::type
-    json_replace(Json& root, const typename Json::string_view_type& path , UnaryCallback callback)
+    namespace detail {
+
+        // A callback that also accepts a string path keeps the string overloads, so generic
+        // lambdas are not ambiguous; the string test comes first so it can short-circuit
+        template <typename Callback,typename Json>
+        struct is_path_node_replace_callback
+            : std::conditional<ext_traits::is_binary_function_object<Callback,const typename Json::string_type&,Json&>::value,
+                               std::false_type,
+                               ext_traits::is_binary_function_object<Callback,const basic_path_node<typename Json::char_type>&,Json&>>::type
+        {
+        };
+
+    } // namespace detail
+
+    // As the overloads above, but the callback receives the matched location as a path_node
+    // instead of a normalized path string, so no string is built for a match unless the callback
+    // formats one with to_basic_string(path). The path_node is valid only during the call.
+    template <typename Json,typename BinaryCallback>
+    typename std::enable_if<detail::is_path_node_replace_callback<BinaryCallback,Json>::value,void>::type
+    json_replace(Json& root, const typename Json::string_view_type& path , BinaryCallback callback, 
+                 const custom_functions<Json>& funcs = custom_functions<Json>())
     {
         using jsonpath_traits_type = jsoncons::jsonpath::legacy_jsonpath_traits<Json, Json&>;
 
@@ -207,17 +264,62 @@ namespace jsonpath {
         using path_expression_type = typename jsonpath_traits_type::path_expression_type;
         using path_node_type = typename jsonpath_traits_type::path_node_type;
 
-        auto resources = jsoncons::make_unique<jsoncons::jsonpath::detail::static_resources<value_type>>();
+        if (funcs.begin() == funcs.end())
+        {
+            default_expression_cache<Json>().get(path)->update(root, callback);
+            return;
+        }
+
+        auto resources = jsoncons::make_unique<jsoncons::jsonpath::detail::static_resources<value_type>>(funcs);
         evaluator_type evaluator;
         path_expression_type expr = evaluator.compile(*resources, path);
 
         jsoncons::jsonpath::detail::eval_context<Json,reference> context;
+
+        result_options options = result_options::nodups | result_options::path | result_options::sort_descending;
+        expr.evaluate(context, root, path_node_type{}, root, callback, options);
+    }
+
+    template <typename Json,typename BinaryCallback,typename TempAlloc >
+    typename std::enable_if<detail::is_path_node_replace_callback<BinaryCallback,Json>::value,void>::type
+    json_replace(const allocator_set<typename Json::allocator_type,TempAlloc>& aset, 
+        Json& root, const typename Json::string_view_type& path , BinaryCallback callback, 
+        const custom_functions<Json>& funcs = custom_functions<Json>())
+    {
+        using jsonpath_traits_type = jsoncons::jsonpath::legacy_jsonpath_traits<Json, Json&>;
+
+        using value_type = typename jsonpath_traits_type::value_type;
+        using reference = typename jsonpath_traits_type::reference;
+        using evaluator_type = typename jsonpath_traits_type::evaluator_type;
+        using path_expression_type = typename jsonpath_traits_type::path_expression_type;
+        using path_node_type = typename jsonpath_traits_type::path_node_type;
+
+        auto resources = jsoncons::make_unique<jsoncons::jsonpath::detail::static_resources<value_type>>(funcs, aset.get_allocator());
+        evaluator_type evaluator{aset.get_allocator()};
+        path_expression_type expr = evaluator.compile(*resources, path);
+
+        jsoncons::jsonpath::detail::temp_allocator_block_source<TempAlloc> blocks{aset.get_temp_allocator()};
+        jsoncons::jsonpath::detail::eval_context<Json,reference> context{aset.get_allocator(), &blocks};
+
+        result_options options = result_options::nodups | result_options::path | result_options::sort_descending;
+        expr.evaluate(context, root, path_node_type{}, root, callback, options);
+    }
+
+    // Legacy replace function
+    template <typename Json,typename UnaryCallback>
+    typename std::enable_if<ext_traits::is_unary_function_object<UnaryCallback,Json>::value,void>::type
+    json_replace(Json& root, const typename Json::string_view_type& path , UnaryCallback callback)
+    {
+        using jsonpath_traits_type = jsoncons::jsonpath::legacy_jsonpath_traits<Json, Json&>;
+
+        using reference = typename jsonpath_traits_type::reference;
+        using path_node_type = typename jsonpath_traits_type::path_node_type;
+
         auto f = [callback](const path_node_type&, reference v)
         {
             v = callback(v);
         };
-        result_options options = result_options::nodups | result_options::path | result_options::sort_descending;
-        expr.evaluate(context, root, path_node_type{}, root, f, options);
+        default_expression_cache<Json>().get(path)->update(root, f);
     }
 
 } // namespace jsonpath
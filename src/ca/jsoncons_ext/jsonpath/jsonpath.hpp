@@ -10,5 +10,6 @@
 #include <jsoncons_ext/jsonpath/flatten.hpp>
 #include <jsoncons_ext/jsonpath/json_location.hpp>
 #include <jsoncons_ext/jsonpath/json_query.hpp>
+#include <jsoncons_ext/jsonpath/stream_query.hpp>
 
 #endif // JSONCONS_EXT_JSONPATH_JSONPATH_HPP
@@ -23,7 +23,9 @@
 
 #include <jsoncons_ext/jsonpath/token_evaluator.hpp>
 #include <jsoncons_ext/jsonpath/json_location.hpp>
+#include <jsoncons_ext/jsonpath/key_index.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath_parser.hpp>
+#include <jsoncons_ext/jsonpath/node_list.hpp>
 #include <jsoncons_ext/jsonpath/path_node.hpp>
 
 namespace jsoncons { 
@@ -71,6 +73,12 @@ namespace jsonpath {
         jsonpath_expression& operator=(const jsonpath_expression&) = delete;
         jsonpath_expression& operator=(jsonpath_expression&&) = default;
 
+        // The compiled form evaluated against const documents; used by stream_query
+        const const_path_expression_type& const_expression() const
+        {
+            return const_expr_;
+        }
+
         template <typename BinaryCallback>
         typename std::enable_if<ext_traits::is_binary_function_object<BinaryCallback,const string_type&,const_reference>::value,void>::type
         evaluate(const_reference root, BinaryCallback callback, result_options options = result_options()) const
@@ -127,6 +135,72 @@ namespace jsonpath {
             const_expr_.evaluate(context, root, path_node_type{}, root, callback, options | result_options::path);
         }
 
+        // Returns the matched nodes by reference instead of copying them into an array.
+        // root must outlive the returned list and must not be modified while it is in use.
+        node_list<value_type> select_nodes(const_reference root, result_options options = result_options()) const
+        {
+            return node_list<value_type>(const_expr_, root, options, alloc_);
+        }
+
+        // As select_nodes(root, options), with $..name served from index instead of walking the
+        // whole document. index is built on first use; it is ignored if it was made for another root.
+        node_list<value_type> select_nodes(const_reference root, key_index<value_type>& index,
+            result_options options = result_options()) const
+        {
+            return node_list<value_type>(const_expr_, root, options, index_for(root, index), alloc_);
+        }
+
+        // Evaluates the expression once and returns the matched nodes as mutable locations in
+        // descending path order, without duplicates, as update() visits them. Several updates can
+        // then be applied without evaluating the expression again; see node_list for when the
+        // locations are invalidated.
+        node_list<value_type,reference> resolve(reference root) const
+        {
+            result_options options = result_options::nodups | result_options::path | result_options::sort_descending;
+            return node_list<value_type,reference>(expr_, root, options, alloc_);
+        }
+
+        // Returns true if the expression matches at least one node, stopping at the first match
+        bool exists(const_reference root) const
+        {
+            jsoncons::jsonpath::detail::eval_context<value_type,const_reference> context{alloc_};
+            return const_expr_.evaluate_first(context, root, path_node_type{}, root, result_options()) != nullptr;
+        }
+
+        // Returns the first match in document order without evaluating the rest of the expression.
+        // A node of root is returned by pointer; a value computed during evaluation (e.g. a length)
+        // is returned by value. ptr() is null when there is no match.
+        value_or_pointer<value_type,const_reference> first(const_reference root) const
+        {
+            jsoncons::jsonpath::detail::eval_context<value_type,const_reference> context{alloc_};
+            const value_type* ptr = const_expr_.evaluate_first(context, root, path_node_type{}, root, result_options());
+            if (ptr != nullptr && context.is_temp(ptr))
+            {
+                return value_or_pointer<value_type,const_reference>(value_type(*ptr));
+            }
+            return value_or_pointer<value_type,const_reference>(ptr);
+        }
+
+        // Returns true if the path descends recursively to a member name, e.g. $..name, which the
+        // key_index overloads of first() and select_nodes() serve from the index
+        bool uses_key_index() const
+        {
+            return const_expr_.selector() != nullptr && const_expr_.selector()->has_indexed_descent();
+        }
+
+        // As first(root), with $..name served from index
+        value_or_pointer<value_type,const_reference> first(const_reference root, key_index<value_type>& index) const
+        {
+            jsoncons::jsonpath::detail::eval_context<value_type,const_reference> context{alloc_};
+            context.set_key_index(index_for(root, index));
+            const value_type* ptr = const_expr_.evaluate_first(context, root, path_node_type{}, root, result_options());
+            if (ptr != nullptr && context.is_temp(ptr))
+            {
+                return value_or_pointer<value_type,const_reference>(value_type(*ptr));
+            }
+            return value_or_pointer<value_type,const_reference>(ptr);
+        }
+
         template <typename BinaryCallback>
         typename std::enable_if<ext_traits::is_binary_function_object<BinaryCallback,const path_node_type&,value_type&>::value,void>::type
         update(reference root, BinaryCallback callback) const
@@ -154,6 +228,11 @@ namespace jsonpath {
 
             return result;
         }
+    private:
+        static key_index<value_type>* index_for(const_reference root, key_index<value_type>& index)
+        {
+            return std::addressof(index.root()) == std::addressof(root) ? std::addressof(index) : nullptr;
+        }
     };
 
     template <typename Json>
@@ -10,7 +10,6 @@
 #include <algorithm> // std::reverse
 #include <cstddef>
 #include <cstdint>
-#include <regex>
 #include <system_error>
 #include <type_traits> // std::is_const
 #include <utility> // std::move
@@ -21,6 +20,7 @@
 #include <jsoncons/json_parser.hpp>
 #include <jsoncons/ser_util.hpp>
 #include <jsoncons/semantic_tag.hpp>
+#include <jsoncons/utility/regex.hpp>
 #include <jsoncons/utility/unicode_traits.hpp>
 
 #include <jsoncons_ext/jsonpath/token_evaluator.hpp>
@@ -1021,12 +1021,8 @@ namespace detail {
                         break;
                     case path_state::regex: 
                     {
-                        std::regex::flag_type options = std::regex_constants::ECMAScript; 
-                        if (buffer2.find('i') != string_type::npos)
-                        {
-                            options |= std::regex_constants::icase;
-                        }
-                        std::basic_regex<char_type> pattern(buffer, options);
+                        bool icase = buffer2.find('i') != string_type::npos;
+                        auto pattern = jsoncons::utility::cached_regex_matcher<char_type>(string_view_type(buffer), icase);
                         push_token(resources, resources.get_regex_operator(std::move(pattern)), ec);
                         if (JSONCONS_UNLIKELY(ec)) {return path_expression_type(alloc_);}
                         buffer.clear();
@@ -12,6 +12,7 @@
 #include <memory>
 #include <string>
 #include <system_error>
+#include <type_traits>
 #include <utility> // std::move
 #include <vector>
 
@@ -117,7 +118,7 @@ namespace detail {
             std::size_t index, 
             result_options options) 
         {
-            const result_options require_path = result_options::path | result_options::nodups | result_options::sort;
+            const result_options require_path = result_options::path | result_options::sort | result_options::sort_descending;
             if ((options & require_path) != result_options())
             {
                 return *context.create_path_node(&last, index);
@@ -130,7 +131,7 @@ namespace detail {
             const string_view_type& identifier, 
             result_options options) 
         {
-            const result_options require_path = result_options::path | result_options::nodups | result_options::sort;
+            const result_options require_path = result_options::path | result_options::sort | result_options::sort_descending;
             if ((options & require_path) != result_options())
             {
                 return *context.create_path_node(&last, identifier);
@@ -155,6 +156,7 @@ namespace detail {
         using path_node_type = typename supertype::path_node_type;
         using node_receiver_type = typename supertype::node_receiver_type;
         using selector_type = typename supertype::selector_type;
+        using direct_step_type = typename supertype::direct_step_type;
 
         base_selector()
             : supertype(true, 11)
@@ -195,6 +197,21 @@ namespace detail {
             }
         }
 
+        const selector_type* tail() const
+        {
+            return tail_;
+        }
+
+        bool collect_tail_direct_steps(std::vector<direct_step_type>& steps) const
+        {
+            return !tail_ || tail_->collect_direct_steps(steps);
+        }
+
+        bool has_indexed_descent() const override
+        {
+            return tail_ && tail_->has_indexed_descent();
+        }
+
         reference evaluate_tail(eval_context<Json,JsonReference>& context,
             reference root,
             const path_node_type& last, 
@@ -249,6 +266,25 @@ namespace detail {
         {
         }
 
+        const string_type& identifier() const
+        {
+            return identifier_;
+        }
+
+        // True if the identifier can only select object members, not array elements or lengths
+        bool selects_members_only() const
+        {
+            int64_t n{0};
+            return !jsoncons::utility::dec_to_integer(identifier_.data(), identifier_.size(), n) &&
+                identifier_ != JSONCONS_CSTRING_CONSTANT(char_type, "length");
+        }
+
+        bool collect_direct_steps(std::vector<typename supertype::direct_step_type>& steps) const override
+        {
+            steps.emplace_back(identifier_);
+            return this->collect_tail_direct_steps(steps);
+        }
+
         void select(eval_context<Json,JsonReference>& context,
             reference root,
             const path_node_type& last, 
@@ -262,7 +298,7 @@ namespace detail {
                 if (it != current.object_range().end())
                 {
                     this->tail_select(context, root, 
-                                        path_generator_type::generate(context, last, identifier_, options),
+                                        path_generator_type::generate(context, last, (*it).key(), options),
                                         (*it).value(), receiver, options);
                 }
             }
@@ -284,7 +320,7 @@ namespace detail {
                 {
                     pointer ptr = context.create_json(current.size(), semantic_tag::none, context.get_allocator());
                     this->tail_select(context, root, 
-                                        path_generator_type::generate(context, last, identifier_, options), 
+                                        path_generator_type::generate(context, last, context.length_label(), options), 
                                         *ptr, 
                                         receiver, options);
                 }
@@ -295,7 +331,7 @@ namespace detail {
                 std::size_t count = unicode_traits::count_codepoints(sv.data(), sv.size());
                 pointer ptr = context.create_json(count, semantic_tag::none, context.get_allocator());
                 this->tail_select(context, root, 
-                                    path_generator_type::generate(context, last, identifier_, options), 
+                                    path_generator_type::generate(context, last, context.length_label(), options), 
                                     *ptr, receiver, options);
             }
             //std::cout << "end identifier_selector\n";
@@ -314,7 +350,7 @@ namespace detail {
                 if (it != current.object_range().end())
                 {
                     return this->evaluate_tail(context, root, 
-                                               path_generator_type::generate(context, last, identifier_, options),
+                                               path_generator_type::generate(context, last, (*it).key(), options),
                                               (*it).value(), options, ec);
                 }
                 return context.null_value();
@@ -338,7 +374,7 @@ namespace detail {
                 {
                     pointer ptr = context.create_json(current.size(), semantic_tag::none, context.get_allocator());
                     return this->evaluate_tail(context, root, 
-                                               path_generator_type::generate(context, last, identifier_, options), 
+                                               path_generator_type::generate(context, last, context.length_label(), options), 
                                                *ptr, 
                                                options, ec);
                 }
@@ -350,7 +386,7 @@ namespace detail {
                 std::size_t count = unicode_traits::count_codepoints(sv.data(), sv.size());
                 pointer ptr = context.create_json(count, semantic_tag::none, context.get_allocator());
                 return this->evaluate_tail(context, root, 
-                                           path_generator_type::generate(context, last, identifier_, options), 
+                                           path_generator_type::generate(context, last, context.length_label(), options), 
                                            *ptr, options, ec);
             }
             return context.null_value();
@@ -400,6 +436,11 @@ namespace detail {
         
         ~root_selector() = default;
 
+        bool collect_direct_steps(std::vector<typename supertype::direct_step_type>& steps) const override
+        {
+            return this->collect_tail_direct_steps(steps);
+        }
+
         void select(eval_context<Json,JsonReference>& context,
                     reference root,
                     const path_node_type& last, 
@@ -466,6 +507,11 @@ namespace detail {
 
         current_node_selector& operator=(const current_node_selector&) = default;
         current_node_selector& operator=(current_node_selector&&) = default;              
+
+        bool collect_direct_steps(std::vector<typename supertype::direct_step_type>& steps) const override
+        {
+            return this->collect_tail_direct_steps(steps);
+        }
         
         void select(eval_context<Json,JsonReference>& context,
                     reference root,
@@ -622,6 +668,17 @@ namespace detail {
         {
         }
 
+        int64_t index() const
+        {
+            return index_;
+        }
+
+        bool collect_direct_steps(std::vector<typename supertype::direct_step_type>& steps) const override
+        {
+            steps.emplace_back(index_);
+            return this->collect_tail_direct_steps(steps);
+        }
+
         void select(eval_context<Json,JsonReference>& context,
                     reference root,
                     const path_node_type& last, 
@@ -712,7 +769,7 @@ namespace detail {
         {
             if (current.is_array())
             {
-                for (std::size_t i = 0; i < current.size(); ++i)
+                for (std::size_t i = 0; i < current.size() && !receiver.stopped(); ++i)
                 {
                     this->tail_select(context, root, 
                                         path_generator_type::generate(context, last, i, options), current[i], 
@@ -723,6 +780,10 @@ namespace detail {
             {
                 for (auto& member : current.object_range())
                 {
+                    if (receiver.stopped())
+                    {
+                        break;
+                    }
                     this->tail_select(context, root, 
                                         path_generator_type::generate(context, last, member.key(), options), 
                                         member.value(), receiver, options);
@@ -778,6 +839,12 @@ namespace detail {
         {
         }
 
+        bool has_indexed_descent() const override
+        {
+            const auto* name = dynamic_cast<const identifier_selector<Json,JsonReference>*>(this->tail());
+            return (name != nullptr && name->selects_members_only()) || supertype::has_indexed_descent();
+        }
+
         void select(eval_context<Json,JsonReference>& context,
             reference root,
             const path_node_type& last, 
@@ -785,10 +852,15 @@ namespace detail {
             node_receiver_type& receiver,
             result_options options) const override
         {
+            if (select_indexed(context, root, last, current, receiver, options,
+                std::is_const<typename std::remove_reference<JsonReference>::type>()))
+            {
+                return;
+            }
             if (current.is_array())
             {
                 this->tail_select(context, root, last, current, receiver, options);
-                for (std::size_t i = 0; i < current.size(); ++i)
+                for (std::size_t i = 0; i < current.size() && !receiver.stopped(); ++i)
                 {
                     select(context, root, 
                            path_generator_type::generate(context, last, i, options), current[i], receiver, options);
@@ -799,6 +871,10 @@ namespace detail {
                 this->tail_select(context, root, last, current, receiver, options);
                 for (auto& item : current.object_range())
                 {
+                    if (receiver.stopped())
+                    {
+                        break;
+                    }
                     select(context, root, 
                            path_generator_type::generate(context, last, item.key(), options), item.value(), receiver, options);
                 }
@@ -836,6 +912,73 @@ namespace detail {
 
             return s;
         }
+    private:
+        // For ..name, visits only the objects below current that have a member called name, as
+        // found in the caller's key_index, in the order the walk would reach them. Returns false
+        // if there is no index, current is not part of the indexed document, or the tail is not a
+        // member name.
+        bool select_indexed(eval_context<Json,JsonReference>& context,
+            reference root,
+            const path_node_type& last, 
+            reference current,
+            node_receiver_type& receiver,
+            result_options options,
+            std::true_type) const
+        {
+            key_index<value_type>* index = context.get_key_index();
+            if (index == nullptr)
+            {
+                return false;
+            }
+            const auto* name = dynamic_cast<const identifier_selector<Json,JsonReference>*>(this->tail());
+            if (name == nullptr || !name->selects_members_only())
+            {
+                return false;
+            }
+            const std::size_t number = index->number_of(current);
+            if (number == key_index<value_type>::npos)
+            {
+                return false;
+            }
+
+            const result_options require_path = result_options::path | result_options::sort | result_options::sort_descending;
+            const bool with_path = (options & require_path) != result_options();
+            std::vector<std::size_t> chain;
+            auto range = index->lookup(name->identifier(), number);
+            for (auto it = range.first; it != range.second && !receiver.stopped(); ++it)
+            {
+                const path_node_type* path = std::addressof(last);
+                if (with_path)
+                {
+                    chain.clear();
+                    for (std::size_t n = it->object; n != number; n = index->at(n).parent)
+                    {
+                        chain.push_back(n);
+                    }
+                    for (auto c = chain.rbegin(); c != chain.rend(); ++c)
+                    {
+                        const auto& node = index->at(*c);
+                        path = node.member != nullptr
+                            ? std::addressof(path_generator_type::generate(context, *path, node.member->key(), options))
+                            : std::addressof(path_generator_type::generate(context, *path, node.index, options));
+                    }
+                    path = std::addressof(path_generator_type::generate(context, *path, it->member->key(), options));
+                }
+                name->tail_select(context, root, *path, it->member->value(), receiver, options);
+            }
+            return true;
+        }
+
+        bool select_indexed(eval_context<Json,JsonReference>&,
+            reference,
+            const path_node_type&, 
+            reference,
+            node_receiver_type&,
+            result_options,
+            std::false_type) const
+        {
+            return false;
+        }
     };
 
     template <typename Json,typename JsonReference>
@@ -862,6 +1005,11 @@ namespace detail {
         {
         }
 
+        const std::vector<selector_type*>& selectors() const
+        {
+            return selectors_;
+        }
+
         void append_selector(selector_type* tail) override
         {
             if (tail_ == nullptr)
@@ -878,6 +1026,19 @@ namespace detail {
             }
         }
 
+        // Each branch ends with the selectors that follow the union
+        bool has_indexed_descent() const override
+        {
+            for (const auto& selector : selectors_)
+            {
+                if (selector->has_indexed_descent())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
         void select(eval_context<Json,JsonReference>& context,
                     reference root,
                     const path_node_type& last, 
@@ -887,6 +1048,10 @@ namespace detail {
         {
             for (auto& selector : selectors_)
             {
+                if (receiver.stopped())
+                {
+                    break;
+                }
                 selector->select(context, root, last, current, receiver, options);
             }
         }
@@ -953,12 +1118,11 @@ namespace detail {
         {
             if (current.is_array())
             {
-                for (std::size_t i = 0; i < current.size(); ++i)
+                typename token_evaluator<Json,JsonReference>::frame f(expr_);
+                for (std::size_t i = 0; i < current.size() && !receiver.stopped(); ++i)
                 {
                     std::error_code ec;
-                    value_type r = expr_.evaluate(context, root, current[i], options, ec);
-                    bool t = ec ? false : detail::is_true(r);
-                    if (t)
+                    if (expr_.test(context, root, current[i], options, f, ec))
                     {
                         this->tail_select(context, root, 
                                             path_generator_type::generate(context, last, i, options), 
@@ -968,12 +1132,15 @@ namespace detail {
             }
             else if (current.is_object())
             {
+                typename token_evaluator<Json,JsonReference>::frame f(expr_);
                 for (auto& member : current.object_range())
                 {
+                    if (receiver.stopped())
+                    {
+                        break;
+                    }
                     std::error_code ec;
-                    value_type r = expr_.evaluate(context, root, member.value(), options, ec);
-                    bool t = ec ? false : detail::is_true(r);
-                    if (t)
+                    if (expr_.test(context, root, member.value(), options, f, ec))
                     {
                         this->tail_select(context, root, 
                                             path_generator_type::generate(context, last, member.key(), options), 
@@ -1055,10 +1222,16 @@ namespace detail {
                 }
                 else if (j.is_string() && current.is_object())
                 {
+                    // Name the path node after the member key in the document, which outlives j
                     auto sv = j.as_string_view();
+                    auto it = current.find(sv);
+                    if (it == current.object_range().end())
+                    {
+                        JSONCONS_THROW(key_not_found(sv.data(), sv.length()));
+                    }
                     this->tail_select(context, root, 
-                                      path_generator_type::generate(context, last, sv, options),
-                                      current.at(j.as_string_view()), receiver, options);
+                                      path_generator_type::generate(context, last, (*it).key(), options),
+                                      (*it).value(), receiver, options);
                 }
             }
         }
@@ -1126,6 +1299,11 @@ namespace detail {
         {
         }
 
+        const slice& get_slice() const
+        {
+            return slice_;
+        }
+
         void select(eval_context<Json,JsonReference>& context,
                     reference root,
                     const path_node_type& last, 
@@ -1149,7 +1327,7 @@ namespace detail {
                     {
                         end = current.size();
                     }
-                    for (int64_t i = start; i < end; i += step)
+                    for (int64_t i = start; i < end && !receiver.stopped(); i += step)
                     {
                         auto j = static_cast<std::size_t>(i);
                         this->tail_select(context, root, 
@@ -1167,7 +1345,7 @@ namespace detail {
                     {
                         end = -1;
                     }
-                    for (int64_t i = start; i > end; i += step)
+                    for (int64_t i = start; i > end && !receiver.stopped(); i += step)
                     {
                         auto j = static_cast<std::size_t>(i);
                         if (j < current.size())
@@ -0,0 +1,197 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATH_KEY_INDEX_HPP
+#define JSONCONS_EXT_JSONPATH_KEY_INDEX_HPP
+
+#include <algorithm> // std::lower_bound
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility> // std::move
+#include <vector>
+
+#include <jsoncons/config/jsoncons_config.hpp>
+
+namespace jsoncons {
+namespace jsonpath {
+
+    // An inverted index from member name to the objects of a document that have a member with that
+    // name, used by recursive descent ($..name) to visit only those objects instead of walking the
+    // whole tree. The index is built on the first lookup and refers into the document, so the
+    // document must outlive it; call invalidate() after modifying the document. An index may be
+    // used by one evaluation at a time.
+    template <typename Json>
+    class key_index
+    {
+    public:
+        using value_type = Json;
+        using string_type = typename Json::string_type;
+        using string_view_type = typename Json::string_view_type;
+        using key_value_type = typename Json::key_value_type;
+
+        // An array or object of the document, numbered in document (pre-)order
+        struct node
+        {
+            const Json* value;
+            std::size_t parent;              // npos for the root
+            std::size_t end;                 // one past the number of the last descendant
+            const key_value_type* member;    // the member holding value, if parent is an object
+            std::size_t index;               // the position of value, if parent is an array
+        };
+
+        // An object having the looked up name, and its member with that name
+        struct entry
+        {
+            std::size_t object;
+            const key_value_type* member;
+        };
+
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    private:
+        const Json* root_;
+        bool built_;
+        std::vector<node> nodes_;
+        std::unordered_map<const Json*,std::size_t> numbers_;
+        std::unordered_map<string_type,std::vector<entry>> entries_;
+    public:
+        explicit key_index(const Json& root)
+            : root_(std::addressof(root)), built_(false)
+        {
+        }
+
+        key_index(const key_index&) = delete;
+        key_index& operator=(const key_index&) = delete;
+
+        const Json& root() const
+        {
+            return *root_;
+        }
+
+        bool built() const
+        {
+            return built_;
+        }
+
+        // Discards the index; it is rebuilt on the next lookup
+        void invalidate()
+        {
+            nodes_.clear();
+            numbers_.clear();
+            entries_.clear();
+            built_ = false;
+        }
+
+        // The number of arrays and objects in the document, once built
+        std::size_t node_count() const
+        {
+            return nodes_.size();
+        }
+
+        const node& at(std::size_t number) const
+        {
+            return nodes_[number];
+        }
+
+        // Returns the number of an array or object of the document, or npos
+        std::size_t number_of(const Json& value)
+        {
+            build();
+            if (nodes_.empty())
+            {
+                return npos;
+            }
+            if (std::addressof(value) == root_)
+            {
+                return 0;
+            }
+            // Only needed when a recursive descent starts below the root
+            if (numbers_.empty())
+            {
+                numbers_.reserve(nodes_.size());
+                for (std::size_t i = 0; i < nodes_.size(); ++i)
+                {
+                    numbers_.emplace(nodes_[i].value, i);
+                }
+            }
+            auto it = numbers_.find(std::addressof(value));
+            return it == numbers_.end() ? npos : it->second;
+        }
+
+        // Returns the objects having a member called name, in document order
+        const std::vector<entry>& lookup(const string_view_type& name)
+        {
+            static const std::vector<entry> none;
+
+            build();
+            auto it = entries_.find(string_type(name.data(), name.size()));
+            return it == entries_.end() ? none : it->second;
+        }
+
+        // Returns the entries whose object is number or one of its descendants
+        std::pair<typename std::vector<entry>::const_iterator,typename std::vector<entry>::const_iterator>
+        lookup(const string_view_type& name, std::size_t number)
+        {
+            const auto& found = lookup(name);
+            const std::size_t end = nodes_[number].end;
+            auto first = std::lower_bound(found.begin(), found.end(), number,
+                [](const entry& e, std::size_t n) { return e.object < n; });
+            auto last = std::lower_bound(first, found.end(), end,
+                [](const entry& e, std::size_t n) { return e.object < n; });
+            return std::make_pair(first, last);
+        }
+    private:
+        void build()
+        {
+            if (built_)
+            {
+                return;
+            }
+            if (root_->is_array() || root_->is_object())
+            {
+                add(*root_, npos, nullptr, 0);
+            }
+            built_ = true;
+        }
+
+        void add(const Json& value, std::size_t parent, const key_value_type* member, std::size_t index)
+        {
+            const std::size_t number = nodes_.size();
+            nodes_.push_back(node{std::addressof(value), parent, 0, member, index});
+
+            if (value.is_object())
+            {
+                for (const auto& item : value.object_range())
+                {
+                    entries_[string_type(item.key().data(), item.key().size())].push_back(entry{number, std::addressof(item)});
+                }
+                for (const auto& item : value.object_range())
+                {
+                    if (item.value().is_array() || item.value().is_object())
+                    {
+                        add(item.value(), number, std::addressof(item), 0);
+                    }
+                }
+            }
+            else
+            {
+                for (std::size_t i = 0; i < value.size(); ++i)
+                {
+                    if (value[i].is_array() || value[i].is_object())
+                    {
+                        add(value[i], number, nullptr, i);
+                    }
+                }
+            }
+            nodes_[number].end = nodes_.size();
+        }
+    };
+
+} // namespace jsonpath
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATH_KEY_INDEX_HPP
@@ -0,0 +1,277 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATH_NODE_LIST_HPP
+#define JSONCONS_EXT_JSONPATH_NODE_LIST_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility> // std::move
+#include <vector>
+
+#include <jsoncons/config/jsoncons_config.hpp>
+#include <jsoncons/json_type.hpp>
+#include <jsoncons/semantic_tag.hpp>
+
+#include <jsoncons_ext/jsonpath/token_evaluator.hpp>
+#include <jsoncons_ext/jsonpath/json_location.hpp>
+#include <jsoncons_ext/jsonpath/key_index.hpp>
+#include <jsoncons_ext/jsonpath/path_node.hpp>
+
+namespace jsoncons {
+namespace jsonpath {
+
+    // The nodes matched by a JSONPath query, referenced in place rather than copied into a result
+    // array. The queried document must outlive the list and must not be modified while it is in use.
+    // Normalized paths (with result_options::path) and values computed during evaluation, such as a
+    // length, are owned by the list. Use to_array() to take copies of the matched values.
+    //
+    // update() and remove() need the path of each match. A list with a non-const JsonReference
+    // always records them; a const list records them only if evaluated with result_options::path,
+    // and otherwise update() throws std::logic_error.
+    //
+    // With a non-const JsonReference the list holds resolved mutable locations (see
+    // jsonpath_expression::resolve), so that several updates can be applied to the matches of one
+    // evaluation. The locations stay valid while each update only modifies or replaces the node it
+    // is given. Replacing a node invalidates entries for its descendants, and any other structural
+    // edit of the document (adding or erasing members or elements) invalidates the list; remove()
+    // erases the matches and empties the list.
+    template <typename Json,typename JsonReference = const Json&>
+    class node_list
+    {
+    public:
+        using value_type = typename std::remove_const<Json>::type;
+        using allocator_type = typename value_type::allocator_type;
+        using char_type = typename value_type::char_type;
+        using reference = JsonReference;
+        using const_reference = const value_type&;
+        using value_pointer = typename std::conditional<std::is_const<typename std::remove_reference<JsonReference>::type>::value,const value_type*,value_type*>::type;
+        using path_node_type = basic_path_node<char_type>;
+        using path_expression_type = jsoncons::jsonpath::detail::path_expression<value_type,reference>;
+        using size_type = std::size_t;
+
+        class iterator
+        {
+            typename std::vector<value_pointer>::const_iterator it_;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = typename node_list::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = typename node_list::value_pointer;
+            using reference = typename node_list::reference;
+
+            iterator() = default;
+
+            explicit iterator(typename std::vector<value_pointer>::const_iterator it)
+                : it_(it)
+            {
+            }
+
+            reference operator*() const
+            {
+                return **it_;
+            }
+
+            pointer operator->() const
+            {
+                return *it_;
+            }
+
+            iterator& operator++()
+            {
+                ++it_;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator temp(*this);
+                ++it_;
+                return temp;
+            }
+
+            friend bool operator==(const iterator& lhs, const iterator& rhs)
+            {
+                return lhs.it_ == rhs.it_;
+            }
+
+            friend bool operator!=(const iterator& lhs, const iterator& rhs)
+            {
+                return lhs.it_ != rhs.it_;
+            }
+        };
+
+        using const_iterator = iterator;
+
+    private:
+        // Heap allocated so that the path nodes and computed values it owns keep their addresses
+        // when the list is moved
+        struct storage
+        {
+            jsoncons::jsonpath::detail::eval_context<value_type,reference> context;
+            path_node_type root_path;
+
+            storage(const allocator_type& alloc)
+                : context(alloc)
+            {
+            }
+        };
+
+        allocator_type alloc_;
+        value_pointer root_;
+        std::unique_ptr<storage> storage_;
+        std::vector<value_pointer> values_;
+        std::vector<const path_node_type*> paths_;
+        bool with_path_;
+    public:
+        explicit node_list(const allocator_type& alloc = allocator_type())
+            : alloc_(alloc), root_(nullptr), with_path_(true)
+        {
+        }
+
+        // Evaluates expr against root; used by jsonpath_expression::select_nodes, resolve and json_query_nodes
+        node_list(const path_expression_type& expr, reference root, result_options options,
+            const allocator_type& alloc = allocator_type())
+            : node_list(expr, root, options, nullptr, alloc)
+        {
+        }
+
+        // As above, with recursive descent served from index, which must be an index of root
+        node_list(const path_expression_type& expr, reference root, result_options options,
+            key_index<value_type>* index, const allocator_type& alloc = allocator_type())
+            : alloc_(alloc), root_(std::addressof(root)), storage_(jsoncons::make_unique<storage>(alloc))
+        {
+            storage_->context.set_key_index(index);
+            if (!std::is_const<typename std::remove_reference<JsonReference>::type>::value)
+            {
+                options |= result_options::path;
+            }
+            with_path_ = (options & result_options::path) == result_options::path;
+            auto callback = [this](const path_node_type& path, reference value)
+            {
+                values_.push_back(std::addressof(value));
+                if (with_path_)
+                {
+                    paths_.push_back(std::addressof(path));
+                }
+            };
+            expr.evaluate(storage_->context, root, storage_->root_path, root, callback, options);
+        }
+
+        node_list(const node_list&) = delete;
+        node_list(node_list&&) = default;
+
+        ~node_list() = default;
+
+        node_list& operator=(const node_list&) = delete;
+        node_list& operator=(node_list&&) = default;
+
+        size_type size() const
+        {
+            return values_.size();
+        }
+
+        bool empty() const
+        {
+            return values_.empty();
+        }
+
+        reference operator[](size_type i) const
+        {
+            return *values_[i];
+        }
+
+        reference at(size_type i) const
+        {
+            if (i >= values_.size())
+            {
+                JSONCONS_THROW(std::out_of_range("Index out of range"));
+            }
+            return *values_[i];
+        }
+
+        iterator begin() const
+        {
+            return iterator(values_.begin());
+        }
+
+        iterator end() const
+        {
+            return iterator(values_.end());
+        }
+
+        // True if the list records the path of each match
+        bool has_paths() const
+        {
+            return with_path_;
+        }
+
+        const path_node_type& path(size_type i) const
+        {
+            if (i >= paths_.size())
+            {
+                JSONCONS_THROW(std::out_of_range("Index out of range"));
+            }
+            return *paths_[i];
+        }
+
+        // Calls callback(path, value) for each match, in the order of evaluation. For a list from
+        // jsonpath_expression::resolve that is descending path order, so a node's descendants are
+        // visited before the node itself. Throws std::logic_error if the list has no paths.
+        template <typename BinaryCallback>
+        void update(BinaryCallback callback) const
+        {
+            if (!with_path_)
+            {
+                JSONCONS_THROW(std::logic_error("node_list::update requires result_options::path"));
+            }
+            for (size_type i = 0; i < values_.size(); ++i)
+            {
+                callback(path(i), *values_[i]);
+            }
+        }
+
+        // Erases the matched nodes from the document and empties the list. Returns the number of
+        // nodes removed.
+        size_type remove()
+        {
+            std::vector<basic_json_location<char_type>> locations;
+            locations.reserve(paths_.size());
+            for (auto p : paths_)
+            {
+                locations.emplace_back(*p);
+            }
+            values_.clear();
+            paths_.clear();
+
+            size_type count = 0;
+            for (const auto& location : locations)
+            {
+                count += jsoncons::jsonpath::remove(*root_, location);
+            }
+            return count;
+        }
+
+        // Copies the matched values into an array, as json_query returns them
+        value_type to_array() const
+        {
+            value_type result(json_array_arg, semantic_tag::none, alloc_);
+            result.reserve(values_.size());
+            for (auto ptr : values_)
+            {
+                result.push_back(*ptr);
+            }
+            return result;
+        }
+    };
+
+} // namespace jsonpath
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATH_NODE_LIST_HPP
@@ -127,6 +127,8 @@ namespace jsonpath {
             return diff;
         }
 
+        // Paths are compared from the leaf up. Matches produced by one evaluation share the path
+        // nodes of their common prefix, so the walk stops at the first node the two chains share.
         friend bool operator<(const basic_path_node& lhs, const basic_path_node& rhs)
         {
             std::size_t len = (std::min)(lhs.size(),rhs.size());
@@ -145,28 +147,9 @@ namespace jsonpath {
                 p_rhs = p_rhs->parent_;
                 is_less = true;
             }
-            while (p_lhs != nullptr)
+            while (p_lhs != nullptr && p_lhs != p_rhs)
             {
-                int diff = 0;
-                if (p_lhs->node_kind_ != p_rhs->node_kind_)
-                {
-                    diff = static_cast<int>(p_lhs->node_kind_) - static_cast<int>(p_rhs->node_kind_);
-                }
-                else
-                {
-                    switch (p_lhs->node_kind_)
-                    {
-                        case path_node_kind::root:
-                        case path_node_kind::name:
-                            diff = p_lhs->name_.compare(p_rhs->name_);
-                            break;
-                        case path_node_kind::index:
-                            diff = static_cast<int>(p_lhs->index_) - static_cast<int>(p_rhs->index_);
-                            break;
-                        default:
-                            break;
-                    }
-                }
+                int diff = p_lhs->compare_node(*p_rhs);
                 if (diff < 0)
                 {
                     is_less = true;
@@ -193,33 +176,17 @@ namespace jsonpath {
             const basic_path_node* p_lhs = std::addressof(lhs);
             const basic_path_node* p_rhs = std::addressof(rhs);
 
-            bool is_equal = true;
-            while (p_lhs != nullptr && is_equal)
+            while (p_lhs != nullptr && p_lhs != p_rhs)
             {
-                if (p_lhs->node_kind_ != p_rhs->node_kind_)
-                {
-                    is_equal = false;
-                }
-                else
+                if (p_lhs->compare_node(*p_rhs) != 0)
                 {
-                    switch (p_lhs->node_kind_)
-                    {
-                        case path_node_kind::root:
-                        case path_node_kind::name:
-                            is_equal = p_lhs->name_ == p_rhs->name_;
-                            break;
-                        case path_node_kind::index:
-                            is_equal = p_lhs->index_ == p_rhs->index_;
-                            break;
-                        default:
-                            break;
-                    }
+                    return false;
                 }
                 p_lhs = p_lhs->parent_;
                 p_rhs = p_rhs->parent_;
             }
 
-            return is_equal;
+            return true;
         }
     };
 
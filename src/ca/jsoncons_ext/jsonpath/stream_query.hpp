@@ -0,0 +1,1240 @@
+// Copyright 2013-2025 Daniel Parker
+// Distributed under the Boost license, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// See https://github.com/danielaparker/jsoncons for latest version
+
+#ifndef JSONCONS_EXT_JSONPATH_STREAM_QUERY_HPP
+#define JSONCONS_EXT_JSONPATH_STREAM_QUERY_HPP
+
+#include <algorithm> // std::stable_sort
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+#include <utility> // std::move
+#include <vector>
+
+#include <jsoncons/allocator_set.hpp>
+#include <jsoncons/basic_json.hpp>
+#include <jsoncons/config/jsoncons_config.hpp>
+#include <jsoncons/json_decoder.hpp>
+#include <jsoncons/json_exception.hpp>
+#include <jsoncons/staj_cursor.hpp>
+#include <jsoncons/utility/more_type_traits.hpp>
+
+#include <jsoncons_ext/jsonpath/expression_cache.hpp>
+#include <jsoncons_ext/jsonpath/jsonpath_expression.hpp>
+#include <jsoncons_ext/jsonpath/jsonpath_selector.hpp>
+#include <jsoncons_ext/jsonpath/token_evaluator.hpp>
+
+namespace jsoncons {
+namespace jsonpath {
+
+    // Evaluates a set of JSONPath expressions in one pass over a staj cursor, without building the
+    // document. Only expressions that one pass can decide are accepted: member names, non-negative
+    // indices, wildcards, slices with non-negative bounds and a positive step, and recursive
+    // descent. Only the values that match are materialized, so memory is bounded by the nesting
+    // depth of the input plus the size of the matches. Matches are delivered in the order, and
+    // under the options, that evaluating the expression over the parsed document would give. The
+    // same expressions can also be answered together from a parsed document, in one walk over it.
+    template <typename Json>
+    class stream_query
+    {
+    public:
+        using value_type = typename jsonpath_traits<Json>::value_type;
+        using const_reference = typename jsonpath_traits<Json>::const_reference;
+        using char_type = typename jsonpath_traits<Json>::char_type;
+        using string_view_type = typename jsonpath_traits<Json>::string_view_type;
+        using string_type = typename jsonpath_traits<Json>::string_type;
+        using expression_type = jsonpath_expression<Json>;
+        using expression_pointer = std::shared_ptr<const expression_type>;
+        using path_node_type = basic_path_node<char_type>;
+        using cursor_type = basic_staj_cursor<char_type>;
+
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        // The most recursive descents one expression may contain
+        static constexpr std::size_t max_descents = 4;
+    private:
+        using selector_type = jsoncons::jsonpath::detail::jsonpath_selector<value_type,const_reference>;
+        using context_type = jsoncons::jsonpath::detail::eval_context<value_type,const_reference>;
+        using path_value_pair_type = jsoncons::jsonpath::detail::path_value_pair<value_type,const_reference>;
+
+        // Sorted objects list their members by name; others keep the order of the input
+        static constexpr bool members_sorted = !std::is_same<typename value_type::policy_type,order_preserving_policy>::value;
+
+        enum class step_kind : uint8_t {name, index, name_or_index, wildcard, slice, descent};
+
+        struct step
+        {
+            step_kind kind;
+            string_type name;
+            std::size_t index;  // also the start of a slice
+            std::size_t stop;   // npos for an open slice
+            std::size_t stride;
+
+            step(step_kind kind)
+                : kind(kind), index(0), stop(npos), stride(1)
+            {
+            }
+        };
+
+        struct query
+        {
+            std::vector<step> steps;
+            bool singular; // at most one match: names and indices only
+        };
+
+        // A partial match of a query at a node: steps before step are done, and the i-th descent
+        // stopped at depth stops[i]
+        struct state
+        {
+            uint32_t query;
+            uint32_t step;
+            uint32_t stop_count;
+            uint32_t stops[max_descents];
+        };
+
+        // How a node is reached from its parent
+        struct component
+        {
+            string_type name;
+            std::size_t index;  // array index, or position among the members of the parent
+            bool is_name;
+        };
+
+        // A matched node: its path, and its value once read
+        struct node
+        {
+            std::vector<component> path;
+            value_type value;
+        };
+
+        struct match
+        {
+            std::size_t node;
+            uint32_t stop_count;
+            uint32_t stops[max_descents];
+        };
+
+        std::vector<query> queries_;
+    public:
+        // Adds path, compiled through the process-wide expression cache, and returns its position,
+        // or npos, adding nothing, if one pass cannot evaluate it. Throws jsonpath_error if path
+        // does not compile.
+        std::size_t add(const string_view_type& path)
+        {
+            return add(cached_expression<Json>(path));
+        }
+
+        std::size_t add(const expression_pointer& expr)
+        {
+            query q;
+            if (!compile(expr->const_expression().selector(), q))
+            {
+                return npos;
+            }
+            queries_.push_back(std::move(q));
+            return queries_.size() - 1;
+        }
+
+        std::size_t size() const
+        {
+            return queries_.size();
+        }
+
+        // True if the i-th expression has names and indices only, so has at most one match
+        bool singular(std::size_t i) const
+        {
+            return queries_[i].singular;
+        }
+
+        // Calls callback(i, path, value) for each match of the i-th expression, expression by
+        // expression in the order they were added, with each expression's matches in the order
+        // and under the options evaluating it over the parsed document would give. Reads cursor
+        // to the end of the current value.
+        template <typename Callback>
+        void select(cursor_type& cursor, Callback callback, result_options options = result_options()) const
+        {
+            pass p(*this, false);
+            p.run(cursor);
+
+            context_type context;
+            std::vector<const path_node_type*> paths(p.nodes.size(), nullptr);
+            for (std::size_t i = 0; i < queries_.size(); ++i)
+            {
+                std::vector<match>& matches = p.matches[i];
+                std::stable_sort(matches.begin(), matches.end(),
+                    [&p](const match& a, const match& b) { return p.before(a, b); });
+
+                std::vector<path_value_pair_type> found;
+                found.reserve(matches.size());
+                for (const auto& m : matches)
+                {
+                    if (paths[m.node] == nullptr)
+                    {
+                        paths[m.node] = make_path(context, p.nodes[m.node].path);
+                    }
+                    found.emplace_back(*paths[m.node], p.nodes[m.node].value);
+                }
+                auto f = [&callback, i](const path_node_type& path, const_reference value)
+                {
+                    callback(i, path, value);
+                };
+                jsoncons::jsonpath::detail::deliver_path_values(found, options, f);
+            }
+        }
+
+        // Returns the first match of each expression, as jsonpath_expression::first does over the
+        // parsed document, in the order the expressions were added. Stops reading as soon as
+        // every expression has at most one match and all of them have been found; the rest of
+        // the input is then left unread.
+        std::vector<value_or_pointer<value_type,const_reference>> first(cursor_type& cursor) const
+        {
+            pass p(*this, true);
+            p.run(cursor);
+
+            std::vector<value_or_pointer<value_type,const_reference>> result;
+            result.reserve(queries_.size());
+            for (std::size_t i = 0; i < queries_.size(); ++i)
+            {
+                if (p.matches[i].empty())
+                {
+                    result.emplace_back(static_cast<const value_type*>(nullptr));
+                }
+                else
+                {
+                    // Queries can share a node; only the last of them takes its value
+                    const std::size_t n = p.matches[i].front().node;
+                    bool shared = false;
+                    for (std::size_t j = i + 1; j < queries_.size() && !shared; ++j)
+                    {
+                        shared = !p.matches[j].empty() && p.matches[j].front().node == n;
+                    }
+                    if (shared)
+                    {
+                        result.emplace_back(value_type(p.nodes[n].value));
+                    }
+                    else
+                    {
+                        result.emplace_back(std::move(p.nodes[n].value));
+                    }
+                }
+            }
+            return result;
+        }
+
+        // Returns the first match of each expression in root, as jsonpath_expression::first does,
+        // in the order the expressions were added. An expression of names and indices only is
+        // followed with member and element lookups; all the others are answered together by one
+        // walk over root, which enters a member or element only if one of them can match below
+        // it. The results point into root.
+        std::vector<value_or_pointer<value_type,const_reference>> first(const_reference root) const
+        {
+            document_pass p(*this);
+            p.run(root);
+
+            std::vector<value_or_pointer<value_type,const_reference>> result;
+            result.reserve(queries_.size());
+            for (std::size_t i = 0; i < queries_.size(); ++i)
+            {
+                result.emplace_back(queries_[i].singular ? lookup(queries_[i], root) : p.first_of(i));
+            }
+            return result;
+        }
+    private:
+        // Translates the selectors of a compiled expression into steps; false if one of them
+        // needs more than one pass (filters, unions, negative positions, lengths, functions)
+        static bool compile(const selector_type* head, query& q)
+        {
+            using root_selector_type = jsoncons::jsonpath::detail::root_selector<value_type,const_reference>;
+            using current_node_selector_type = jsoncons::jsonpath::detail::current_node_selector<value_type,const_reference>;
+            using union_selector_type = jsoncons::jsonpath::detail::union_selector<value_type,const_reference>;
+            using identifier_selector_type = jsoncons::jsonpath::detail::identifier_selector<value_type,const_reference>;
+            using index_selector_type = jsoncons::jsonpath::detail::index_selector<value_type,const_reference>;
+            using wildcard_selector_type = jsoncons::jsonpath::detail::wildcard_selector<value_type,const_reference>;
+            using slice_selector_type = jsoncons::jsonpath::detail::slice_selector<value_type,const_reference>;
+            using recursive_selector_type = jsoncons::jsonpath::detail::recursive_selector<value_type,const_reference>;
+            using base_selector_type = jsoncons::jsonpath::detail::base_selector<value_type,const_reference>;
+
+            static const string_type length_label{JSONCONS_CSTRING_CONSTANT(char_type, "length")};
+
+            // A top-level expression starts from the root whether it begins with $ or @
+            if (dynamic_cast<const root_selector_type*>(head) == nullptr && dynamic_cast<const current_node_selector_type*>(head) == nullptr)
+            {
+                return false;
+            }
+            std::size_t descents = 0;
+            q.singular = true;
+            for (const selector_type* s = static_cast<const base_selector_type*>(head)->tail(); s != nullptr; s = static_cast<const base_selector_type*>(s)->tail())
+            {
+                // A bracket holding one selector, e.g. [1:], is a union of one; its selector
+                // continues with the union's tail
+                while (auto single = dynamic_cast<const union_selector_type*>(s))
+                {
+                    if (single->selectors().size() != 1)
+                    {
+                        return false;
+                    }
+                    s = single->selectors().front();
+                }
+                if (auto identifier = dynamic_cast<const identifier_selector_type*>(s))
+                {
+                    const string_type& name = identifier->identifier();
+                    if (name == length_label)
+                    {
+                        return false;
+                    }
+                    int64_t n{0};
+                    if (jsoncons::utility::dec_to_integer(name.data(), name.size(), n))
+                    {
+                        if (n < 0)
+                        {
+                            return false;
+                        }
+                        q.steps.emplace_back(step_kind::name_or_index);
+                        q.steps.back().index = static_cast<std::size_t>(n);
+                    }
+                    else
+                    {
+                        q.steps.emplace_back(step_kind::name);
+                    }
+                    q.steps.back().name = name;
+                }
+                else if (auto index = dynamic_cast<const index_selector_type*>(s))
+                {
+                    if (index->index() < 0)
+                    {
+                        return false;
+                    }
+                    q.steps.emplace_back(step_kind::index);
+                    q.steps.back().index = static_cast<std::size_t>(index->index());
+                }
+                else if (dynamic_cast<const wildcard_selector_type*>(s) != nullptr)
+                {
+                    q.steps.emplace_back(step_kind::wildcard);
+                    q.singular = false;
+                }
+                else if (auto slice = dynamic_cast<const slice_selector_type*>(s))
+                {
+                    const auto& slic = slice->get_slice();
+                    if ((slic.start_ && *slic.start_ < 0) || (slic.stop_ && *slic.stop_ < 0) || slic.step() <= 0)
+                    {
+                        return false;
+                    }
+                    q.steps.emplace_back(step_kind::slice);
+                    q.steps.back().index = slic.start_ ? static_cast<std::size_t>(*slic.start_) : 0;
+                    q.steps.back().stop = slic.stop_ ? static_cast<std::size_t>(*slic.stop_) : npos;
+                    q.steps.back().stride = static_cast<std::size_t>(slic.step());
+                    q.singular = false;
+                }
+                else if (dynamic_cast<const recursive_selector_type*>(s) != nullptr)
+                {
+                    if (++descents > max_descents)
+                    {
+                        return false;
+                    }
+                    q.steps.emplace_back(step_kind::descent);
+                    q.singular = false;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // True if the match at path pa, whose descents stopped at depths sa, comes before the one
+        // at pb when evaluating their query over the document: paths are compared component by
+        // component, member names in object order, with a descent that stopped at a node coming
+        // before one that went on into its children
+        template <typename Component>
+        static bool precedes(const Component* pa, std::size_t na, const uint32_t* sa, uint32_t sa_count,
+            const Component* pb, std::size_t nb, const uint32_t* sb, uint32_t sb_count)
+        {
+            uint32_t ia = 0;
+            uint32_t ib = 0;
+            for (std::size_t d = 0; ; ++d)
+            {
+                while (ia < sa_count && sa[ia] == d && ib < sb_count && sb[ib] == d)
+                {
+                    ++ia;
+                    ++ib;
+                }
+                const bool a_stops = ia < sa_count && sa[ia] == d;
+                const bool b_stops = ib < sb_count && sb[ib] == d;
+                if (a_stops != b_stops)
+                {
+                    return a_stops;
+                }
+                if (d == na || d == nb)
+                {
+                    return na < nb;
+                }
+                const auto& ca = pa[d];
+                const auto& cb = pb[d];
+                if (ca.is_name && members_sorted)
+                {
+                    int diff = ca.name.compare(cb.name);
+                    if (diff != 0)
+                    {
+                        return diff < 0;
+                    }
+                }
+                else if (ca.index != cb.index)
+                {
+                    return ca.index < cb.index;
+                }
+            }
+        }
+
+        // The match of a query of names and indices only, or null
+        static const value_type* lookup(const query& q, const_reference root)
+        {
+            const value_type* current = std::addressof(root);
+            for (const auto& st : q.steps)
+            {
+                if (current->is_object() && st.kind != step_kind::index)
+                {
+                    auto it = current->find(string_view_type(st.name.data(), st.name.size()));
+                    if (it == current->object_range().end())
+                    {
+                        return nullptr;
+                    }
+                    current = std::addressof(it->value());
+                }
+                else if (current->is_array() && st.kind != step_kind::name && st.index < current->size())
+                {
+                    current = std::addressof(current->at(st.index));
+                }
+                else
+                {
+                    return nullptr;
+                }
+            }
+            return current;
+        }
+
+        static const path_node_type* make_path(context_type& context, const std::vector<component>& path)
+        {
+            const path_node_type* last = context.create_path_node();
+            for (const auto& c : path)
+            {
+                last = c.is_name ? context.create_path_node(last, string_view_type(c.name.data(), c.name.size()))
+                                 : context.create_path_node(last, c.index);
+            }
+            return last;
+        }
+
+        // The state of one pass over the input
+        class pass
+        {
+            // An array or object being read, and the partial matches at it
+            struct frame
+            {
+                bool is_object;
+                std::size_t count;
+                std::vector<state> states;
+            };
+
+            // A matched array or object whose value is still being read
+            struct capture
+            {
+                std::size_t node;
+                std::size_t depth;
+                json_decoder<value_type>* decoder;
+            };
+
+            const stream_query& query_;
+            bool first_only_;
+            std::vector<frame> frames_;     // reused by depth
+            std::size_t depth_;             // the number of open arrays and objects
+            std::vector<component> path_;   // reused by depth
+            std::vector<state> scratch_;
+            std::vector<capture> captures_;
+            std::vector<std::unique_ptr<json_decoder<value_type>>> decoders_;
+            std::vector<json_decoder<value_type>*> free_decoders_;
+            std::size_t settled_;
+        public:
+            std::vector<node> nodes;
+            std::vector<std::vector<match>> matches; // per query; with first_only, at most one
+
+            pass(const stream_query& query, bool first_only)
+                : query_(query), first_only_(first_only), depth_(0), settled_(0),
+                  matches(query.queries_.size())
+            {
+            }
+
+            void run(cursor_type& cursor)
+            {
+                if (query_.queries_.empty())
+                {
+                    return;
+                }
+                std::error_code ec;
+                for (; !cursor.done(); cursor.next())
+                {
+                    const auto& event = cursor.current();
+                    switch (event.event_type())
+                    {
+                        case staj_event_type::key:
+                        {
+                            frame& parent = frames_[depth_ - 1];
+                            component& c = path_[depth_ - 1];
+                            auto key = event.template get<string_view_type>(ec);
+                            c.name.assign(key.data(), key.size());
+                            c.index = parent.count;
+                            c.is_name = true;
+                            forward(cursor, ec);
+                            break;
+                        }
+                        case staj_event_type::begin_array:
+                        case staj_event_type::begin_object:
+                        {
+                            forward(cursor, ec);
+                            visit(cursor, event.event_type() == staj_event_type::begin_object);
+                            break;
+                        }
+                        case staj_event_type::end_array:
+                        case staj_event_type::end_object:
+                        {
+                            forward(cursor, ec);
+                            --depth_;
+                            complete_captures();
+                            break;
+                        }
+                        default:
+                        {
+                            forward(cursor, ec);
+                            visit_scalar(cursor);
+                            break;
+                        }
+                    }
+                    if (ec)
+                    {
+                        JSONCONS_THROW(ser_error(ec, cursor.line(), cursor.column()));
+                    }
+                    if (depth_ == 0 || (first_only_ && settled_ == query_.queries_.size() && captures_.empty()))
+                    {
+                        return;
+                    }
+                }
+            }
+
+            bool before(const match& a, const match& b) const
+            {
+                const std::vector<component>& pa = nodes[a.node].path;
+                const std::vector<component>& pb = nodes[b.node].path;
+                return precedes(pa.data(), pa.size(), a.stops, a.stop_count, pb.data(), pb.size(), b.stops, b.stop_count);
+            }
+        private:
+            // Passes the current event to every value being read
+            void forward(cursor_type& cursor, std::error_code& ec)
+            {
+                for (auto& c : captures_)
+                {
+                    cursor.current().send_json_event(*c.decoder, cursor.context(), ec);
+                }
+            }
+
+            // The partial matches at the node the current event starts, from those at its parent
+            void advance()
+            {
+                scratch_.clear();
+                if (depth_ == 0)
+                {
+                    for (std::size_t i = 0; i < query_.queries_.size(); ++i)
+                    {
+                        scratch_.push_back(state{static_cast<uint32_t>(i), 0, 0, {}});
+                    }
+                    return;
+                }
+                frame& parent = frames_[depth_ - 1];
+                component& c = path_[depth_ - 1];
+                if (!parent.is_object)
+                {
+                    c.index = parent.count;
+                    c.is_name = false;
+                }
+                ++parent.count;
+
+                for (const auto& s : parent.states)
+                {
+                    const step& st = query_.queries_[s.query].steps[s.step];
+                    bool next = false;
+                    switch (st.kind)
+                    {
+                        case step_kind::name:
+                            next = c.is_name && c.name == st.name;
+                            break;
+                        case step_kind::index:
+                            next = !c.is_name && c.index == st.index;
+                            break;
+                        case step_kind::name_or_index:
+                            next = c.is_name ? c.name == st.name : c.index == st.index;
+                            break;
+                        case step_kind::wildcard:
+                            next = true;
+                            break;
+                        case step_kind::slice:
+                            next = !c.is_name && c.index >= st.index && c.index < st.stop && (c.index - st.index) % st.stride == 0;
+                            break;
+                        case step_kind::descent:
+                            scratch_.push_back(s);
+                            break;
+                    }
+                    if (next)
+                    {
+                        scratch_.push_back(s);
+                        ++scratch_.back().step;
+                    }
+                }
+            }
+
+            void visit(cursor_type& cursor, bool is_object)
+            {
+                advance();
+
+                // A descent also applies the rest of its query to the array or object itself
+                for (std::size_t i = 0; i < scratch_.size(); ++i)
+                {
+                    state s = scratch_[i];
+                    const auto& steps = query_.queries_[s.query].steps;
+                    if (s.step < steps.size() && steps[s.step].kind == step_kind::descent)
+                    {
+                        s.stops[s.stop_count++] = static_cast<uint32_t>(depth_);
+                        ++s.step;
+                        scratch_.push_back(s);
+                    }
+                }
+                std::size_t node = record_matches();
+
+                if (frames_.size() == depth_)
+                {
+                    frames_.emplace_back();
+                    path_.emplace_back();
+                }
+                frame& f = frames_[depth_];
+                f.is_object = is_object;
+                f.count = 0;
+                f.states.clear();
+                for (const auto& s : scratch_)
+                {
+                    if (s.step < query_.queries_[s.query].steps.size())
+                    {
+                        f.states.push_back(s);
+                    }
+                }
+                ++depth_;
+
+                if (node != npos)
+                {
+                    json_decoder<value_type>* decoder = acquire_decoder();
+                    std::error_code ec;
+                    cursor.current().send_json_event(*decoder, cursor.context(), ec);
+                    captures_.push_back(capture{node, depth_ - 1, decoder});
+                }
+            }
+
+            void visit_scalar(cursor_type& cursor)
+            {
+                advance();
+                std::size_t node = record_matches();
+                if (node != npos)
+                {
+                    auto result = to_json_single<value_type>(make_alloc_set(), cursor);
+                    if (!result)
+                    {
+                        JSONCONS_THROW(ser_error(result.error().code(), result.error().line(), result.error().column()));
+                    }
+                    nodes[node].value = std::move(result.value());
+                }
+            }
+
+            // Records the complete matches in scratch_ at the current node, returning the node if
+            // its value is wanted
+            std::size_t record_matches()
+            {
+                std::size_t node = npos;
+                for (const auto& s : scratch_)
+                {
+                    const query& q = query_.queries_[s.query];
+                    if (s.step < q.steps.size())
+                    {
+                        continue;
+                    }
+                    if (node == npos)
+                    {
+                        nodes.push_back(current_node());
+                        node = nodes.size() - 1;
+                    }
+                    match m{node, s.stop_count, {}};
+                    for (uint32_t i = 0; i < s.stop_count; ++i)
+                    {
+                        m.stops[i] = s.stops[i];
+                    }
+                    std::vector<match>& found = matches[s.query];
+                    if (!first_only_)
+                    {
+                        found.push_back(m);
+                    }
+                    else if (found.empty())
+                    {
+                        found.push_back(m);
+                        if (q.singular)
+                        {
+                            ++settled_;
+                        }
+                    }
+                    else if (before(m, found.front()))
+                    {
+                        const std::size_t replaced = found.front().node;
+                        found.front() = m;
+                        if (replaced != node && !wanted(replaced))
+                        {
+                            nodes[replaced].path.clear();
+                            nodes[replaced].value = value_type();
+                        }
+                    }
+                }
+                if (node != npos && first_only_ && !wanted(node))
+                {
+                    nodes.pop_back();
+                    return npos;
+                }
+                return node;
+            }
+
+            node current_node() const
+            {
+                return node{std::vector<component>(path_.begin(), path_.begin() + static_cast<std::ptrdiff_t>(depth_)), value_type()};
+            }
+
+            // With first_only, a node is read only while it is some query's best match
+            bool wanted(std::size_t n) const
+            {
+                for (const auto& found : matches)
+                {
+                    if (!found.empty() && found.front().node == n)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Completes the values of the array or object that just ended, and stops reading the
+            // ones no query wants any more
+            void complete_captures()
+            {
+                std::size_t kept = 0;
+                for (std::size_t i = 0; i < captures_.size(); ++i)
+                {
+                    capture& c = captures_[i];
+                    if (c.depth == depth_)
+                    {
+                        nodes[c.node].value = c.decoder->get_result();
+                        release_decoder(c.decoder);
+                    }
+                    else if (first_only_ && !wanted(c.node))
+                    {
+                        release_decoder(c.decoder);
+                    }
+                    else
+                    {
+                        captures_[kept++] = c;
+                    }
+                }
+                captures_.resize(kept);
+            }
+
+            json_decoder<value_type>* acquire_decoder()
+            {
+                if (!free_decoders_.empty())
+                {
+                    json_decoder<value_type>* decoder = free_decoders_.back();
+                    free_decoders_.pop_back();
+                    return decoder;
+                }
+                decoders_.push_back(jsoncons::make_unique<json_decoder<value_type>>());
+                return decoders_.back().get();
+            }
+
+            void release_decoder(json_decoder<value_type>* decoder)
+            {
+                decoder->reset();
+                free_decoders_.push_back(decoder);
+            }
+        };
+
+        // The state of one walk over a parsed document. The queries are merged into a trie of
+        // their steps, so that queries sharing a prefix share its partial matches, and the
+        // children of a node are looked up by name or index instead of being tried query by query.
+        class document_pass
+        {
+            static constexpr uint32_t no_node = static_cast<uint32_t>(-1);
+            static constexpr std::size_t max_linear_lookups = 4;
+
+            // The steps leading to a trie node, from the root, are a prefix of each query below
+            // it. Names are found through a hash table of positions in names, indices by binary
+            // search.
+            struct trie_node
+            {
+                bool is_end;                                                // some query ends here
+                std::vector<std::pair<string_type,uint32_t>> names;         // name and name_or_index steps
+                std::vector<uint32_t> name_slots;                           // open addressing, a power of two
+                std::vector<std::pair<std::size_t,uint32_t>> indices;       // index steps
+                std::vector<std::pair<std::size_t,uint32_t>> numbers;       // name_or_index steps, on arrays
+                std::vector<std::pair<const step*,uint32_t>> slices;
+                uint32_t wildcard;
+                uint32_t descent;
+
+                trie_node()
+                    : is_end(false), wildcard(no_node), descent(no_node)
+                {
+                }
+            };
+
+            // A partial match at a node: the steps to trie node node are done, or, if descending,
+            // node's descent is under way. The i-th descent stopped at depth stops[i].
+            struct dom_state
+            {
+                uint32_t node;
+                bool descending;
+                uint32_t stop_count;
+                uint32_t stops[max_descents];
+            };
+
+            // How a node is reached from its parent; names point into the document
+            struct dom_component
+            {
+                string_view_type name;
+                std::size_t index;
+                bool is_name;
+            };
+
+            struct best_match
+            {
+                const value_type* value;
+                std::vector<dom_component> path;
+                uint32_t stop_count;
+                uint32_t stops[max_descents];
+
+                best_match()
+                    : value(nullptr), stop_count(0)
+                {
+                }
+            };
+
+            const stream_query& query_;
+            std::vector<trie_node> trie_;
+            std::deque<std::vector<dom_state>> frames_; // reused by depth; a deque keeps references valid
+            std::vector<dom_component> path_;           // reused by depth
+            std::size_t walked_;                        // the number of queries in the trie
+            std::vector<uint32_t> ends_;                // per query, the trie node it ends at
+            std::vector<best_match> best_;              // per trie node; queries ending at the same node share it
+        public:
+            document_pass(const stream_query& query)
+                : query_(query), trie_(1), walked_(0), ends_(query.queries_.size(), static_cast<uint32_t>(no_node))
+            {
+                build_trie();
+                best_.resize(trie_.size());
+            }
+
+            // The first match of the i-th query, which must not be singular, or null
+            const value_type* first_of(std::size_t i) const
+            {
+                return best_[ends_[i]].value;
+            }
+
+            void run(const_reference root)
+            {
+                if (walked_ == 0)
+                {
+                    return;
+                }
+                frame(0).push_back(dom_state{0, false, 0, {}});
+                visit(root, 0);
+            }
+        private:
+            static string_view_type view(const string_type& s)
+            {
+                return string_view_type(s.data(), s.size());
+            }
+
+            std::vector<dom_state>& frame(std::size_t depth)
+            {
+                if (frames_.size() == depth)
+                {
+                    frames_.emplace_back();
+                    path_.emplace_back();
+                }
+                return frames_[depth];
+            }
+
+            void build_trie()
+            {
+                std::map<std::pair<uint32_t,string_type>,uint32_t> names;
+                std::map<std::pair<uint32_t,std::size_t>,uint32_t> indices;
+                std::map<std::pair<uint32_t,std::size_t>,uint32_t> numbers;
+                for (std::size_t i = 0; i < query_.queries_.size(); ++i)
+                {
+                    if (query_.queries_[i].singular)
+                    {
+                        continue;
+                    }
+                    uint32_t n = 0;
+                    for (const auto& st : query_.queries_[i].steps)
+                    {
+                        uint32_t next = no_node;
+                        switch (st.kind)
+                        {
+                            case step_kind::name:
+                                next = child(names, std::make_pair(n, st.name));
+                                break;
+                            case step_kind::index:
+                                next = child(indices, std::make_pair(n, st.index));
+                                break;
+                            case step_kind::name_or_index:
+                                next = child(numbers, std::make_pair(n, st.index));
+                                names.emplace(std::make_pair(n, st.name), next);
+                                break;
+                            case step_kind::wildcard:
+                                if (trie_[n].wildcard == no_node)
+                                {
+                                    uint32_t added = add_node();
+                                    trie_[n].wildcard = added;
+                                }
+                                next = trie_[n].wildcard;
+                                break;
+                            case step_kind::slice:
+                                for (const auto& sl : trie_[n].slices)
+                                {
+                                    if (sl.first->index == st.index && sl.first->stop == st.stop && sl.first->stride == st.stride)
+                                    {
+                                        next = sl.second;
+                                        break;
+                                    }
+                                }
+                                if (next == no_node)
+                                {
+                                    next = add_node();
+                                    trie_[n].slices.emplace_back(&st, next);
+                                }
+                                break;
+                            case step_kind::descent:
+                                if (trie_[n].descent == no_node)
+                                {
+                                    uint32_t added = add_node();
+                                    trie_[n].descent = added;
+                                }
+                                next = trie_[n].descent;
+                                break;
+                        }
+                        n = next;
+                    }
+                    trie_[n].is_end = true;
+                    ends_[i] = n;
+                    ++walked_;
+                }
+                // The maps are ordered by node, then by name or index
+                for (const auto& c : names)
+                {
+                    trie_[c.first.first].names.emplace_back(c.first.second, c.second);
+                }
+                for (const auto& c : indices)
+                {
+                    trie_[c.first.first].indices.emplace_back(c.first.second, c.second);
+                }
+                for (const auto& c : numbers)
+                {
+                    trie_[c.first.first].numbers.emplace_back(c.first.second, c.second);
+                }
+                for (auto& n : trie_)
+                {
+                    if (n.names.empty())
+                    {
+                        continue;
+                    }
+                    std::size_t size = 2;
+                    while (size < 2*n.names.size())
+                    {
+                        size *= 2;
+                    }
+                    n.name_slots.assign(size, static_cast<uint32_t>(no_node));
+                    for (std::size_t i = 0; i < n.names.size(); ++i)
+                    {
+                        std::size_t slot = hash_name(view(n.names[i].first)) & (size - 1);
+                        while (n.name_slots[slot] != no_node)
+                        {
+                            slot = (slot + 1) & (size - 1);
+                        }
+                        n.name_slots[slot] = static_cast<uint32_t>(i);
+                    }
+                }
+            }
+
+            // FNV-1a
+            static std::size_t hash_name(const string_view_type& name)
+            {
+                uint32_t h = 2166136261u;
+                for (std::size_t i = 0; i < name.size(); ++i)
+                {
+                    h = (h ^ static_cast<uint32_t>(name[i])) * 16777619u;
+                }
+                return h;
+            }
+
+            uint32_t add_node()
+            {
+                trie_.emplace_back();
+                return static_cast<uint32_t>(trie_.size() - 1);
+            }
+
+            template <typename Key>
+            uint32_t child(std::map<std::pair<uint32_t,Key>,uint32_t>& children, const std::pair<uint32_t,Key>& key)
+            {
+                auto it = children.find(key);
+                if (it == children.end())
+                {
+                    it = children.emplace(key, add_node()).first;
+                }
+                return it->second;
+            }
+
+            static uint32_t find_name(const trie_node& n, const string_view_type& name)
+            {
+                const std::size_t mask = n.name_slots.size() - 1;
+                for (std::size_t slot = hash_name(name) & mask; ; slot = (slot + 1) & mask)
+                {
+                    const uint32_t i = n.name_slots[slot];
+                    if (i == no_node)
+                    {
+                        return no_node;
+                    }
+                    if (view(n.names[i].first).compare(name) == 0)
+                    {
+                        return n.names[i].second;
+                    }
+                }
+            }
+
+            static uint32_t find_index(const std::vector<std::pair<std::size_t,uint32_t>>& children, std::size_t index)
+            {
+                auto it = std::lower_bound(children.begin(), children.end(), index,
+                    [](const std::pair<std::size_t,uint32_t>& c, std::size_t key) { return c.first < key; });
+                return it != children.end() && it->first == index ? it->second : no_node;
+            }
+
+            static void push(std::vector<dom_state>& states, const dom_state& s, uint32_t node)
+            {
+                if (node != no_node)
+                {
+                    states.push_back(s);
+                    states.back().node = node;
+                }
+            }
+
+            // True if a child reached by the partial matches in next can match or lead to a match
+            bool wants(const_reference child, const std::vector<dom_state>& next) const
+            {
+                if (child.is_object() || child.is_array())
+                {
+                    return !next.empty();
+                }
+                for (const auto& s : next)
+                {
+                    if (!s.descending && trie_[s.node].is_end)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void visit(const_reference v, std::size_t depth)
+            {
+                std::vector<dom_state>& states = frames_[depth];
+                const bool is_container = v.is_object() || v.is_array();
+                bool walks = false; // some state goes on into every member or element
+
+                // A descent applies the rest of its query to the array or object itself, and goes
+                // on into its children
+                for (std::size_t i = 0; i < states.size(); ++i)
+                {
+                    dom_state s = states[i];
+                    const trie_node& n = trie_[s.node];
+                    if (s.descending)
+                    {
+                        walks = true;
+                        if (is_container)
+                        {
+                            s.descending = false;
+                            s.stops[s.stop_count++] = static_cast<uint32_t>(depth);
+                            push(states, s, n.descent);
+                        }
+                    }
+                    else
+                    {
+                        if (n.descent != no_node)
+                        {
+                            s.descending = true;
+                            states.push_back(s);
+                        }
+                        walks = walks || n.wildcard != no_node || !n.slices.empty();
+                    }
+                }
+
+                for (const auto& s : states)
+                {
+                    if (!s.descending && trie_[s.node].is_end)
+                    {
+                        record(v, depth, s);
+                    }
+                }
+                if (!is_container)
+                {
+                    return;
+                }
+
+                std::vector<dom_state>& next = frame(depth + 1);
+                const trie_node& only = trie_[states.front().node];
+                if (v.is_object())
+                {
+                    // A single set of names is looked up rather than walked, when that is cheaper:
+                    // a member of an object that keeps input order is found by a linear search.
+                    // All the matches below a name share its position, which is left at 0.
+                    if (!walks && states.size() == 1 && only.names.size() <= (members_sorted ? v.size() : max_linear_lookups))
+                    {
+                        for (const auto& c : only.names)
+                        {
+                            auto it = v.find(view(c.first));
+                            if (it != v.object_range().end())
+                            {
+                                next.clear();
+                                push(next, states.front(), c.second);
+                                if (wants(it->value(), next))
+                                {
+                                    path_[depth] = dom_component{view(c.first), 0, true};
+                                    visit(it->value(), depth + 1);
+                                }
+                            }
+                        }
+                        return;
+                    }
+                    std::size_t index = 0;
+                    for (const auto& member : v.object_range())
+                    {
+                        const string_view_type name = view(member.key());
+                        next.clear();
+                        for (const auto& s : states)
+                        {
+                            if (s.descending)
+                            {
+                                next.push_back(s);
+                                continue;
+                            }
+                            const trie_node& n = trie_[s.node];
+                            if (!n.names.empty())
+                            {
+                                push(next, s, find_name(n, name));
+                            }
+                            push(next, s, n.wildcard);
+                        }
+                        if (wants(member.value(), next))
+                        {
+                            path_[depth] = dom_component{name, index, true};
+                            visit(member.value(), depth + 1);
+                        }
+                        ++index;
+                    }
+                }
+                else
+                {
+                    const std::size_t size = v.size();
+                    // A single set of indices is looked up rather than walked
+                    if (!walks && states.size() == 1)
+                    {
+                        for (const auto* children : {&only.indices, &only.numbers})
+                        {
+                            for (const auto& c : *children)
+                            {
+                                if (c.first < size)
+                                {
+                                    next.clear();
+                                    push(next, states.front(), c.second);
+                                    if (wants(v.at(c.first), next))
+                                    {
+                                        path_[depth] = dom_component{string_view_type(), c.first, false};
+                                        visit(v.at(c.first), depth + 1);
+                                    }
+                                }
+                            }
+                        }
+                        return;
+                    }
+                    for (std::size_t index = 0; index < size; ++index)
+                    {
+                        next.clear();
+                        for (const auto& s : states)
+                        {
+                            if (s.descending)
+                            {
+                                next.push_back(s);
+                                continue;
+                            }
+                            const trie_node& n = trie_[s.node];
+                            if (!n.indices.empty())
+                            {
+                                push(next, s, find_index(n.indices, index));
+                            }
+                            if (!n.numbers.empty())
+                            {
+                                push(next, s, find_index(n.numbers, index));
+                            }
+                            push(next, s, n.wildcard);
+                            for (const auto& sl : n.slices)
+                            {
+                                const step& st = *sl.first;
+                                if (index >= st.index && index < st.stop && (index - st.index) % st.stride == 0)
+                                {
+                                    push(next, s, sl.second);
+                                }
+                            }
+                        }
+                        if (wants(v.at(index), next))
+                        {
+                            path_[depth] = dom_component{string_view_type(), index, false};
+                            visit(v.at(index), depth + 1);
+                        }
+                    }
+                }
+            }
+
+            void record(const_reference v, std::size_t depth, const dom_state& s)
+            {
+                best_match& b = best_[s.node];
+                if (b.value != nullptr && !precedes(path_.data(), depth, s.stops, s.stop_count, b.path.data(), b.path.size(), b.stops, b.stop_count))
+                {
+                    return;
+                }
+                b.value = std::addressof(v);
+                b.path.assign(path_.begin(), path_.begin() + static_cast<std::ptrdiff_t>(depth));
+                b.stop_count = s.stop_count;
+                for (uint32_t i = 0; i < s.stop_count; ++i)
+                {
+                    b.stops[i] = s.stops[i];
+                }
+            }
+        };
+    };
+
+} // namespace jsonpath
+} // namespace jsoncons
+
+#endif // JSONCONS_EXT_JSONPATH_STREAM_QUERY_HPP
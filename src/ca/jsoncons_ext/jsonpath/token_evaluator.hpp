@@ -16,6 +16,7 @@
 #include <system_error>
 #include <type_traits>
 #include <unordered_map> // std::unordered_map
+#include <unordered_set> // std::unordered_set
 #include <utility> // std::move
 #include <vector> // std::vector
 
@@ -26,11 +27,13 @@
 #include <jsoncons/semantic_tag.hpp>
 #include <jsoncons/utility/more_type_traits.hpp>
 
+#include <jsoncons_ext/jsonpath/eval_arena.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath_error.hpp>
+#include <jsoncons_ext/jsonpath/key_index.hpp>
 #include <jsoncons_ext/jsonpath/path_node.hpp>
 
 #if defined(JSONCONS_HAS_STD_REGEX)
-#include <regex>
+#include <jsoncons/utility/regex.hpp>
 #endif
 
 namespace jsoncons { 
@@ -508,9 +511,10 @@ namespace detail {
         using const_reference = typename jsonpath_traits<Json>::const_reference;
         using char_type = typename Json::char_type;
         using string_type = typename Json::string_type;
-        std::basic_regex<char_type> pattern_;
+        using regex_pointer = std::shared_ptr<const jsoncons::utility::basic_regex_matcher<char_type>>;
+        regex_pointer pattern_;
     public:
-        regex_operator(std::basic_regex<char_type>&& pattern)
+        regex_operator(regex_pointer&& pattern)
             : unary_operator<Json>(2, true),
               pattern_(std::move(pattern))
         {
@@ -522,7 +526,7 @@ namespace detail {
             {
                 return Json::null();
             }
-            return std::regex_search(val.as_string(), pattern_) ? Json(true, semantic_tag::none) : Json(false, semantic_tag::none);
+            return pattern_->search(val.as_string_view()) ? Json(true, semantic_tag::none) : Json(false, semantic_tag::none);
         }
     };
 
@@ -1397,22 +1401,13 @@ namespace detail {
             auto arg0 = args[0].value().template as<string_view_type>();
             auto arg1 = args[1].value().template as<string_view_type>();
 
-            auto s0 = string_type(arg0.begin(), arg0.end(), alloc_);
-            auto s1 = string_type(arg1.begin(), arg1.end(), alloc_);
-
-            std::regex::flag_type options = std::regex_constants::ECMAScript; 
-            std::basic_regex<char_type> pieces_regex(s1, options);
-
-            std::regex_token_iterator<typename string_type::const_iterator> rit ( s0.begin(), s0.end(), pieces_regex, -1);
-            std::regex_token_iterator<typename string_type::const_iterator> rend;
+            auto pieces_regex = jsoncons::utility::cached_regex_matcher<char_type>(arg1);
 
             value_type j(json_array_arg, semantic_tag::none, alloc_);
-            while (rit != rend) 
+            pieces_regex->split(arg0, [&](const string_view_type& piece)
             {
-                auto s = (*rit).str();
-                j.emplace_back(s.c_str(), semantic_tag::none);
-                ++rit;
-            }
+                j.emplace_back(piece, semantic_tag::none, alloc_);
+            });
             return j;
         }
 
@@ -2126,7 +2121,7 @@ namespace detail {
         
         ~path_value_pair() = default;
 
-        path_node_type path() const
+        const path_node_type& path() const
         {
             return *path_ptr_;
         }
@@ -2167,6 +2162,17 @@ namespace detail {
         }
     };
 
+    // Matches that refer to the same node, whatever path reached it
+    template <typename Json,typename JsonReference>
+    struct path_value_pair_same_node
+    {
+        bool operator()(const path_value_pair<Json,JsonReference>& lhs,
+                        const path_value_pair<Json,JsonReference>& rhs) const noexcept
+        {
+            return lhs.value_ptr_ == rhs.value_ptr_;
+        }
+    };
+
     template <typename Json,typename JsonReference>
     struct path_component_value_pair
     {
@@ -2200,6 +2206,7 @@ namespace detail {
     template <typename Json,typename JsonReference>
     class node_receiver
     {
+        bool stopped_{false};
     public:
         using char_type = typename Json::char_type;
         using string_type = typename Json::string_type;
@@ -2216,6 +2223,37 @@ namespace detail {
         node_receiver& operator=(node_receiver&&) = default;
 
         virtual void add(const path_node_type& base_path, reference value) = 0;
+
+        // Selectors stop iterating once a receiver has all the nodes it needs
+        bool stopped() const
+        {
+            return stopped_;
+        }
+    protected:
+        void stop()
+        {
+            stopped_ = true;
+        }
+    };
+
+    template <typename Json,typename JsonReference>
+    class first_node_receiver : public node_receiver<Json,JsonReference>
+    {
+    public:
+        using reference = JsonReference;
+        using pointer = typename std::conditional<std::is_const<typename std::remove_reference<JsonReference>::type>::value,typename Json::const_pointer,typename Json::pointer>::type;
+        using path_node_type = basic_path_node<typename Json::char_type>;
+
+        pointer ptr{nullptr};
+
+        void add(const path_node_type&, reference value) override
+        {
+            if (ptr == nullptr)
+            {
+                ptr = std::addressof(value);
+                this->stop();
+            }
+        }
     };
 
     template <typename Json,typename JsonReference>
@@ -2272,13 +2310,15 @@ namespace detail {
         using path_node_type = basic_path_node<typename Json::char_type>;
 
         allocator_type alloc_;
-        std::vector<std::unique_ptr<Json>> temp_json_values_;
-        std::vector<std::unique_ptr<path_node_type>> temp_node_values_;
+        eval_arena arena_;
         std::unordered_map<std::size_t,pointer> cache_;
         string_type length_label_;
+        key_index<Json>* key_index_;
     public:
-        eval_context(const allocator_type& alloc = allocator_type())
-            : alloc_(alloc), length_label_{JSONCONS_CSTRING_CONSTANT(char_type, "length"), alloc}
+        // Temporary values and path nodes are kept in an arena whose blocks come from blocks, if
+        // given, and otherwise from a free list kept per thread
+        eval_context(const allocator_type& alloc = allocator_type(), arena_block_source* blocks = nullptr)
+            : alloc_(alloc), arena_(blocks), length_label_{JSONCONS_CSTRING_CONSTANT(char_type, "length"), alloc}, key_index_(nullptr)
         {
         }
 
@@ -2287,6 +2327,17 @@ namespace detail {
             return alloc_;
         }
 
+        // The member name index of the queried document, if the caller supplied one
+        key_index<Json>* get_key_index() const
+        {
+            return key_index_;
+        }
+
+        void set_key_index(key_index<Json>* index)
+        {
+            key_index_ = index;
+        }
+
         bool is_cached(std::size_t id) const
         {
             return cache_.find(id) != cache_.end();
@@ -2309,10 +2360,13 @@ namespace detail {
         template <typename... Args>
         Json* create_json(Args&& ... args)
         {
-            auto temp = jsoncons::make_unique<Json>(std::forward<Args>(args)...);
-            Json* ptr = temp.get();
-            temp_json_values_.push_back(std::move(temp));
-            return ptr;
+            return arena_.create<Json>(std::forward<Args>(args)...);
+        }
+
+        // True if ptr is a value computed during evaluation (e.g. a length), not a node of the root
+        bool is_temp(const Json* ptr) const
+        {
+            return arena_.owns(ptr);
         }
 
         const string_type& length_label() const
@@ -2323,13 +2377,104 @@ namespace detail {
         template <typename... Args>
         const path_node_type* create_path_node(Args&& ... args)
         {
-            auto temp = jsoncons::make_unique<path_node_type>(std::forward<Args>(args)...);
-            path_node_type* ptr = temp.get();
-            temp_node_values_.push_back(std::move(temp));
-            return ptr;
+            return arena_.create<path_node_type>(std::forward<Args>(args)...);
+        }
+    };
+
+    // One step of a path made only of identifier and index selectors, e.g. $.a['b'][0]
+    template <typename Json>
+    struct direct_step
+    {
+        using string_type = typename Json::string_type;
+
+        string_type name;
+        int64_t index;
+        bool is_index;
+
+        direct_step(const string_type& name)
+            : name(name), index(0), is_index(false)
+        {
+        }
+
+        direct_step(int64_t index)
+            : index(index), is_index(true)
+        {
         }
     };
 
+    // Follows steps from current with the lookups the identifier and index selectors make, setting
+    // ptr to the match or leaving it null if there is none. With with_path, last is advanced to the
+    // path of the match. Returns false, leaving the selectors to evaluate the path, if a step yields
+    // a computed value (a length).
+    template <typename Json,typename JsonReference>
+    bool select_direct_steps(const std::vector<direct_step<Json>>& steps,
+        eval_context<Json,JsonReference>& context,
+        JsonReference current,
+        bool with_path,
+        typename path_value_pair<Json,JsonReference>::value_pointer& ptr,
+        const basic_path_node<typename Json::char_type>*& last)
+    {
+        auto node = std::addressof(current);
+        for (const auto& step : steps)
+        {
+            std::size_t index = 0;
+            if (step.is_index)
+            {
+                if (!node->is_array())
+                {
+                    return true;
+                }
+                auto slen = static_cast<int64_t>(node->size());
+                int64_t i = step.index >= 0 ? step.index : slen + step.index;
+                if (i < 0 || i >= slen)
+                {
+                    return true;
+                }
+                index = static_cast<std::size_t>(i);
+            }
+            else if (node->is_object())
+            {
+                auto it = node->find(step.name);
+                if (it == node->object_range().end())
+                {
+                    return true;
+                }
+                if (with_path)
+                {
+                    last = context.create_path_node(last, (*it).key());
+                }
+                node = std::addressof((*it).value());
+                continue;
+            }
+            else if (node->is_array())
+            {
+                int64_t n{0};
+                auto r = jsoncons::utility::dec_to_integer(step.name.data(), step.name.size(), n);
+                if (!r)
+                {
+                    return step.name != context.length_label();
+                }
+                index = (n >= 0) ? static_cast<std::size_t>(n) : static_cast<std::size_t>(static_cast<int64_t>(node->size()) + n);
+                if (index >= node->size())
+                {
+                    return true;
+                }
+            }
+            else
+            {
+                return !(node->is_string() && step.name == context.length_label());
+            }
+
+            if (with_path)
+            {
+                last = context.create_path_node(last, index);
+            }
+            node = std::addressof(node->at(index));
+        }
+        ptr = node;
+        return true;
+    }
+
     template <typename Json,typename JsonReference>
     struct node_less
     {
@@ -2356,6 +2501,7 @@ namespace detail {
         using path_node_type = basic_path_node<typename Json::char_type>;
         using node_receiver_type = node_receiver<Json,JsonReference>;
         using selector_type = jsonpath_selector<Json,JsonReference>;
+        using direct_step_type = direct_step<Json>;
 
         jsonpath_selector(bool is_path,
                           std::size_t precedence_level = 0)
@@ -2399,6 +2545,20 @@ namespace detail {
         {
         }
 
+        // Appends the steps of a chain made only of identifier and index selectors. Returns false
+        // if the chain contains any other selector.
+        virtual bool collect_direct_steps(std::vector<direct_step_type>&) const
+        {
+            return false;
+        }
+
+        // Returns true if the chain contains a recursive descent to a member name, e.g. $..name,
+        // which can be served from a key_index
+        virtual bool has_indexed_descent() const
+        {
+            return false;
+        }
+
         virtual std::string to_string(int) const
         {
             return std::string();
@@ -2529,7 +2689,7 @@ namespace detail {
             return &oper;
         }
 
-        const unary_operator<Json>* get_regex_operator(std::basic_regex<char_type>&& pattern) 
+        const unary_operator<Json>* get_regex_operator(std::shared_ptr<const jsoncons::utility::basic_regex_matcher<char_type>>&& pattern) 
         {
             unary_operators_.push_back(jsoncons::make_unique<regex_operator<Json>>(std::move(pattern)));
             return unary_operators_.back().get();
@@ -3095,6 +3255,75 @@ namespace detail {
         }
     };
 
+    // Passes the matches collected by a selector to callback, sorted and without duplicates as
+    // options ask
+    template <typename Json,typename JsonReference,typename Callback>
+    void deliver_path_values(std::vector<path_value_pair<Json,JsonReference>>& nodes,
+        result_options options,
+        Callback& callback)
+    {
+        using value_type = Json;
+        using path_value_pair_less_type = path_value_pair_less<Json,JsonReference>;
+        using path_value_pair_greater_type = path_value_pair_greater<Json,JsonReference>;
+        using path_value_pair_same_node_type = path_value_pair_same_node<Json,JsonReference>;
+
+        if (nodes.size() > 1) 
+        {
+            if ((options & result_options::sort_descending) == result_options::sort_descending)
+            {
+                std::sort(nodes.begin(), nodes.end(), path_value_pair_greater_type());
+            } 
+            else if ((options & result_options::sort) == result_options::sort)
+            {
+                std::sort(nodes.begin(), nodes.end(), path_value_pair_less_type());
+            }
+        }
+
+        // Duplicates are identified by node address rather than by comparing paths.
+        // Once sorted, every match of a node is adjacent because its paths compare equal.
+        if (nodes.size() > 1 && (options & result_options::nodups) == result_options::nodups)
+        {
+            if ((options & result_options::sort_descending) == result_options::sort_descending)
+            {
+                auto last = std::unique(nodes.rbegin(),nodes.rend(),path_value_pair_same_node_type());
+                nodes.erase(nodes.begin(), last.base());
+                for (auto& node : nodes)
+                {
+                    callback(node.path(), node.value());
+                }
+            }
+            else if ((options & result_options::sort) == result_options::sort)
+            {
+                auto last = std::unique(nodes.begin(),nodes.end(),path_value_pair_same_node_type());
+                nodes.erase(last,nodes.end());
+                for (auto& node : nodes)
+                {
+                    callback(node.path(), node.value());
+                }
+            }
+            else
+            {
+                // Keep the first match of each node, in document order
+                std::unordered_set<const value_type*> seen;
+                seen.reserve(nodes.size());
+                for (auto& node : nodes)
+                {
+                    if (seen.insert(node.value_ptr_).second)
+                    {
+                        callback(node.path(), node.value());
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (auto& node : nodes)
+            {
+                callback(node.path(), node.value());
+            }
+        }
+    }
+
     template <typename Json,typename JsonReference>
     class path_expression
     {
@@ -3107,6 +3336,7 @@ namespace detail {
         using path_value_pair_less_type = path_value_pair_less<Json,JsonReference>;
         using path_value_pair_greater_type = path_value_pair_greater<Json,JsonReference>;
         using path_value_pair_equal_type = path_value_pair_equal<Json,JsonReference>;
+        using path_value_pair_same_node_type = path_value_pair_same_node<Json,JsonReference>;
         using value_type = Json;
         using reference = typename path_value_pair_type::reference;
         using pointer = typename path_value_pair_type::value_pointer;
@@ -3119,19 +3349,31 @@ namespace detail {
         allocator_type alloc_;
         selector_type* selector_;
         result_options required_options_;
+        // Set for a normalized path such as $.a['b'][0], which is then followed with direct
+        // member and element lookups instead of running the selectors
+        std::vector<direct_step<Json>> direct_steps_;
+        bool is_direct_;
     public:
 
         path_expression(selector_type* selector, bool paths_required, const allocator_type& alloc)
-            : alloc_(alloc), selector_(selector), required_options_()
+            : alloc_(alloc), selector_(selector), required_options_(), is_direct_(false)
         {
             if (paths_required)
             {
                 required_options_ |= result_options::path;
             }
+            if (selector_ != nullptr)
+            {
+                is_direct_ = selector_->collect_direct_steps(direct_steps_);
+                if (!is_direct_)
+                {
+                    direct_steps_.clear();
+                }
+            }
         }
 
         path_expression(const allocator_type& alloc)
-            : alloc_(alloc), selector_(nullptr), required_options_()
+            : alloc_(alloc), selector_(nullptr), required_options_(), is_direct_(false)
         {
         }
 
@@ -3143,6 +3385,11 @@ namespace detail {
         path_expression& operator=(const path_expression& expr) = delete;
         path_expression& operator=(path_expression&& expr) = default;
 
+        const selector_type* selector() const
+        {
+            return selector_;
+        }
+
         Json evaluate(eval_context<Json,JsonReference>& context, 
             reference root,
             const path_node_type& path, 
@@ -3186,76 +3433,28 @@ namespace detail {
 
             const result_options require_more = result_options::nodups | result_options::sort | result_options::sort_descending;
 
+            if (is_direct_)
+            {
+                pointer ptr = nullptr;
+                const path_node_type* last = std::addressof(path);
+                const bool with_path = (options & (result_options::path | result_options::sort | result_options::sort_descending)) != result_options();
+                if (select_direct_steps<Json,JsonReference>(direct_steps_, context, current, with_path, ptr, last))
+                {
+                    if (ptr != nullptr)
+                    {
+                        callback(*last, *ptr);
+                    }
+                    return;
+                }
+            }
+
             if (selector_ != nullptr)
             {
                 if ((options & require_more) != result_options())
                 {
                     path_value_receiver<Json,JsonReference> receiver{alloc_};
                     selector_->select(context, root, path, current, receiver, options);
-
-                    if (receiver.nodes.size() > 1) 
-                    {
-                        if ((options & result_options::sort_descending) == result_options::sort_descending)
-                        {
-                            std::sort(receiver.nodes.begin(), receiver.nodes.end(), path_value_pair_greater_type());
-                        } 
-                        else if ((options & result_options::sort) == result_options::sort)
-                        {
-                            std::sort(receiver.nodes.begin(), receiver.nodes.end(), path_value_pair_less_type());
-                        }
-                    }
-
-                    if (receiver.nodes.size() > 1 && (options & result_options::nodups) == result_options::nodups)
-                    {
-                        if ((options & result_options::sort_descending) == result_options::sort_descending)
-                        {
-                            auto last = std::unique(receiver.nodes.rbegin(),receiver.nodes.rend(),path_value_pair_equal_type());
-                            receiver.nodes.erase(receiver.nodes.begin(), last.base());
-                            for (auto& node : receiver.nodes)
-                            {
-                                callback(node.path(), node.value());
-                            }
-                        }
-                        else if ((options & result_options::sort) == result_options::sort)
-                        {
-                            auto last = std::unique(receiver.nodes.begin(),receiver.nodes.end(),path_value_pair_equal_type());
-                            receiver.nodes.erase(last,receiver.nodes.end());
-                            for (auto& node : receiver.nodes)
-                            {
-                                callback(node.path(), node.value());
-                            }
-                        }
-                        else
-                        {
-                            std::vector<path_value_pair_type> index(receiver.nodes);
-                            std::sort(index.begin(), index.end(), path_value_pair_less_type());
-                            auto last = std::unique(index.begin(),index.end(),path_value_pair_equal_type());
-                            index.erase(last,index.end());
-
-                            std::vector<path_value_pair_type> temp2;
-                            temp2.reserve(index.size());
-                            for (auto&& node : receiver.nodes)
-                            {
-                                auto it = std::lower_bound(index.begin(),index.end(),node, path_value_pair_less_type());
-                                if (it != index.end() && (*it).path() == node.path()) 
-                                {
-                                    temp2.emplace_back(std::move(node));
-                                    index.erase(it);
-                                }
-                            }
-                            for (auto& node : temp2)
-                            {
-                                callback(node.path(), node.value());
-                            }
-                        }
-                    }
-                    else
-                    {
-                        for (auto& node : receiver.nodes)
-                        {
-                            callback(node.path(), node.value());
-                        }
-                    }
+                    deliver_path_values(receiver.nodes, options, callback);
                 }
                 else
                 {
@@ -3265,6 +3464,35 @@ namespace detail {
             }
         }
 
+        // Stops at the first match in document order; sort and nodups do not apply
+        pointer evaluate_first(eval_context<Json,JsonReference>& context, 
+            reference root,
+            const path_node_type& path, 
+            reference current, 
+            result_options options) const
+        {
+            options |= required_options_;
+            options &= ~(result_options::nodups | result_options::sort | result_options::sort_descending);
+
+            if (is_direct_)
+            {
+                pointer ptr = nullptr;
+                const path_node_type* last = std::addressof(path);
+                const bool with_path = (options & (result_options::path | result_options::sort | result_options::sort_descending)) != result_options();
+                if (select_direct_steps<Json,JsonReference>(direct_steps_, context, current, with_path, ptr, last))
+                {
+                    return ptr;
+                }
+            }
+
+            first_node_receiver<Json,JsonReference> receiver;
+            if (selector_ != nullptr)
+            {
+                selector_->select(context, root, path, current, receiver, options);
+            }
+            return receiver.ptr;
+        }
+
         std::string to_string(int level) const
         {
             std::string s;
@@ -3306,10 +3534,81 @@ namespace detail {
         using path_node_type = basic_path_node<typename Json::char_type>;
         using stack_item_type = value_or_pointer<Json,JsonReference>;
     private:
+        // The compiled form of an expression made only of paths from @ or $, literals and
+        // operators, e.g. @.price > 10 && @.category == 'fiction'. Each operation reads its
+        // operands from registers, the current or root node or a literal token, and sets a
+        // register to point to its result, so testing a candidate allocates nothing.
+        enum class opcode : uint8_t
+        {
+            select,
+            select_direct,
+            eq,
+            ne,
+            lt,
+            lte,
+            gt,
+            gte,
+            and_op,
+            or_op,
+            not_op,
+            unary,
+            binary
+        };
+
+        enum class operand_kind : uint8_t
+        {
+            reg,
+            current,
+            root,
+            literal
+        };
+
+        struct operand
+        {
+            operand_kind kind;
+            std::size_t index; // register or literal token
+        };
+
+        struct instruction
+        {
+            opcode op;
+            operand lhs;
+            operand rhs;
+            std::size_t token_index;
+            std::size_t dst;
+            std::size_t slot; // value slot for the result of a unary or binary operator
+            std::vector<direct_step<Json>> steps;
+
+            instruction(opcode op, const operand& lhs, const operand& rhs, std::size_t token_index, std::size_t dst)
+                : op(op), lhs(lhs), rhs(rhs), token_index(token_index), dst(dst), slot(0)
+            {
+            }
+        };
+
         std::vector<token_type> token_list_;
+        std::vector<instruction> program_;
+        operand result_;
+        std::size_t register_count_;
+        std::size_t value_count_;
+        bool is_compiled_;
     public:
+        // Registers for running the compiled form of an expression. A filter allocates one
+        // frame and reuses it for every candidate it tests.
+        class frame
+        {
+            friend class token_evaluator;
+
+            std::vector<const value_type*> registers_;
+            std::vector<value_type> values_;
+        public:
+            explicit frame(const token_evaluator& expr)
+                : registers_(expr.register_count_), values_(expr.value_count_)
+            {
+            }
+        };
 
         token_evaluator()
+            : result_{operand_kind::reg, 0}, register_count_(0), value_count_(0), is_compiled_(false)
         {
         }
 
@@ -3317,8 +3616,14 @@ namespace detail {
         token_evaluator(token_evaluator&& expr) = default;
 
         token_evaluator(std::vector<token_type>&& token_stack)
-            : token_list_(std::move(token_stack))
+            : token_list_(std::move(token_stack)), result_{operand_kind::reg, 0}, 
+              register_count_(0), value_count_(0), is_compiled_(false)
         {
+            is_compiled_ = compile();
+            if (!is_compiled_)
+            {
+                program_.clear();
+            }
         }
 
         token_evaluator& operator=(const token_evaluator& expr) = delete;
@@ -3326,14 +3631,38 @@ namespace detail {
         
         ~token_evaluator() = default;
 
+        // Evaluates the expression as a filter predicate, running the compiled form in f
+        bool test(eval_context<Json,reference>& context, 
+            reference root,
+            reference current,
+            result_options options,
+            frame& f,
+            std::error_code& ec) const
+        {
+            if (is_compiled_)
+            {
+                const value_type& r = run(context, root, current, options, f, ec);
+                return ec ? false : is_true(r);
+            }
+            value_type r = evaluate(context, root, current, options, ec);
+            return ec ? false : is_true(r);
+        }
+
         value_type evaluate(eval_context<Json,reference>& context, 
             reference root,
             reference current,
             result_options options,
             std::error_code& ec) const override
         {
+            if (is_compiled_)
+            {
+                frame f(*this);
+                return run(context, root, current, options, f, ec);
+            }
+
             std::vector<stack_item_type> stack;
             std::vector<parameter_type> arg_stack;
+            stack.reserve(token_list_.size());
 
             //std::cout << "EVALUATE TOKENS\n";
             //for (auto& tok : token_list_)
@@ -3459,6 +3788,253 @@ namespace detail {
             //}
             return stack.empty() ? Json::null() : stack.back().value();
         }
+
+    private:
+        // Lowers token_list_ to program_. Returns false, leaving the expression to the token
+        // stack, if it calls functions, contains nested expressions or applies a selector to
+        // anything but @ or $.
+        bool compile()
+        {
+            std::vector<operand> stack;
+            for (std::size_t i = 0; i < token_list_.size(); ++i)
+            {
+                const auto& tok = token_list_[i];
+                switch (tok.token_kind())
+                {
+                    case jsonpath_token_kind::literal:
+                        stack.push_back(operand{operand_kind::literal, i});
+                        break;
+                    case jsonpath_token_kind::current_node:
+                        stack.push_back(operand{operand_kind::current, 0});
+                        break;
+                    case jsonpath_token_kind::root_node:
+                        stack.push_back(operand{operand_kind::root, 0});
+                        break;
+                    case jsonpath_token_kind::selector:
+                    {
+                        if (stack.empty() || (stack.back().kind != operand_kind::current && stack.back().kind != operand_kind::root))
+                        {
+                            return false;
+                        }
+                        instruction ins(opcode::select, stack.back(), stack.back(), i, register_count_++);
+                        if (tok.selector_->collect_direct_steps(ins.steps))
+                        {
+                            ins.op = opcode::select_direct;
+                        }
+                        else
+                        {
+                            ins.steps.clear();
+                        }
+                        stack.back() = operand{operand_kind::reg, ins.dst};
+                        program_.push_back(std::move(ins));
+                        break;
+                    }
+                    case jsonpath_token_kind::unary_operator:
+                    {
+                        if (stack.empty())
+                        {
+                            return false;
+                        }
+                        instruction ins(opcode::unary, stack.back(), stack.back(), i, register_count_++);
+                        if (dynamic_cast<const unary_not_operator<Json>*>(tok.unary_operator_) != nullptr)
+                        {
+                            ins.op = opcode::not_op;
+                        }
+                        else
+                        {
+                            ins.slot = value_count_++;
+                        }
+                        stack.back() = operand{operand_kind::reg, ins.dst};
+                        program_.push_back(std::move(ins));
+                        break;
+                    }
+                    case jsonpath_token_kind::binary_operator:
+                    {
+                        if (stack.size() < 2)
+                        {
+                            return false;
+                        }
+                        operand rhs = stack.back();
+                        stack.pop_back();
+                        instruction ins(binary_opcode(tok.binary_operator_), stack.back(), rhs, i, register_count_++);
+                        if (ins.op == opcode::binary)
+                        {
+                            ins.slot = value_count_++;
+                        }
+                        stack.back() = operand{operand_kind::reg, ins.dst};
+                        program_.push_back(std::move(ins));
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+            if (stack.size() != 1)
+            {
+                return false;
+            }
+            result_ = stack.back();
+            return true;
+        }
+
+        static opcode binary_opcode(const binary_operator<Json>* op)
+        {
+            if (dynamic_cast<const eq_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::eq;
+            }
+            if (dynamic_cast<const ne_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::ne;
+            }
+            if (dynamic_cast<const lt_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::lt;
+            }
+            if (dynamic_cast<const lte_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::lte;
+            }
+            if (dynamic_cast<const gt_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::gt;
+            }
+            if (dynamic_cast<const gte_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::gte;
+            }
+            if (dynamic_cast<const and_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::and_op;
+            }
+            if (dynamic_cast<const or_operator<Json>*>(op) != nullptr)
+            {
+                return opcode::or_op;
+            }
+            return opcode::binary;
+        }
+
+        static const value_type& bool_value(bool b)
+        {
+            static const value_type true_value(true, semantic_tag::none);
+            static const value_type false_value(false, semantic_tag::none);
+            return b ? true_value : false_value;
+        }
+
+        const value_type& fetch(const operand& o,
+            eval_context<Json,reference>& context,
+            reference root,
+            reference current,
+            const frame& f) const
+        {
+            switch (o.kind)
+            {
+                case operand_kind::reg:
+                    return *f.registers_[o.index];
+                case operand_kind::current:
+                    return current;
+                case operand_kind::root:
+                    return root;
+                default:
+                    return token_list_[o.index].get_value(const_reference_arg_t(), context);
+            }
+        }
+
+        // Runs program_ with the semantics of the operators and selectors it replaces: a
+        // comparison other than == and != yields null unless both operands are numbers or both
+        // are strings, and "and" and "or" yield one of their operands.
+        const value_type& run(eval_context<Json,reference>& context,
+            reference root,
+            reference current,
+            result_options options,
+            frame& f,
+            std::error_code& ec) const
+        {
+            for (const auto& ins : program_)
+            {
+                const value_type*& out = f.registers_[ins.dst];
+                switch (ins.op)
+                {
+                    case opcode::select:
+                    case opcode::select_direct:
+                    {
+                        reference anchor = ins.lhs.kind == operand_kind::root ? root : current;
+                        if (ins.op == opcode::select_direct)
+                        {
+                            pointer ptr = nullptr;
+                            const path_node_type* last = nullptr;
+                            if (select_direct_steps<Json,JsonReference>(ins.steps, context, anchor, false, ptr, last))
+                            {
+                                out = ptr != nullptr ? ptr : std::addressof(context.null_value());
+                                break;
+                            }
+                        }
+                        out = std::addressof(token_list_[ins.token_index].selector_->evaluate(context, root, path_node_type{}, anchor, options, ec));
+                        break;
+                    }
+                    case opcode::eq:
+                        out = std::addressof(bool_value(fetch(ins.lhs, context, root, current, f) == fetch(ins.rhs, context, root, current, f)));
+                        break;
+                    case opcode::ne:
+                        out = std::addressof(bool_value(fetch(ins.lhs, context, root, current, f) != fetch(ins.rhs, context, root, current, f)));
+                        break;
+                    case opcode::lt:
+                    case opcode::lte:
+                    case opcode::gt:
+                    case opcode::gte:
+                    {
+                        const value_type& lhs = fetch(ins.lhs, context, root, current, f);
+                        const value_type& rhs = fetch(ins.rhs, context, root, current, f);
+                        if (!((lhs.is_number() && rhs.is_number()) || (lhs.is_string() && rhs.is_string())))
+                        {
+                            out = std::addressof(context.null_value());
+                            break;
+                        }
+                        bool b = ins.op == opcode::lt ? lhs < rhs
+                            : ins.op == opcode::lte ? lhs <= rhs
+                            : ins.op == opcode::gt ? lhs > rhs
+                            : lhs >= rhs;
+                        out = std::addressof(bool_value(b));
+                        break;
+                    }
+                    case opcode::and_op:
+                    {
+                        const value_type& lhs = fetch(ins.lhs, context, root, current, f);
+                        out = is_true(lhs) ? std::addressof(fetch(ins.rhs, context, root, current, f)) : std::addressof(lhs);
+                        break;
+                    }
+                    case opcode::or_op:
+                    {
+                        const value_type& lhs = fetch(ins.lhs, context, root, current, f);
+                        const value_type& rhs = fetch(ins.rhs, context, root, current, f);
+                        if (lhs.is_null() && rhs.is_null())
+                        {
+                            out = std::addressof(context.null_value());
+                        }
+                        else
+                        {
+                            out = is_true(lhs) ? std::addressof(lhs) : std::addressof(rhs);
+                        }
+                        break;
+                    }
+                    case opcode::not_op:
+                        out = std::addressof(bool_value(is_false(fetch(ins.lhs, context, root, current, f))));
+                        break;
+                    case opcode::unary:
+                        f.values_[ins.slot] = token_list_[ins.token_index].unary_operator_->evaluate(
+                            fetch(ins.lhs, context, root, current, f), ec);
+                        out = std::addressof(f.values_[ins.slot]);
+                        break;
+                    case opcode::binary:
+                        f.values_[ins.slot] = token_list_[ins.token_index].binary_operator_->evaluate(
+                            fetch(ins.lhs, context, root, current, f), fetch(ins.rhs, context, root, current, f), ec);
+                        out = std::addressof(f.values_[ins.slot]);
+                        break;
+                }
+            }
+            return fetch(result_, context, root, current, f);
+        }
+    public:
  
         std::string to_string(int level) const override
         {
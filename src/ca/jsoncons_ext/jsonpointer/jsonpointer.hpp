@@ -17,6 +17,7 @@
 #include <vector>
 
 #include <jsoncons/utility/write_number.hpp>
+#include <jsoncons/detail/flattened_object.hpp>
 #include <jsoncons/json_type.hpp>
 #include <jsoncons/utility/more_type_traits.hpp>
 
@@ -35,6 +36,94 @@ namespace jsonpointer {
         part
     };
 
+    // Unescapes the reference tokens of a JSON Pointer into tokens, reusing the strings already
+    // there, and returns how many there are. Entries past the returned count are left as they were.
+    template <typename CharT>
+    std::size_t parse_tokens(const jsoncons::basic_string_view<CharT>& input, std::vector<std::basic_string<CharT>>& tokens, std::error_code& ec)
+    {
+        std::size_t count = 0;
+        if (input.empty())
+        {
+            return count;
+        }
+
+        const CharT* p = input.data();
+        const CharT* pend = input.data() + input.size();
+        std::basic_string<CharT>* buffer = nullptr;
+        auto next_token = [&tokens, &count]() -> std::basic_string<CharT>*
+        {
+            if (count == tokens.size())
+            {
+                tokens.emplace_back();
+            }
+            std::basic_string<CharT>* token = std::addressof(tokens[count++]);
+            token->clear();
+            return token;
+        };
+
+        auto state = pointer_state::start;
+        while (p < pend)
+        {
+            switch (state)
+            {
+                case pointer_state::start: 
+                    switch (*p)
+                    {
+                        case '/':
+                            buffer = next_token();
+                            state = pointer_state::new_token;
+                            break;
+                        default:
+                            ec = jsonpointer_errc::expected_slash;
+                            return 0;
+                    };
+                    break;
+                case pointer_state::part:
+                    state = pointer_state::new_token; 
+                    JSONCONS_FALLTHROUGH;
+
+                case pointer_state::new_token: 
+                    switch (*p)
+                    {
+                        case '/':
+                            buffer = next_token();
+                            state = pointer_state::part; 
+                            break;
+                        case '~':
+                            state = pointer_state::escaped;
+                            break;
+                        default:
+                            buffer->push_back(*p);
+                            break;
+                    };
+                    break;
+                case pointer_state::escaped: 
+                    switch (*p)
+                    {
+                        case '0':
+                            buffer->push_back('~');
+                            state = pointer_state::new_token;
+                            break;
+                        case '1':
+                            buffer->push_back('/');
+                            state = pointer_state::new_token;
+                            break;
+                        default:
+                            ec = jsonpointer_errc::expected_0_or_1;
+                            return 0;
+                    };
+                    break;
+            }
+            ++p;
+        }
+        if (state == pointer_state::escaped)
+        {
+            ec = jsonpointer_errc::expected_0_or_1;
+            return 0;
+        }
+        return count;
+    }
+
     } // namespace detail
 
     template <typename CharT,typename Allocator=std::allocator<CharT>>
@@ -145,82 +234,13 @@ namespace jsonpointer {
         static basic_json_pointer parse(const string_view_type& input, std::error_code& ec)
         {
             std::vector<string_type> tokens;
-            if (input.empty())
-            {
-                return basic_json_pointer<CharT>();
-            }
-
-            const char_type* p = input.data();
-            const char_type* pend = input.data() + input.size();
-            string_type unescaped;
-
-            auto state = jsonpointer::detail::pointer_state::start;
-            string_type buffer;
-
-            while (p < pend)
-            {
-                    switch (state)
-                    {
-                        case jsonpointer::detail::pointer_state::start: 
-                            switch (*p)
-                            {
-                                case '/':
-                                    state = jsonpointer::detail::pointer_state::new_token;
-                                    break;
-                                default:
-                                    ec = jsonpointer_errc::expected_slash;
-                                    return basic_json_pointer();
-                            };
-                            break;
-                        case jsonpointer::detail::pointer_state::part:
-                            state = jsonpointer::detail::pointer_state::new_token; 
-                            JSONCONS_FALLTHROUGH;
-
-                        case jsonpointer::detail::pointer_state::new_token: 
-                            switch (*p)
-                            {
-                                case '/':
-                                    tokens.push_back(buffer);
-                                    buffer.clear();
-                                    state = jsonpointer::detail::pointer_state::part; 
-                                    break;
-                                case '~':
-                                    state = jsonpointer::detail::pointer_state::escaped;
-                                    break;
-                                default:
-                                    buffer.push_back(*p);
-                                    break;
-                            };
-                            break;
-                        case jsonpointer::detail::pointer_state::escaped: 
-                            switch (*p)
-                            {
-                                case '0':
-                                    buffer.push_back('~');
-                                    state = jsonpointer::detail::pointer_state::new_token;
-                                    break;
-                                case '1':
-                                    buffer.push_back('/');
-                                    state = jsonpointer::detail::pointer_state::new_token;
-                                    break;
-                                default:
-                                    ec = jsonpointer_errc::expected_0_or_1;
-                                    return basic_json_pointer();
-                            };
-                            break;
-                    }
-                    ++p;
-            }
-            if (state == jsonpointer::detail::pointer_state::escaped)
+            std::size_t count = jsonpointer::detail::parse_tokens(input, tokens, ec);
+            if (JSONCONS_UNLIKELY(ec))
             {
-                ec = jsonpointer_errc::expected_0_or_1;
                 return basic_json_pointer();
             }
-            if (state == jsonpointer::detail::pointer_state::new_token || state == jsonpointer::detail::pointer_state::part)
-            {
-                tokens.push_back(buffer);
-            }
-            return basic_json_pointer(tokens);
+            tokens.resize(count);
+            return basic_json_pointer(std::move(tokens));
         }
 
         // operator=
@@ -392,6 +412,107 @@ namespace jsonpointer {
         return ptr.to_string();
     }
 
+    // A JSON Pointer prepared for repeated resolution. The unescaped tokens share one buffer,
+    // and each token records up front whether it is the end marker "-" and whether it is an
+    // array index, with the index already parsed. Resolving a compiled pointer allocates
+    // nothing and parses no numbers, and looks up each object member once.
+    template <typename CharT>
+    class basic_compiled_json_pointer
+    {
+    public:
+        using char_type = CharT;
+        using string_type = std::basic_string<char_type>;
+        using string_view_type = jsoncons::basic_string_view<char_type>;
+
+        struct token
+        {
+            string_view_type key;
+            std::size_t index;
+            bool is_index;
+            bool is_end;
+        };
+    private:
+        struct token_info
+        {
+            std::size_t offset;
+            std::size_t length;
+            std::size_t index;
+            bool is_index;
+            bool is_end;
+        };
+
+        string_type buffer_;
+        std::vector<token_info> tokens_;
+    public:
+        basic_compiled_json_pointer() = default;
+
+        explicit basic_compiled_json_pointer(const basic_json_pointer<CharT>& location)
+        {
+            std::size_t length = 0;
+            std::size_t count = 0;
+            for (const auto& s : location)
+            {
+                length += s.size();
+                ++count;
+            }
+            buffer_.reserve(length);
+            tokens_.reserve(count);
+            for (const auto& s : location)
+            {
+                token_info info{buffer_.size(), s.size(), 0, false, false};
+                if (s.size() == 1 && s[0] == '-')
+                {
+                    info.is_end = true;
+                }
+                else
+                {
+                    info.is_index = static_cast<bool>(jsoncons::utility::dec_to_integer(s.data(), s.length(), info.index));
+                }
+                buffer_.append(s);
+                tokens_.push_back(info);
+            }
+        }
+
+        explicit basic_compiled_json_pointer(const string_view_type& s)
+            : basic_compiled_json_pointer(basic_json_pointer<CharT>(s))
+        {
+        }
+
+        static basic_compiled_json_pointer compile(const string_view_type& input, std::error_code& ec)
+        {
+            auto location = basic_json_pointer<CharT>::parse(input, ec);
+            if (JSONCONS_UNLIKELY(ec))
+            {
+                return basic_compiled_json_pointer();
+            }
+            return basic_compiled_json_pointer(location);
+        }
+
+        bool empty() const
+        {
+            return tokens_.empty();
+        }
+
+        std::size_t size() const
+        {
+            return tokens_.size();
+        }
+
+        token operator[](std::size_t i) const
+        {
+            const token_info& info = tokens_[i];
+            return token{string_view_type(buffer_.data() + info.offset, info.length), info.index, info.is_index, info.is_end};
+        }
+
+        token back() const
+        {
+            return (*this)[tokens_.size() - 1];
+        }
+    };
+
+    using compiled_json_pointer = basic_compiled_json_pointer<char>;
+    using wcompiled_json_pointer = basic_compiled_json_pointer<wchar_t>;
+
     namespace detail {
 
     template <typename Json>
@@ -487,6 +608,171 @@ namespace jsonpointer {
         return current;
     }
 
+    template <typename Json>
+    const Json* resolve(const Json* current, const typename basic_compiled_json_pointer<typename Json::char_type>::token& token, std::error_code& ec)
+    {
+        if (current->is_array())
+        {
+            if (token.is_end || !token.is_index)
+            {
+                ec = token.is_end ? jsonpointer_errc::index_exceeds_array_size : jsonpointer_errc::invalid_index;
+                return current;
+            }
+            if (token.index >= current->size())
+            {
+                ec = jsonpointer_errc::index_exceeds_array_size;
+                return current;
+            }
+            return std::addressof(current->at(token.index));
+        }
+        else if (current->is_object())
+        {
+            auto it = current->find(token.key);
+            if (it == current->object_range().end())
+            {
+                ec = jsonpointer_errc::key_not_found;
+                return current;
+            }
+            return std::addressof(it->value());
+        }
+        ec = jsonpointer_errc::expected_object_or_array;
+        return current;
+    }
+
+    template <typename Json>
+    Json* resolve(Json* current, const typename basic_compiled_json_pointer<typename Json::char_type>::token& token, bool create_if_missing, std::error_code& ec)
+    {
+        if (current->is_array())
+        {
+            if (token.is_end || !token.is_index)
+            {
+                ec = token.is_end ? jsonpointer_errc::index_exceeds_array_size : jsonpointer_errc::invalid_index;
+                return current;
+            }
+            if (token.index >= current->size())
+            {
+                ec = jsonpointer_errc::index_exceeds_array_size;
+                return current;
+            }
+            return std::addressof(current->at(token.index));
+        }
+        else if (current->is_object())
+        {
+            auto it = current->find(token.key);
+            if (it != current->object_range().end())
+            {
+                return std::addressof(it->value());
+            }
+            if (create_if_missing)
+            {
+                auto r = current->try_emplace(token.key, Json());
+                return std::addressof(r.first->value());
+            }
+            ec = jsonpointer_errc::key_not_found;
+            return current;
+        }
+        ec = jsonpointer_errc::expected_object_or_array;
+        return current;
+    }
+
+    // Resolves all but the last token of a non-empty compiled pointer
+    template <typename Json>
+    Json* resolve_parent(Json& root, const basic_compiled_json_pointer<typename Json::char_type>& location, bool create_if_missing, std::error_code& ec)
+    {
+        Json* current = std::addressof(root);
+        for (std::size_t i = 0; i + 1 < location.size(); ++i)
+        {
+            current = resolve(current, location[i], create_if_missing, ec);
+            if (JSONCONS_UNLIKELY(ec))
+            {
+                return current;
+            }
+        }
+        return current;
+    }
+
+    // Adds value as the last token of a pointer in parent, as add does
+    template <typename Json,typename T>
+    void add_to_parent(Json* parent, const typename Json::string_view_type& buffer, T&& value, std::error_code& ec)
+    {
+        if (parent->is_array())
+        {
+            if (buffer.size() == 1 && buffer[0] == '-')
+            {
+                parent->emplace_back(std::forward<T>(value));
+                return;
+            }
+            std::size_t index{0};
+            auto result = jsoncons::utility::dec_to_integer(buffer.data(), buffer.length(), index);
+            if (!result)
+            {
+                ec = jsonpointer_errc::invalid_index;
+                return;
+            }
+            if (index > parent->size())
+            {
+                ec = jsonpointer_errc::index_exceeds_array_size;
+                return;
+            }
+            if (index == parent->size())
+            {
+                parent->emplace_back(std::forward<T>(value));
+            }
+            else
+            {
+                parent->insert(parent->array_range().begin()+index, std::forward<T>(value));
+            }
+        }
+        else if (parent->is_object())
+        {
+            parent->insert_or_assign(buffer, std::forward<T>(value));
+        }
+        else
+        {
+            ec = jsonpointer_errc::expected_object_or_array;
+        }
+    }
+
+    // As above, with the index already parsed
+    template <typename Json,typename T>
+    void add_to_parent(Json* parent, const typename basic_compiled_json_pointer<typename Json::char_type>::token& token, T&& value, std::error_code& ec)
+    {
+        if (parent->is_array())
+        {
+            if (token.is_end)
+            {
+                parent->emplace_back(std::forward<T>(value));
+                return;
+            }
+            if (!token.is_index)
+            {
+                ec = jsonpointer_errc::invalid_index;
+                return;
+            }
+            if (token.index > parent->size())
+            {
+                ec = jsonpointer_errc::index_exceeds_array_size;
+                return;
+            }
+            if (token.index == parent->size())
+            {
+                parent->emplace_back(std::forward<T>(value));
+            }
+            else
+            {
+                parent->insert(parent->array_range().begin()+token.index, std::forward<T>(value));
+            }
+        }
+        else if (parent->is_object())
+        {
+            parent->insert_or_assign(token.key, std::forward<T>(value));
+        }
+        else
+        {
+            ec = jsonpointer_errc::expected_object_or_array;
+        }
+    }
+
     } // namespace detail
 
     // get
@@ -796,43 +1082,220 @@ namespace jsonpointer {
         }
     }
 
-    // add_if_absent
-
-    template <typename Json,typename T>
-    void add_if_absent(Json& root, 
-                       const basic_json_pointer<typename Json::char_type>& location, 
-                       T&& value, 
-                       bool create_if_missing,
-                       std::error_code& ec)
+    // Resolves a sequence of locations in the same document for lookups and adds, keeping
+    // the containers resolved for the previous location. A location only resolves the
+    // tokens that follow the ones it shares with the previous location, so a batch of
+    // locations under a common prefix walks that prefix once. Adds behave exactly as add
+    // called for each location in turn. The document must not be modified other than
+    // through the resolver while it is in use.
+    template <typename Json>
+    class prefix_resolver
     {
-        if (location.empty())
+        using char_type = typename Json::char_type;
+        using string_type = std::basic_string<char_type>;
+        using json_pointer_type = basic_json_pointer<char_type>;
+        using compiled_json_pointer_type = basic_compiled_json_pointer<char_type>;
+
+        // containers_[i] is the value reached by tokens_[0,i), containers_[0] is the root
+        std::vector<string_type> tokens_;
+        std::vector<Json*> containers_;
+    public:
+        explicit prefix_resolver(Json& root)
+            : containers_{std::addressof(root)}
         {
-            root = std::forward<T>(value);
-            return;
         }
-        Json* current = std::addressof(root);
 
-        std::basic_string<typename Json::char_type> buffer;
-        auto it = location.begin();
-        auto end = location.end();
+        // Returns the value at location, or nullptr if there is none
+        Json* find(const json_pointer_type& location)
+        {
+            return find_(location);
+        }
 
-        while (it != end)
+        Json* find(const compiled_json_pointer_type& location)
         {
-            buffer = *it;
-            ++it;
-            if (it != end)
-            {
-                current = jsoncons::jsonpointer::detail::resolve(current, buffer, create_if_missing, ec);
-                if (JSONCONS_UNLIKELY(ec))
-                    return;
-            }
+            return find_(location);
         }
-        if (current->is_array())
+
+        template <typename T>
+        void add(const json_pointer_type& location, T&& value, bool create_if_missing, std::error_code& ec)
         {
-            if (buffer.size() == 1 && buffer[0] == '-')
-            {
-                current->emplace_back(std::forward<T>(value));
-                current = std::addressof(current->at(current->size()-1));
+            add_(location, std::forward<T>(value), create_if_missing, ec);
+        }
+
+        template <typename T>
+        void add(const compiled_json_pointer_type& location, T&& value, bool create_if_missing, std::error_code& ec)
+        {
+            add_(location, std::forward<T>(value), create_if_missing, ec);
+        }
+
+    private:
+        static const string_type& last_token(const json_pointer_type& location)
+        {
+            return *location.rbegin();
+        }
+
+        static typename compiled_json_pointer_type::token last_token(const compiled_json_pointer_type& location)
+        {
+            return location.back();
+        }
+
+        template <typename Pointer>
+        Json* find_(const Pointer& location)
+        {
+            if (location.empty())
+            {
+                return containers_.front();
+            }
+            std::error_code ec;
+            Json* parent = resolve_parent(location, false, ec);
+            if (JSONCONS_UNLIKELY(ec))
+            {
+                return nullptr;
+            }
+            Json* current = jsoncons::jsonpointer::detail::resolve(parent, last_token(location), false, ec);
+            return JSONCONS_UNLIKELY(ec) ? nullptr : current;
+        }
+
+        template <typename Pointer,typename T>
+        void add_(const Pointer& location, T&& value, bool create_if_missing, std::error_code& ec)
+        {
+            if (location.empty())
+            {
+                *containers_.front() = std::forward<T>(value);
+                truncate(0);
+                return;
+            }
+            Json* parent = resolve_parent(location, create_if_missing, ec);
+            if (JSONCONS_UNLIKELY(ec))
+            {
+                return;
+            }
+
+            // Adding to the parent may move its members or elements, but not the parent
+            // itself or the containers above it
+            jsoncons::jsonpointer::detail::add_to_parent(parent, last_token(location), std::forward<T>(value), ec);
+        }
+
+        void truncate(std::size_t depth)
+        {
+            tokens_.resize(depth);
+            containers_.resize(depth + 1);
+        }
+
+        // Resolves all but the last token of a non-empty location. On return the cache
+        // holds exactly the containers along that part of the location that were reached.
+        Json* resolve_parent(const json_pointer_type& location, bool create_if_missing, std::error_code& ec)
+        {
+            auto it = location.begin();
+            const auto parent_end = location.end() - 1;
+
+            std::size_t shared = 0;
+            while (it != parent_end && shared < tokens_.size() && tokens_[shared] == *it)
+            {
+                ++shared;
+                ++it;
+            }
+            truncate(shared);
+
+            Json* current = containers_.back();
+            for (; it != parent_end; ++it)
+            {
+                current = jsoncons::jsonpointer::detail::resolve(current, *it, create_if_missing, ec);
+                if (JSONCONS_UNLIKELY(ec))
+                {
+                    return current;
+                }
+                tokens_.push_back(*it);
+                containers_.push_back(current);
+            }
+            return current;
+        }
+
+        // As above, using the tokens' parsed indices
+        Json* resolve_parent(const compiled_json_pointer_type& location, bool create_if_missing, std::error_code& ec)
+        {
+            const std::size_t depth = location.size() - 1;
+
+            std::size_t shared = 0;
+            while (shared < depth && shared < tokens_.size() && location[shared].key == tokens_[shared])
+            {
+                ++shared;
+            }
+            truncate(shared);
+
+            Json* current = containers_.back();
+            for (std::size_t i = shared; i < depth; ++i)
+            {
+                auto token = location[i];
+                current = jsoncons::jsonpointer::detail::resolve(current, token, create_if_missing, ec);
+                if (JSONCONS_UNLIKELY(ec))
+                {
+                    return current;
+                }
+                tokens_.emplace_back(token.key.data(), token.key.size());
+                containers_.push_back(current);
+            }
+            return current;
+        }
+    };
+
+    // add_all
+
+    // Adds each value in [first,last) at its location, in order, with the same result as
+    // calling add for each one. The iterators dereference to pairs of a location, parsed or
+    // compiled, and a value. Stops at the first location that fails, leaving the earlier values
+    // added.
+    template <typename Json,typename Iterator>
+    void add_all(Json& root, Iterator first, Iterator last, bool create_if_missing, std::error_code& ec)
+    {
+        prefix_resolver<Json> resolver(root);
+        for (; first != last; ++first)
+        {
+            resolver.add((*first).first, (*first).second, create_if_missing, ec);
+            if (JSONCONS_UNLIKELY(ec))
+            {
+                return;
+            }
+        }
+    }
+
+    // add_if_absent
+
+    template <typename Json,typename T>
+    void add_if_absent(Json& root, 
+                       const basic_json_pointer<typename Json::char_type>& location, 
+                       T&& value, 
+                       bool create_if_missing,
+                       std::error_code& ec)
+    {
+        if (location.empty())
+        {
+            root = std::forward<T>(value);
+            return;
+        }
+        Json* current = std::addressof(root);
+
+        std::basic_string<typename Json::char_type> buffer;
+        auto it = location.begin();
+        auto end = location.end();
+
+        while (it != end)
+        {
+            buffer = *it;
+            ++it;
+            if (it != end)
+            {
+                current = jsoncons::jsonpointer::detail::resolve(current, buffer, create_if_missing, ec);
+                if (JSONCONS_UNLIKELY(ec))
+                    return;
+            }
+        }
+        if (current->is_array())
+        {
+            if (buffer.size() == 1 && buffer[0] == '-')
+            {
+                current->emplace_back(std::forward<T>(value));
+                current = std::addressof(current->at(current->size()-1));
             }
             else
             {
@@ -1196,6 +1659,253 @@ namespace jsonpointer {
         }
     }
 
+    // Overloads taking a compiled pointer. They behave as the overloads taking a
+    // basic_json_pointer, and are meant for pointers that are resolved many times.
+
+    template <typename Json>
+    Json& get(Json& root, 
+              const basic_compiled_json_pointer<typename Json::char_type>& location, 
+              bool create_if_missing,
+              std::error_code& ec)
+    {
+        Json* current = std::addressof(root);
+        for (std::size_t i = 0; i < location.size(); ++i)
+        {
+            current = jsoncons::jsonpointer::detail::resolve(current, location[i], create_if_missing, ec);
+            if (JSONCONS_UNLIKELY(ec))
+                return *current;
+        }
+        return *current;
+    }
+
+    template <typename Json>
+    Json& get(Json& root, 
+              const basic_compiled_json_pointer<typename Json::char_type>& location, 
+              std::error_code& ec)
+    {
+        return get(root, location, false, ec);
+    }
+
+    template <typename Json>
+    const Json& get(const Json& root, 
+                    const basic_compiled_json_pointer<typename Json::char_type>& location, 
+                    std::error_code& ec)
+    {
+        const Json* current = std::addressof(root);
+        for (std::size_t i = 0; i < location.size(); ++i)
+        {
+            current = jsoncons::jsonpointer::detail::resolve(current, location[i], ec);
+            if (JSONCONS_UNLIKELY(ec))
+                return *current;
+        }
+        return *current;
+    }
+
+    template <typename Json>
+    Json& get(Json& root, 
+              const basic_compiled_json_pointer<typename Json::char_type>& location,
+              bool create_if_missing = false)
+    {
+        std::error_code ec;
+        Json& j = get(root, location, create_if_missing, ec);
+        if (JSONCONS_UNLIKELY(ec))
+        {
+            JSONCONS_THROW(jsonpointer_error(ec));
+        }
+        return j;
+    }
+
+    template <typename Json>
+    const Json& get(const Json& root, const basic_compiled_json_pointer<typename Json::char_type>& location)
+    {
+        std::error_code ec;
+        const Json& j = get(root, location, ec);
+        if (JSONCONS_UNLIKELY(ec))
+        {
+            JSONCONS_THROW(jsonpointer_error(ec));
+        }
+        return j;
+    }
+
+    template <typename Json>
+    bool contains(const Json& root, const basic_compiled_json_pointer<typename Json::char_type>& location)
+    {
+        std::error_code ec;
+        get(root, location, ec);
+        return !ec ? true : false;
+    }
+
+    template <typename Json,typename T>
+    void add(Json& root, 
+             const basic_compiled_json_pointer<typename Json::char_type>& location, 
+             T&& value, 
+             bool create_if_missing,
+             std::error_code& ec)
+    {
+        if (location.empty())
+        {
+            root = std::forward<T>(value);
+            return;
+        }
+        Json* parent = jsoncons::jsonpointer::detail::resolve_parent(root, location, create_if_missing, ec);
+        if (JSONCONS_UNLIKELY(ec))
+            return;
+        jsoncons::jsonpointer::detail::add_to_parent(parent, location.back(), std::forward<T>(value), ec);
+    }
+
+    template <typename Json,typename T>
+    void add(Json& root, 
+             const basic_compiled_json_pointer<typename Json::char_type>& location, 
+             T&& value, 
+             std::error_code& ec)
+    {
+        add(root, location, std::forward<T>(value), false, ec);
+    }
+
+    template <typename Json,typename T>
+    void add(Json& root, 
+             const basic_compiled_json_pointer<typename Json::char_type>& location, 
+             T&& value,
+             bool create_if_missing = false)
+    {
+        std::error_code ec;
+        add(root, location, std::forward<T>(value), create_if_missing, ec);
+        if (JSONCONS_UNLIKELY(ec))
+        {
+            JSONCONS_THROW(jsonpointer_error(ec));
+        }
+    }
+
+    template <typename Json>
+    void remove(Json& root, const basic_compiled_json_pointer<typename Json::char_type>& location, std::error_code& ec)
+    {
+        if (location.empty())
+        {
+            ec = jsonpointer_errc::cannot_remove_root;
+            return;
+        }
+        Json* parent = jsoncons::jsonpointer::detail::resolve_parent(root, location, false, ec);
+        if (JSONCONS_UNLIKELY(ec))
+            return;
+
+        auto token = location.back();
+        if (parent->is_array())
+        {
+            if (token.is_end || !token.is_index)
+            {
+                ec = token.is_end ? jsonpointer_errc::index_exceeds_array_size : jsonpointer_errc::invalid_index;
+                return;
+            }
+            if (token.index >= parent->size())
+            {
+                ec = jsonpointer_errc::index_exceeds_array_size;
+                return;
+            }
+            parent->erase(parent->array_range().begin()+token.index);
+        }
+        else if (parent->is_object())
+        {
+            auto it = parent->find(token.key);
+            if (it == parent->object_range().end())
+            {
+                ec = jsonpointer_errc::key_not_found;
+                return;
+            }
+            parent->erase(it);
+        }
+        else
+        {
+            ec = jsonpointer_errc::expected_object_or_array;
+        }
+    }
+
+    template <typename Json>
+    void remove(Json& root, const basic_compiled_json_pointer<typename Json::char_type>& location)
+    {
+        std::error_code ec;
+        remove(root, location, ec);
+        if (JSONCONS_UNLIKELY(ec))
+        {
+            JSONCONS_THROW(jsonpointer_error(ec));
+        }
+    }
+
+    template <typename Json,typename T>
+    void replace(Json& root, 
+                 const basic_compiled_json_pointer<typename Json::char_type>& location, 
+                 T&& value, 
+                 bool create_if_missing,
+                 std::error_code& ec)
+    {
+        if (location.empty())
+        {
+            root = std::forward<T>(value);
+            return;
+        }
+        Json* parent = jsoncons::jsonpointer::detail::resolve_parent(root, location, create_if_missing, ec);
+        if (JSONCONS_UNLIKELY(ec))
+            return;
+
+        auto token = location.back();
+        if (parent->is_array())
+        {
+            if (token.is_end || !token.is_index)
+            {
+                ec = token.is_end ? jsonpointer_errc::index_exceeds_array_size : jsonpointer_errc::invalid_index;
+                return;
+            }
+            if (token.index >= parent->size())
+            {
+                ec = jsonpointer_errc::index_exceeds_array_size;
+                return;
+            }
+            parent->at(token.index) = std::forward<T>(value);
+        }
+        else if (parent->is_object())
+        {
+            auto it = parent->find(token.key);
+            if (it != parent->object_range().end())
+            {
+                it->value() = std::forward<T>(value);
+            }
+            else if (create_if_missing)
+            {
+                parent->try_emplace(token.key, std::forward<T>(value));
+            }
+            else
+            {
+                ec = jsonpointer_errc::key_not_found;
+            }
+        }
+        else
+        {
+            ec = jsonpointer_errc::expected_object_or_array;
+        }
+    }
+
+    template <typename Json,typename T>
+    void replace(Json& root, 
+                 const basic_compiled_json_pointer<typename Json::char_type>& location, 
+                 T&& value, 
+                 std::error_code& ec)
+    {
+        replace(root, location, std::forward<T>(value), false, ec);
+    }
+
+    template <typename Json,typename T>
+    void replace(Json& root, 
+                 const basic_compiled_json_pointer<typename Json::char_type>& location, 
+                 T&& value,
+                 bool create_if_missing = false)
+    {
+        std::error_code ec;
+        replace(root, location, std::forward<T>(value), create_if_missing, ec);
+        if (JSONCONS_UNLIKELY(ec))
+        {
+            JSONCONS_THROW(jsonpointer_error(ec));
+        }
+    }
+
     template <typename String,typename Result>
     typename std::enable_if<std::is_convertible<typename String::value_type,typename Result::value_type>::value>::type
     escape(const String& s, Result& result)
@@ -1221,33 +1931,35 @@ namespace jsonpointer {
 
     // flatten
 
+    namespace detail {
+
+    // Adds the members for value, whose key is key. Each level appends its token to the one key
+    // buffer and truncates it again afterwards, rather than copying its parent's key.
     template <typename Json>
-    void flatten_(const std::basic_string<typename Json::char_type>& parent_key,
-                  const Json& parent_value,
-                  Json& result)
+    void flatten_(std::basic_string<typename Json::char_type>& key,
+                  const Json& value,
+                  jsoncons::detail::flattened_members<Json,std::basic_string<typename Json::char_type>>& members)
     {
         using char_type = typename Json::char_type;
-        using string_type = std::basic_string<char_type>;
 
-        switch (parent_value.type())
+        const std::size_t length = key.size();
+        switch (value.type())
         {
             case json_type::array_value:
             {
-                if (parent_value.empty())
+                if (value.empty())
                 {
-                    // Flatten empty array to null
-                    //result.try_emplace(parent_key, null_type{});
-                    //result[parent_key] = parent_value;
-                    result.try_emplace(parent_key, parent_value);
+                    members.emplace_back(key, value);
                 }
                 else
                 {
-                    for (std::size_t i = 0; i < parent_value.size(); ++i)
+                    std::size_t i = 0;
+                    for (const auto& item : value.array_range())
                     {
-                        string_type key(parent_key);
                         key.push_back('/');
-                        jsoncons::utility::from_integer(i,key);
-                        flatten_(key, parent_value.at(i), result);
+                        jsoncons::utility::from_integer(i++,key);
+                        flatten_(key, item, members);
+                        key.resize(length);
                     }
                 }
                 break;
@@ -1255,21 +1967,18 @@ namespace jsonpointer {
 
             case json_type::object_value:
             {
-                if (parent_value.empty())
+                if (value.empty())
                 {
-                    // Flatten empty object to null
-                    //result.try_emplace(parent_key, null_type{});
-                    //result[parent_key] = parent_value;
-                    result.try_emplace(parent_key, parent_value);
+                    members.emplace_back(key, value);
                 }
                 else
                 {
-                    for (const auto& item : parent_value.object_range())
+                    for (const auto& item : value.object_range())
                     {
-                        string_type key(parent_key);
                         key.push_back('/');
                         escape(jsoncons::basic_string_view<char_type>(item.key().data(),item.key().size()), key);
-                        flatten_(key, item.value(), result);
+                        flatten_(key, item.value(), members);
+                        key.resize(length);
                     }
                 }
                 break;
@@ -1277,20 +1986,23 @@ namespace jsonpointer {
 
             default:
             {
-                // add primitive parent_value with its reference string
-                //result[parent_key] = parent_value;
-                result.try_emplace(parent_key, parent_value);
+                members.emplace_back(key, value);
                 break;
             }
         }
     }
 
+    } // namespace detail
+
     template <typename Json>
     Json flatten(const Json& value)
     {
+        jsoncons::detail::flattened_members<Json,std::basic_string<typename Json::char_type>> members;
+        std::basic_string<typename Json::char_type> key;
+        detail::flatten_(key, value, members);
+
         Json result;
-        std::basic_string<typename Json::char_type> parent_key;
-        flatten_(parent_key, value, result);
+        jsoncons::detail::make_flattened_object(members, result);
         return result;
     }
 
@@ -1300,12 +2012,15 @@ namespace jsonpointer {
     enum class unflatten_options {none,assume_object = 1
 };
 
+    namespace detail {
+
+    // Turns each object whose keys are 0, 1, 2, ... in order into an array of its values
     template <typename Json>
-    Json safe_unflatten (Json& value)
+    void safe_unflatten_(Json& value)
     {
         if (!value.is_object() || value.empty())
         {
-            return value;
+            return;
         }
         bool safe = true;
         std::size_t index = 0;
@@ -1320,51 +2035,107 @@ namespace jsonpointer {
             }
         }
 
+        for (auto& item : value.object_range())
+        {
+            safe_unflatten_(item.value());
+        }
         if (safe)
         {
-            Json j(json_array_arg);
-            j.reserve(value.size());
-            for (auto& item : value.object_range())
-            {
-                j.emplace_back(std::move(item.value()));
-            }
             Json a(json_array_arg);
-            for (auto& item : j.array_range())
+            a.reserve(value.size());
+            for (auto& item : value.object_range())
             {
-                a.emplace_back(safe_unflatten (item));
+                a.emplace_back(std::move(item.value()));
             }
-            return a;
+            value = std::move(a);
         }
-        else
+    }
+
+    // The tokens of the key being unflattened, and the path the previous key took. Keys of a
+    // flattened document usually share a prefix with the key before them, and the members
+    // that prefix names are taken from here instead of being looked up again.
+    template <typename Json>
+    class unflatten_path
+    {
+        using string_type = std::basic_string<typename Json::char_type>;
+
+        std::vector<string_type> tokens_;
+        std::vector<string_type> previous_;
+        std::size_t count_{0};
+        std::size_t previous_count_{0};
+        std::vector<Json*> parts_; // parts_[i+1] is where step i of the previous key led
+    public:
+        std::size_t parse(const typename Json::string_view_type& key)
         {
-            Json o(json_object_arg);
-            for (auto& item : value.object_range())
+            tokens_.swap(previous_);
+            previous_count_ = count_;
+
+            std::error_code ec;
+            count_ = parse_tokens(key, tokens_, ec);
+            if (JSONCONS_UNLIKELY(ec))
+            {
+                JSONCONS_THROW(jsonpointer_error(ec));
+            }
+            if (parts_.size() <= count_)
             {
-                o.try_emplace(item.key(), safe_unflatten (item.value()));
+                parts_.resize(count_ + 1);
             }
-            return o;
+            return count_;
+        }
+
+        const string_type& operator[](std::size_t i) const
+        {
+            return tokens_[i];
+        }
+
+        // Whether step i names the same member as step i of the previous key
+        bool shares(std::size_t i) const
+        {
+            return i < previous_count_ && tokens_[i] == previous_[i];
+        }
+
+        Json* reached(std::size_t i) const
+        {
+            return parts_[i + 1];
+        }
+
+        void reach(std::size_t i, Json* part)
+        {
+            parts_[i + 1] = part;
         }
+    };
+
+    } // namespace detail
+
+    template <typename Json>
+    Json safe_unflatten (Json& value)
+    {
+        Json result(value);
+        detail::safe_unflatten_(result);
+        return result;
     }
 
     template <typename Json>
     jsoncons::optional<Json> try_unflatten_array(const Json& value)
     {
-        using char_type = typename Json::char_type;
-
         if (JSONCONS_UNLIKELY(!value.is_object()))
         {
             JSONCONS_THROW(jsonpointer_error(jsonpointer_errc::argument_to_unflatten_invalid));
         }
         Json result;
+        detail::unflatten_path<Json> path;
 
         for (const auto& item: value.object_range())
         {
             Json* part = &result;
-            basic_json_pointer<char_type> ptr(item.key());
+            const std::size_t count = path.parse(item.key());
+            bool shared = true; // every step so far reached what it did for the previous key
             std::size_t index = 0;
-            for (auto it = ptr.begin(); it != ptr.end(); )
+            for (std::size_t i = 0; i < count; ++i)
             {
-                auto s = *it;
+                const auto& s = path[i];
+                const bool last = i + 1 == count;
+                shared = shared && path.shares(i);
                 std::size_t n{0};
                 auto r = jsoncons::utility::dec_to_integer(s.data(), s.size(), n);
                 if (r.ec == std::errc() && (index++ == n))
@@ -1372,17 +2143,20 @@ namespace jsonpointer {
                     if (!part->is_array())
                     {
                         *part = Json(json_array_arg);
+                        shared = false;
                     }
-                    if (++it != ptr.end())
+                    if (!last)
                     {
                         if (n+1 > part->size())
                         {
                             Json& ref = part->emplace_back();
                             part = std::addressof(ref);
+                            shared = false;
                         }
                         else
                         {
                             part = &part->at(n);
+                            shared = shared && part == path.reached(i);
                         }
                     }
                     else
@@ -1393,10 +2167,17 @@ namespace jsonpointer {
                 }
                 else if (part->is_object())
                 {
-                    if (++it != ptr.end())
+                    if (!last)
                     {
-                        auto res = part->try_emplace(s,Json());
-                        part = &(res.first->value());
+                        if (shared)
+                        {
+                            part = path.reached(i);
+                        }
+                        else
+                        {
+                            auto res = part->try_emplace(s,Json());
+                            part = &(res.first->value());
+                        }
                     }
                     else
                     {
@@ -1408,6 +2189,7 @@ namespace jsonpointer {
                 {
                     return jsoncons::optional<Json>();
                 }
+                path.reach(i, part);
             }
         }
 
@@ -1417,35 +2199,48 @@ namespace jsonpointer {
     template <typename Json>
     Json unflatten_to_object(const Json& value, unflatten_options options = unflatten_options::none)
     {
-        using char_type = typename Json::char_type;
-
         if (JSONCONS_UNLIKELY(!value.is_object()))
         {
             JSONCONS_THROW(jsonpointer_error(jsonpointer_errc::argument_to_unflatten_invalid));
         }
         Json result;
+        detail::unflatten_path<Json> path;
 
         for (const auto& item: value.object_range())
         {
             Json* part = &result;
-            basic_json_pointer<char_type> ptr(item.key());
-            for (auto it = ptr.begin(); it != ptr.end(); )
+            const std::size_t count = path.parse(item.key());
+            bool shared = true;
+            for (std::size_t i = 0; i < count; ++i)
             {
-                auto s = *it;
-                if (++it != ptr.end())
+                const auto& s = path[i];
+                shared = shared && path.shares(i);
+                if (i + 1 < count)
                 {
-                    auto res = part->try_emplace(s,Json());
-                    part = &(res.first->value());
+                    if (shared)
+                    {
+                        part = path.reached(i);
+                    }
+                    else
+                    {
+                        auto res = part->try_emplace(s,Json());
+                        part = &(res.first->value());
+                    }
                 }
                 else
                 {
                     auto res = part->try_emplace(s, item.value());
                     part = &(res.first->value());
                 }
+                path.reach(i, part);
             }
         }
 
-        return options == unflatten_options::none ? safe_unflatten (result) : result;
+        if (options == unflatten_options::none)
+        {
+            detail::safe_unflatten_(result);
+        }
+        return result;
     }
 
     template <typename Json>
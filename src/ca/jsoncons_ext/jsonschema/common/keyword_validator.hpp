@@ -33,11 +33,20 @@
 #include <jsoncons_ext/jsonschema/common/validator.hpp>
 
 #if defined(JSONCONS_HAS_STD_REGEX)
-#include <regex>
+#include <jsoncons/utility/regex.hpp>
 #endif
 
 namespace jsoncons {
 namespace jsonschema {
+
+#if defined(JSONCONS_HAS_STD_REGEX)
+namespace detail {
+
+    // Compiled patterns are shared through the process-wide cache
+    using regex_pointer = std::shared_ptr<const jsoncons::utility::regex_matcher>;
+
+} // namespace detail
+#endif
     
     template <typename Json>
     class schema_validator;
@@ -624,13 +633,13 @@ namespace jsonschema {
         using walk_reporter_type = typename json_schema_traits<Json>::walk_reporter_type;
 
         std::string pattern_string_;
-        std::regex regex_;
+        detail::regex_pointer regex_;
 
     public:
         pattern_validator(const Json& schema, const uri& schema_location, const std::string& custom_message,
-            const std::string& pattern_string, const std::regex& regex)
+            const std::string& pattern_string, detail::regex_pointer&& regex)
             : keyword_validator<Json>("pattern", schema, schema_location, custom_message), 
-              pattern_string_(pattern_string), regex_(regex)
+              pattern_string_(pattern_string), regex_(std::move(regex))
         {
         }
 
@@ -649,9 +658,9 @@ namespace jsonschema {
 
             eval_context<Json> this_context(context, this->keyword_name());
 
-            auto s = instance.template as<std::string>();
-            if (!std::regex_search(s, regex_))
+            if (!regex_->search(instance.as_string_view()))
             {
+                auto s = instance.template as<std::string>();
                 std::string message("String '");
                 message.append(s);
                 message.append("' does not match pattern '");
@@ -2735,11 +2744,11 @@ namespace jsonschema {
         using schema_validator_ptr_type = typename schema_validator<Json>::schema_validator_ptr_type;
         using walk_reporter_type = typename json_schema_traits<Json>::walk_reporter_type;
 
-        std::vector<std::pair<std::regex, schema_validator_ptr_type>> pattern_properties_;
+        std::vector<std::pair<detail::regex_pointer, schema_validator_ptr_type>> pattern_properties_;
 
     public:
         pattern_properties_validator(const Json& schema, const uri& schema_location, const std::string& custom_message,
-            std::vector<std::pair<std::regex, schema_validator_ptr_type>>&& pattern_properties)
+            std::vector<std::pair<detail::regex_pointer, schema_validator_ptr_type>>&& pattern_properties)
             : keyword_validator<Json>("patternProperties", schema, std::move(schema_location), custom_message),
               pattern_properties_(std::move(pattern_properties))
         {
@@ -2773,7 +2782,7 @@ namespace jsonschema {
                 // check all matching "patternProperties"
                 for (auto& schema_pp : pattern_properties_)
                 {
-                    if (std::regex_search(prop.key(), schema_pp.first)) 
+                    if (schema_pp.first->search(prop.key())) 
                     {
                         allowed_properties.insert(prop.key());
                         std::size_t errors = reporter.error_count();
@@ -2820,7 +2829,7 @@ namespace jsonschema {
                 // check all matching "patternProperties"
                 for (auto& schema_pp : pattern_properties_)
                 {
-                    if (std::regex_search(prop.key(), schema_pp.first)) 
+                    if (schema_pp.first->search(prop.key())) 
                     {
                         allowed_properties.insert(prop.key());
                         result = schema_pp.second->walk(prop_context, prop.value() , prop_location, reporter);
@@ -83,14 +83,14 @@ namespace jsonschema {
             uri schema_location = context.get_base_uri();
             std::string custom_message = context.get_custom_message(keyword);
 
-            std::vector<std::pair<std::regex, schema_validator_ptr_type>> pattern_properties;
+            std::vector<std::pair<detail::regex_pointer, schema_validator_ptr_type>> pattern_properties;
             
             for (const auto& prop : sch.object_range())
             {
                 std::string sub_keys[] = {keyword};
                 pattern_properties.emplace_back(
                     std::make_pair(
-                        std::regex(prop.key(), std::regex::ECMAScript),
+                        jsoncons::utility::cached_regex_matcher<char>(prop.key()),
                         factory_->make_cross_draft_schema_validator(context, prop.value(), sub_keys, anchor_dict)));
                 
             }
@@ -447,9 +447,9 @@ namespace jsonschema {
         {
             uri schema_location = context.make_schema_location("pattern");
             auto pattern_string = sch.template as<std::string>();
-            auto regex = std::regex(pattern_string, std::regex::ECMAScript);
+            auto regex = jsoncons::utility::cached_regex_matcher<char>(pattern_string);
             return jsoncons::make_unique<pattern_validator<Json>>(parent, schema_location, context.get_custom_message("pattern"), 
-                pattern_string, regex);
+                pattern_string, std::move(regex));
         }
 
         std::unique_ptr<max_items_validator<Json>> make_max_items_validator(const compilation_context<Json>& context, 
@@ -7,6 +7,11 @@
 #ifndef JSONCONS_EXT_MERGEPATCH_MERGEPATCH_HPP
 #define JSONCONS_EXT_MERGEPATCH_MERGEPATCH_HPP
 
+#include <algorithm> // std::sort
+#include <cstddef>
+#include <utility> // std::move
+#include <vector>
+
 #include <jsoncons/json_type.hpp>
 
 namespace jsoncons { 
@@ -50,38 +55,89 @@ namespace mergepatch {
     }
 
     namespace detail {
+
         template <typename Json>
-        Json apply_merge_patch_(Json& target, const Json& patch)
+        const Json& take_patch_value(const Json& value)
+        {
+            return value;
+        }
+
+        template <typename Json>
+        Json&& take_patch_value(Json& value)
+        {
+            return std::move(value);
+        }
+
+        // Merges patch into target where its members sit: existing members are patched in place,
+        // removed members are dropped in one pass at the end, and new members are added after
+        // that. Values are moved out of patch when it is not const.
+        template <typename Json,typename Patch>
+        void apply_merge_patch_(Json& target, Patch& patch)
         {
-            if (patch.is_object())
+            if (!patch.is_object())
             {
-                if (!target.is_object())
-                {
-                    target = Json(json_object_arg);
-                }
-                for (auto& member : patch.object_range())
+                target = take_patch_value(patch);
+                return;
+            }
+            if (!target.is_object())
+            {
+                target = Json(json_object_arg);
+            }
+
+            std::vector<std::size_t> removed;
+            std::vector<decltype(patch.object_range().begin())> added;
+            for (auto member = patch.object_range().begin(); member != patch.object_range().end(); ++member)
+            {
+                auto it = target.find((*member).key());
+                if (it == target.object_range().end())
                 {
-                    auto it = target.find(member.key());
-                    if (it != target.object_range().end())
+                    if (!(*member).value().is_null())
                     {
-                        Json item = (*it).value();
-                        target.erase(it);
-                        if (!member.value().is_null())
-                        {
-                            target.try_emplace(member.key(), apply_merge_patch_(item, member.value()));
-                        }
+                        added.push_back(member);
                     }
-                    else if (!member.value().is_null())
+                }
+                else if ((*member).value().is_null())
+                {
+                    removed.push_back(static_cast<std::size_t>(it - target.object_range().begin()));
+                }
+                else
+                {
+                    apply_merge_patch_((*it).value(), (*member).value());
+                }
+            }
+
+            if (!removed.empty())
+            {
+                std::sort(removed.begin(), removed.end());
+                auto first = target.object_range().begin();
+                auto last = target.object_range().end();
+                auto out = first + removed[0];
+                std::size_t next = 0;
+                for (auto in = out; in != last; ++in)
+                {
+                    if (next < removed.size() && static_cast<std::size_t>(in - first) == removed[next])
                     {
-                        Json item(json_object_arg);
-                        target.try_emplace(member.key(), apply_merge_patch_(item, member.value()));
+                        ++next;
+                        continue;
                     }
+                    *out = std::move(*in);
+                    ++out;
                 }
-                return target;
+                target.erase(out, last);
             }
-            else
+
+            for (auto member : added)
             {
-                return patch;
+                if ((*member).value().is_object())
+                {
+                    Json item(json_object_arg);
+                    apply_merge_patch_(item, (*member).value());
+                    target.try_emplace((*member).key(), std::move(item));
+                }
+                else
+                {
+                    target.try_emplace((*member).key(), take_patch_value((*member).value()));
+                }
             }
         }
     } // namespace detail
@@ -89,7 +145,14 @@ namespace mergepatch {
     template <typename Json>
     void apply_merge_patch(Json& target, const Json& patch)
     {
-        target = detail::apply_merge_patch_(target, patch);
+        detail::apply_merge_patch_(target, patch);
+    }
+
+    // As above, moving values out of patch instead of copying them
+    template <typename Json>
+    void apply_merge_patch(Json& target, Json&& patch)
+    {
+        detail::apply_merge_patch_(target, patch);
     }
 
 } // namespace mergepatch
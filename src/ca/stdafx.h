@@ -22,8 +22,12 @@
 #include <regex>
 #include <cstdint>
 #include <filesystem>
+#include <map>
 
 // TODO: reference additional headers your program requires here
 #include "jsoncons/json.hpp"
 #include "jsoncons_ext/jsonpath/jsonpath.hpp"
+#include "jsoncons_ext/jsonpatch/jsonpatch.hpp"
+#include "jsoncons_ext/jsonpatch/stream_patch.hpp"
+#include "jsoncons_ext/mergepatch/mergepatch.hpp"
 #include "jsoncons_ext/jsonpointer/jsonpointer.hpp"
@@ -11,6 +11,9 @@
 		InsertArray = 64,
 		RemoveArrayElement = 128,
 		// DistinctValues = 256 is not used to maintain compatibility with existing ValidateSchema flag (JsonFlags = 256)
-		DistinctValues = 512
+		DistinctValues = 512,
+		// 1024 is the OnlyIfExists flag
+		ApplyJsonPatch = 2048,
+		MergeJson = 4096
 	}
 }
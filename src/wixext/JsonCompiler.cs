@@ -281,6 +281,8 @@ namespace Hegsie.Wix.JsonExtension
 			const string ActionInsertArray = "insertArray";
 			const string ActionRemoveArrayElement = "removeArrayElement";
 			const string ActionDistinctValues = "distinctValues";
+			const string ActionApplyJsonPatch = "applyJsonPatch";
+			const string ActionMergeJson = "mergeJson";
 
 			int action;
 			string actionValue = ParseHelper.GetAttributeValue(sourceLineNumbers, attribute);
@@ -328,10 +330,19 @@ namespace Hegsie.Wix.JsonExtension
 						flags |= (int)JsonFlags.DistinctValues;
 						action = (int)JsonAction.DistinctValues;
 						break;
+					case ActionApplyJsonPatch:
+						flags |= (int)JsonFlags.ApplyJsonPatch;
+						action = (int)JsonAction.ApplyJsonPatch;
+						break;
+					case ActionMergeJson:
+						flags |= (int)JsonFlags.MergeJson;
+						action = (int)JsonAction.MergeJson;
+						break;
 					default:
 						Messaging.Write(ErrorMessages.IllegalAttributeValue(sourceLineNumbers, node.Name.ToString(),
 							"Action", actionValue, ActionDeleteValue, ActionSetValue, ActionReplaceJsonValue, 
-							ActionCreateValue, ActionReadValue, ActionAppendArray, ActionInsertArray, ActionRemoveArrayElement, ActionDistinctValues));
+							ActionCreateValue, ActionReadValue, ActionAppendArray, ActionInsertArray, ActionRemoveArrayElement, ActionDistinctValues,
+							ActionApplyJsonPatch, ActionMergeJson));
 						action = CompilerConstants.IllegalInteger;
 						break;
 				}
@@ -374,11 +385,14 @@ namespace Hegsie.Wix.JsonExtension
 				}
 			}
 			else if ((action == (int)JsonAction.SetValue || action == (int)JsonAction.ReplaceJsonValue || 
-			         action == (int)JsonAction.CreateJsonPointerValue) && string.IsNullOrEmpty(value))
+			         action == (int)JsonAction.CreateJsonPointerValue || action == (int)JsonAction.ApplyJsonPatch ||
+			         action == (int)JsonAction.MergeJson) && string.IsNullOrEmpty(value))
 			{
 				// These actions require Value attribute
 				string actionName = action == (int)JsonAction.SetValue ? "setValue" :
-				                   action == (int)JsonAction.ReplaceJsonValue ? "replaceJsonValue" : "createJsonPointerValue";
+				                   action == (int)JsonAction.ReplaceJsonValue ? "replaceJsonValue" :
+				                   action == (int)JsonAction.ApplyJsonPatch ? "applyJsonPatch" :
+				                   action == (int)JsonAction.MergeJson ? "mergeJson" : "createJsonPointerValue";
 				Messaging.Write(ErrorMessages.ExpectedAttribute(sourceLineNumbers, node.Name.ToString(), "Value", "Action", actionName));
 			}
 
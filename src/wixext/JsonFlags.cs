@@ -12,6 +12,8 @@
 		RemoveArrayElement = 128,
 		ValidateSchema = 256,
 		DistinctValues = 512,
-		OnlyIfExists = 1024
+		OnlyIfExists = 1024,
+		ApplyJsonPatch = 2048,
+		MergeJson = 4096
 	}
 }
@@ -6,6 +6,7 @@
 // so CI can publish them as a PR check; the process exit code is the number of failed tests.
 
 #include "JsonFile.h"
+#include "jsoncons_ext/jsonpatch/structural_diff.hpp"
 
 #include <cstdio>
 #include <cstdlib>
@@ -13,6 +14,7 @@
 #include <vector>
 #include <atomic>
 #include <chrono>
+#include <iterator>
 
 struct TestResult
 {
@@ -74,6 +76,12 @@ static json ReadJson(const std::wstring& path)
     return json::parse(is);
 }
 
+static std::string ReadText(const std::wstring& path)
+{
+    std::ifstream is{ fs::path(path) };
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
 static void RemoveFile(const std::wstring& path)
 {
     std::error_code ec;
@@ -110,6 +118,16 @@ static void Test_DeleteValue_RemovesKey()
     RemoveFile(path);
 }
 
+static void Test_DeleteValue_DuplicateUnionIndexRemovedOnce()
+{
+    auto path = WriteTempJson(R"({"items":[1,2,3,4]})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.items[1,1]", L"", FlagFor(FLAG_DELETEVALUE), -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j["items"].size() == 3);
+    CHECK(j["items"][1].as<int>() == 3);
+    RemoveFile(path);
+}
+
 static void Test_AppendArray_AddsElement()
 {
     auto path = WriteTempJson(R"({"items":[1,2]})");
@@ -174,6 +192,29 @@ static void Test_SetValue_WritesTypedValueForNonStrings()
     RemoveFile(path);
 }
 
+static void Test_SetValue_WildcardAppliesPerMatchType()
+{
+    // One authored value applied to many matches: strings stay strings, other nodes get the typed form.
+    auto path = WriteTempJson(R"({"a":{"Port":"80"},"b":{"Port":8080},"c":{"Port":null}})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$..Port", L"9090", FlagFor(FLAG_SETVALUE), -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j["a"]["Port"].is_string() && j["a"]["Port"].as<std::string>() == "9090");
+    CHECK(j["b"]["Port"].is_number() && j["b"]["Port"].as<int>() == 9090);
+    CHECK(j["c"]["Port"].is_number() && j["c"]["Port"].as<int>() == 9090);
+    RemoveFile(path);
+}
+
+static void Test_SetValue_PlainTextBecomesString()
+{
+    // Text that is not valid JSON falls back to a string without failing the operation.
+    auto path = WriteTempJson(R"({"items":[{"Name":1},{"Name":true}]})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.items[*].Name", L"not {json", FlagFor(FLAG_SETVALUE), -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j["items"][0]["Name"].as<std::string>() == "not {json");
+    CHECK(j["items"][1]["Name"].as<std::string>() == "not {json");
+    RemoveFile(path);
+}
+
 static void Test_CreatePointer_UpdatesExistingValue()
 {
     // createJsonPointerValue is set-or-create: an existing value is replaced, not left as-is.
@@ -224,6 +265,276 @@ static void Test_DistinctArray_RemovesDuplicates()
     RemoveFile(path);
 }
 
+static void Test_DistinctArray_RejectsNonArrayMatch()
+{
+    // Every match must be an array; the file is left untouched otherwise.
+    auto path = WriteTempJson(R"({"a":{"items":[1,1]},"b":{"items":"x"}})");
+    CHECK(E_INVALIDARG == UpdateJsonFile(path.c_str(), L"$..items", L"", FlagFor(FLAG_DISTINCTVALUES), -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j["a"]["items"].size() == 2);
+    RemoveFile(path);
+}
+
+static void Test_ApplyJsonPatch_AppliesAllOperations()
+{
+    auto path = WriteTempJson(R"({"Logging":{"LogLevel":{"Default":"Information"}},"Debug":true,"Hosts":["a"]})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$",
+        LR"([{"op":"replace","path":"/Logging/LogLevel/Default","value":"Warning"},{"op":"remove","path":"/Debug"},{"op":"add","path":"/Hosts/-","value":"b"}])",
+        FlagFor(FLAG_APPLYJSONPATCH), -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j == json::parse(R"({"Logging":{"LogLevel":{"Default":"Warning"}},"Hosts":["a","b"]})"));
+
+    // The patch may also come from a file
+    auto patchPath = WriteTempJson(R"([{"op":"copy","from":"/Hosts/0","path":"/Primary"}])");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$", patchPath.c_str(), FlagFor(FLAG_APPLYJSONPATCH), -1, L""));
+    j = ReadJson(path);
+    CHECK(j["Primary"].as<std::string>() == "a");
+    RemoveFile(patchPath);
+    RemoveFile(path);
+}
+
+static void Test_ApplyJsonPatch_FailureLeavesFileUnchanged()
+{
+    // The patch applies to "a" but its test operation fails on "b", so neither match is written.
+    const std::string original = R"({"a":{"v":1},"b":{"v":2}})";
+    const wchar_t* patch = LR"([{"op":"test","path":"/v","value":1},{"op":"replace","path":"/v","value":0},{"op":"add","path":"/w","value":3}])";
+    auto path = WriteTempJson(original);
+    CHECK(FAILED(UpdateJsonFile(path.c_str(), L"$.*", patch, FlagFor(FLAG_APPLYJSONPATCH), -1, L"")));
+    CHECK(ReadJson(path) == json::parse(original));
+
+    CHECK(E_INVALIDARG == UpdateJsonFile(path.c_str(), L"$", L"{\"op\":\"remove\"}", FlagFor(FLAG_APPLYJSONPATCH), -1, L""));
+    CHECK(ReadJson(path) == json::parse(original));
+
+    // The same patch succeeds when "a" is the only match
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.a", patch, FlagFor(FLAG_APPLYJSONPATCH), -1, L""));
+    CHECK(ReadJson(path) == json::parse(R"({"a":{"v":0,"w":3},"b":{"v":2}})"));
+    RemoveFile(path);
+}
+
+static void Test_MergeJson_MergesOverlayFile()
+{
+    auto path = WriteTempJson(R"({"Logging":{"LogLevel":{"Default":"Information","Microsoft":"Warning"}},"Debug":true})");
+    auto overlayPath = WriteTempJson(R"({"Logging":{"LogLevel":{"Default":"Error","Microsoft":null}},"Debug":null,"AllowedHosts":"*"})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$", overlayPath.c_str(), FlagFor(FLAG_MERGEJSON), -1, L""));
+    CHECK(ReadJson(path) == json::parse(R"({"Logging":{"LogLevel":{"Default":"Error"}},"AllowedHosts":"*"})"));
+
+    // An inline overlay merged into each match
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.Logging.LogLevel", LR"({"Console":"Debug"})", FlagFor(FLAG_MERGEJSON), -1, L""));
+    CHECK(ReadJson(path)["Logging"]["LogLevel"] == json::parse(R"({"Default":"Error","Console":"Debug"})"));
+    RemoveFile(overlayPath);
+    RemoveFile(path);
+}
+
+static void Test_MergeJson_HonorsOnlyIfExistsAndSchema()
+{
+    auto path = WriteTempJson(R"({"name":"abc"})");
+    int flags = FlagFor(FLAG_MERGEJSON) | FlagFor(FLAG_ONLYIFEXISTS);
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.Logging", LR"({"Default":"Error"})", flags, -1, L""));
+    CHECK(!ReadJson(path).contains("Logging"));
+
+    // The root always exists, so a merge into it needs no separate check; a malformed file still fails
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$", LR"({"Logging":{"Default":"Error"}})", flags, -1, L""));
+    CHECK(ReadJson(path)["Logging"]["Default"].as<std::string>() == "Error");
+    auto malformed = WriteTempJson(R"({"name":)");
+    CHECK(FAILED(UpdateJsonFile(malformed.c_str(), L"$", LR"({"a":1})", flags, -1, L"")));
+    CHECK(ReadText(malformed) == R"({"name":)");
+    RemoveFile(malformed);
+
+    auto schemaPath = WriteTempJson(
+        R"({"type":"object","required":["name"],"properties":{"name":{"type":"string"}}})");
+    flags = FlagFor(FLAG_MERGEJSON) | FlagFor(FLAG_VALIDATESCHEMA);
+    CHECK(FAILED(UpdateJsonFile(path.c_str(), L"$", LR"({"name":1})", flags, -1, schemaPath.c_str())));
+    RemoveFile(schemaPath);
+    RemoveFile(path);
+}
+
+static void Test_StreamedRewrite_MatchesInMemoryOrder()
+{
+    // Small files are patched in memory; streaming the same patch must write the same text
+    const std::string original = R"({"z":{"b":1,"a":2},"m":[1],"c":"x"})";
+    const std::string patch = R"([{"op":"add","path":"/z/y","value":1},{"op":"remove","path":"/c"},{"op":"add","path":"/b","value":{"q":1,"p":2}},{"op":"add","path":"/a","value":0}])";
+    const std::string overlay = R"({"z":{"a":null,"x":3},"n":{"s":1,"r":2},"d":4})";
+
+    auto inMemory = WriteTempJson(original);
+    auto streamed = WriteTempJson(original);
+    std::error_code ec;
+    CHECK_HR(UpdateJsonFile(inMemory.c_str(), L"$", std::wstring(patch.begin(), patch.end()).c_str(), FlagFor(FLAG_APPLYJSONPATCH), -1, L""));
+    const ojson patchJson = ojson::parse(patch);
+    CHECK_HR(RewriteJsonFile(streamed.c_str(), [&patchJson](std::istream& input, json_visitor& output, std::error_code& ec)
+        {
+            jsonpatch::stream_apply_patch(input, patchJson, output, ec);
+        }, ec));
+    CHECK(ReadText(inMemory) == ReadText(streamed));
+    CHECK(ReadText(streamed).find("\"z\"") < ReadText(streamed).find("\"m\""));
+
+    CHECK_HR(UpdateJsonFile(inMemory.c_str(), L"$", std::wstring(overlay.begin(), overlay.end()).c_str(), FlagFor(FLAG_MERGEJSON), -1, L""));
+    const ojson overlayJson = ojson::parse(overlay);
+    CHECK_HR(RewriteJsonFile(streamed.c_str(), [&overlayJson](std::istream& input, json_visitor& output, std::error_code& ec)
+        {
+            mergepatch::stream_apply_merge_patch(input, overlayJson, output, ec);
+        }, ec));
+    CHECK(ReadText(inMemory) == ReadText(streamed));
+    RemoveFile(inMemory);
+    RemoveFile(streamed);
+}
+
+static void Test_OnlyIfExists_RecursivePath()
+{
+    // The existence check stops at the first match of a recursive-descent path.
+    auto path = WriteTempJson(R"({"a":{"Level":"Info"},"b":[{"Level":"Warn"}]})");
+    int flags = FlagFor(FLAG_SETVALUE) | FlagFor(FLAG_ONLYIFEXISTS);
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$..Level", L"Debug", flags, -1, L""));
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$..Missing", L"x", flags, -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j["a"]["Level"].as<std::string>() == "Debug");
+    CHECK(j["b"][0]["Level"].as<std::string>() == "Debug");
+    CHECK(!j["a"].contains("Missing"));
+    RemoveFile(path);
+}
+
+static void Test_JsonPathCache_SharedByCheckAndAction()
+{
+    // The OnlyIfExists check and the update compile the path once between them.
+    auto path = WriteTempJson(R"({"a":{"Level":"Info"}})");
+    auto& cache = jsonpath::default_expression_cache<ojson>();
+    cache.clear();
+    int flags = FlagFor(FLAG_SETVALUE) | FlagFor(FLAG_ONLYIFEXISTS);
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.a.Level", L"Debug", flags, -1, L""));
+    CHECK(cache.misses() == 1);
+    CHECK(cache.hits() == 1);
+    auto j = ReadJson(path);
+    CHECK(j["a"]["Level"].as<std::string>() == "Debug");
+    RemoveFile(path);
+}
+
+static void Test_SetJsonPointerValues_MatchesRowByRow()
+{
+    const std::string original = R"({"a":{"s":"1","n":1},"list":[1]})";
+    const int create = FlagFor(FLAG_CREATEVALUE);
+    const int createIfExists = create | FlagFor(FLAG_ONLYIFEXISTS);
+    std::vector<JSON_POINTER_WRITE> writes = {
+        { L"/a/b/c", L"1", create },
+        { L"/a/b/d", L"true", create },
+        { L"/a/s", L"2", create },
+        { L"/missing/x", L"skipped", createIfExists },
+        { L"/a/n", L"7", createIfExists },
+        { L"/list/0", L"{\"x\":1}", create },
+        { L"/a/b/e", L"text", create } };
+
+    auto rowByRow = WriteTempJson(original);
+    for (const auto& write : writes)
+    {
+        CHECK_HR(UpdateJsonFile(rowByRow.c_str(), write.sElementPath.c_str(), write.sValue.c_str(), write.iFlags, -1, L""));
+    }
+    auto batched = WriteTempJson(original);
+    CHECK_HR(SetJsonPointerValues(batched.c_str(), writes, L""));
+    CHECK(ReadJson(batched) == ReadJson(rowByRow));
+    CHECK(ReadJson(batched)["a"]["s"].as<std::string>() == "2");
+
+    // A failing write leaves the file as it was
+    writes.push_back({ L"/list/5", L"1", create });
+    auto failed = WriteTempJson(original);
+    CHECK(FAILED(SetJsonPointerValues(failed.c_str(), writes, L"")));
+    CHECK(ReadJson(failed) == json::parse(original));
+
+    RemoveFile(rowByRow);
+    RemoveFile(batched);
+    RemoveFile(failed);
+}
+
+static void Test_SetValue_FilterComparesByType()
+{
+    // A string never compares greater than a number, so only the last item matches.
+    auto path = WriteTempJson(
+        R"({"items":[{"v":5,"s":"a","tag":""},{"v":"12","s":"a","tag":""},{"v":12,"s":"a","tag":""}]})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.items[?(@.v > 10 && @.s == 'a')].tag", L"hit",
+        FlagFor(FLAG_SETVALUE), -1, L""));
+    auto j = ReadJson(path);
+    CHECK(j["items"][0]["tag"].as<std::string>() == "");
+    CHECK(j["items"][1]["tag"].as<std::string>() == "");
+    CHECK(j["items"][2]["tag"].as<std::string>() == "hit");
+    RemoveFile(path);
+}
+
+static void Test_SetValue_FilterRegexMatch()
+{
+    // (a+)+$ backtracks exponentially on a run of a's that does not end the string. The i flag
+    // makes the match case-insensitive.
+    std::string longName(40, 'a');
+    auto path = WriteTempJson(
+        R"({"items":[{"name":"aaaa","tag":""},{"name":")" + longName + R"(!","tag":""},{"name":"AAA","tag":""}]})");
+    auto& paths = jsonpath::default_expression_cache<ojson>();
+    auto& patterns = jsoncons::utility::default_regex_matcher_cache<char>();
+    paths.clear();
+    patterns.clear();
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.items[?(@.name =~ /^(a+)+$/i)].tag", L"hit",
+        FlagFor(FLAG_SETVALUE), -1, L""));
+    // Compiling the path again asks for the pattern again, which is served from the cache
+    paths.clear();
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.items[?(@.name =~ /^(a+)+$/i)].tag", L"hit",
+        FlagFor(FLAG_SETVALUE), -1, L""));
+    CHECK(patterns.misses() == 1);
+    CHECK(patterns.hits() > 0);
+    CHECK(patterns.size() == 1);
+    auto j = ReadJson(path);
+    CHECK(j["items"][0]["tag"].as<std::string>() == "hit");
+    CHECK(j["items"][1]["tag"].as<std::string>() == "");
+    CHECK(j["items"][2]["tag"].as<std::string>() == "hit");
+    RemoveFile(path);
+}
+
+static void Test_RewriteJsonFile_ReplacesOnlyOnSuccess()
+{
+    const std::string text = R"({"a":{"b":1,"c":[1,2],"d":{"e":"x"}},"f":[{"g":1}],"h":"y"})";
+    const auto original = json::parse(text);
+
+    // A streamed merge replaces the file
+    const auto overlay = json::parse(R"({"a":{"b":{"z":1},"c":null,"d":{"e":null,"k":[]}},"f":{"g":2},"h":null,"n":{"m":{"q":null,"r":1}}})");
+    json merged = original;
+    mergepatch::apply_merge_patch(merged, overlay);
+    auto path = WriteTempJson(text);
+    std::error_code rewriteEc;
+    CHECK_HR(RewriteJsonFile(path.c_str(), [&overlay](std::istream& input, json_visitor& output, std::error_code& ec)
+        {
+            mergepatch::stream_apply_merge_patch(input, overlay, output, ec);
+        }, rewriteEc));
+    CHECK(!rewriteEc);
+    CHECK(ReadJson(path) == merged);
+
+    // A failed rewrite leaves the file as it was
+    CHECK(S_FALSE == RewriteJsonFile(path.c_str(), [](std::istream& input, json_visitor& output, std::error_code& ec)
+        {
+            jsonpatch::stream_apply_patch(input, json::parse(R"([{"op":"remove","path":"/missing"}])"), output, ec);
+        }, rewriteEc));
+    CHECK(rewriteEc == jsonpatch::jsonpatch_errc::remove_failed);
+    CHECK(ReadJson(path) == merged);
+    CHECK(!fs::exists(fs::path(path + L".wixjson.tmp")));
+
+    // So does one that throws after writing part of the output
+    rewriteEc.clear();
+    CHECK(S_FALSE == RewriteJsonFile(path.c_str(), [](std::istream&, json_visitor& output, std::error_code&)
+        {
+            output.begin_object();
+            throw std::runtime_error("transform failed");
+        }, rewriteEc));
+    CHECK(rewriteEc);
+    CHECK(ReadJson(path) == merged);
+    CHECK(!fs::exists(fs::path(path + L".wixjson.tmp")));
+    RemoveFile(path);
+}
+
+static void Test_Write_KeepsMemberOrder()
+{
+    // Every action writes members in file order and adds new members at the end of their object
+    auto path = WriteTempJson(R"({"z":{"b":1,"a":2},"m":[{"y":1,"x":2}]})");
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.z.a", L"3", FlagFor(FLAG_SETVALUE), -1, L""));
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"/z/c", L"4", FlagFor(FLAG_CREATEVALUE), -1, L""));
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.z.b", L"", FlagFor(FLAG_DELETEVALUE), -1, L""));
+    CHECK_HR(UpdateJsonFile(path.c_str(), L"$.m", LR"({"w":0,"v":1})", FlagFor(FLAG_APPENDARRAY), -1, L""));
+    CHECK(ojson::parse(ReadText(path)).to_string() == R"({"z":{"a":3,"c":4},"m":[{"y":1,"x":2},{"w":0,"v":1}]})");
+    RemoveFile(path);
+}
+
 static void Test_Write_LeavesNoTempFile()
 {
     auto path = WriteTempJson(R"({"config":{"value":"old"}})");
@@ -250,6 +561,608 @@ static void Test_Schema_ValidPasses_InvalidFails()
     RemoveFile(badPath);
 }
 
+// Tests of the jsoncons library extensions the transforms are built on. They call the library
+// directly, without files.
+
+static void Test_JsonPath_KeyIndexMatchesWalk()
+{
+    auto root = json::parse(R"({"Name":"top","items":[{"Name":"a","Sub":{"Name":{"x":1}}},{"Sub":[{"Name":"b"}]}]})");
+    jsonpath::key_index<json> index(root);
+
+    for (const char* path : { "$..Name", "$.items..Name", "$..Name.x", "$..Missing" })
+    {
+        auto expr = jsonpath::make_expression<json>(path);
+        auto walked = expr.select_nodes(root, jsonpath::result_options::path);
+        auto indexed = expr.select_nodes(root, index, jsonpath::result_options::path);
+        CHECK(walked.size() == indexed.size());
+        for (std::size_t i = 0; i < walked.size() && i < indexed.size(); ++i)
+        {
+            CHECK(&walked[i] == &indexed[i]);
+            CHECK(jsonpath::to_basic_string(walked.path(i)) == jsonpath::to_basic_string(indexed.path(i)));
+        }
+    }
+    CHECK(index.built());
+
+    root["items"][1]["Name"] = "c";
+    index.invalidate();
+    CHECK(jsonpath::make_expression<json>("$.items..Name").select_nodes(root, index).size() == 4);
+
+    // Only a descent to a member name is served from the index
+    for (const char* path : { "$..Name", "$.items..Name.x", "$['a','b']..Name" })
+    {
+        CHECK(jsonpath::make_expression<json>(path).uses_key_index());
+    }
+    for (const char* path : { "$.items[0].Name", "$['a..b']", "$..*", "$..[0]", "$..0", "$..length" })
+    {
+        CHECK(!jsonpath::make_expression<json>(path).uses_key_index());
+    }
+}
+
+static void Test_JsonPath_SelectNodesReferencesMatches()
+{
+    auto root = json::parse(R"({"items":[{"id":1},{"id":2}],"name":"x"})");
+
+    // The list refers to the document's own nodes
+    auto ids = jsonpath::json_query_nodes(root, "$.items[*].id");
+    CHECK(ids.size() == 2);
+    CHECK(&ids[0] == &root["items"][0]["id"]);
+    CHECK(&ids[1] == &root["items"][1]["id"]);
+    CHECK(ids.to_array() == json::parse("[1,2]"));
+
+    // Computed values and paths belong to the list and outlive the expression
+    jsonpath::node_list<json> lengths;
+    {
+        auto expr = jsonpath::make_expression<json>("$['items'].length");
+        lengths = expr.select_nodes(root, jsonpath::result_options::path);
+    }
+    CHECK(lengths.size() == 1);
+    CHECK(lengths[0] == json(2));
+    CHECK(jsonpath::to_basic_string(lengths.path(0)) == "$['items']['length']");
+
+    auto none = jsonpath::json_query_nodes(root, "$.missing");
+    CHECK(none.empty());
+    CHECK(none.to_array() == json(json_array_arg));
+}
+
+static void Test_JsonPath_NoDupsAndSortOrder()
+{
+    using jsonpath::result_options;
+    auto root = json::parse(R"({"b":{"x":1},"a":[10,{"x":2}],"c":{"x":3}})");
+    auto selected = [&](const char* path, result_options options)
+    {
+        std::vector<std::string> paths;
+        jsonpath::make_expression<json>(path).evaluate(root,
+            [&](const std::string& p, const json&) { paths.push_back(p); }, options);
+        return paths;
+    };
+    using paths = std::vector<std::string>;
+
+    // nodups alone keeps the first match of each node, in the order matched
+    CHECK((selected("$['c','a','c','b'].x", result_options::nodups) == paths{ "$['c']['x']", "$['b']['x']" }));
+    CHECK((selected("$['c','a','c','b'].x", result_options()) == paths{ "$['c']['x']", "$['c']['x']", "$['b']['x']" }));
+    CHECK((selected("$[*,'a'][1]", result_options::nodups) == paths{ "$['a'][1]" }));
+
+    // With a sort the survivors are in path order
+    CHECK((selected("$['c','a','c','b'].x", result_options::nodups | result_options::sort) == paths{ "$['b']['x']", "$['c']['x']" }));
+    CHECK((selected("$['c','a','c','b'].x", result_options::nodups | result_options::sort_descending) == paths{ "$['c']['x']", "$['b']['x']" }));
+    CHECK((selected("$..x", result_options::sort_descending) == paths{ "$['c']['x']", "$['b']['x']", "$['a'][1]['x']" }));
+
+    // sort_descending orders values even when paths are not asked for
+    CHECK(jsonpath::json_query(root, "$..x", result_options::sort_descending) == json::parse("[3,1,2]"));
+    CHECK(jsonpath::json_query(root, "$..x", result_options::sort) == json::parse("[2,1,3]"));
+
+    // A computed value has no node in the document, so each one is kept
+    CHECK(jsonpath::json_query(root, "$['a','a'].length", result_options::nodups) == json::parse("[2,2]"));
+}
+
+static void Test_JsonPath_DirectLookupPaths()
+{
+    auto root = json::parse(R"({"arr":[1,2,3],"o":{"0":"zero","k":[{"v":"last"}]},"s":"abc"})");
+    struct Case { const char* path; const char* matches; const char* normalized; };
+    const Case cases[] = {
+        { "$.arr.0", "[1]", "$['arr'][0]" },
+        { "$.arr[-1]", "[3]", "$['arr'][2]" },
+        { "$.arr.length", "[3]", "$['arr']['length']" },
+        { "$.s.length", "[3]", "$['s']['length']" },
+        { "$.o.0", "[\"zero\"]", "$['o']['0']" },
+        { "$['o']['k'][-1]['v']", "[\"last\"]", "$['o']['k'][0]['v']" },
+        { "$.arr[5]", "[]", nullptr },
+        { "$.arr[-4]", "[]", nullptr },
+        { "$.missing.x", "[]", nullptr },
+    };
+    for (const auto& c : cases)
+    {
+        auto expr = jsonpath::make_expression<json>(c.path);
+        auto matches = json::parse(c.matches);
+        CHECK(expr.evaluate(root) == matches);
+        CHECK(expr.exists(root) == !matches.empty());
+        auto first = expr.first(root);
+        CHECK((first.ptr() == nullptr) == matches.empty());
+        if (first.ptr() != nullptr && !matches.empty())
+        {
+            CHECK(first.value() == matches[0]);
+        }
+        auto normalized = expr.evaluate(root, jsonpath::result_options::path);
+        CHECK(normalized.size() == (c.normalized ? 1u : 0u));
+        if (c.normalized && normalized.size() == 1)
+        {
+            CHECK(normalized[0].as<std::string>() == c.normalized);
+        }
+    }
+
+    // Updates go through the same lookups
+    auto matches = jsonpath::make_expression<json>("$['o']['k'][-1]['v']").resolve(root);
+    matches.update([](const jsonpath::path_node&, json& value) { value = "updated"; });
+    CHECK(root["o"]["k"][0]["v"].as<std::string>() == "updated");
+}
+
+static void Test_JsonPath_NodeListUpdateNeedsPaths()
+{
+    auto root = json::parse(R"({"a":{"v":1},"b":{"v":2}})");
+    auto expr = jsonpath::make_expression<json>("$.*.v");
+
+    // A resolved list always records paths, even though resolve() takes no options
+    auto resolved = expr.resolve(root);
+    CHECK(resolved.has_paths());
+    std::vector<std::string> visited;
+    resolved.update([&](const jsonpath::path_node& path, json& value)
+    {
+        visited.push_back(jsonpath::to_basic_string(path));
+        value = value.as<int>() * 10;
+    });
+    CHECK((visited == std::vector<std::string>{ "$['b']['v']", "$['a']['v']" }));
+    CHECK(root == json::parse(R"({"a":{"v":10},"b":{"v":20}})"));
+
+    // A selected list has paths only if asked for them
+    auto withPaths = expr.select_nodes(root, jsonpath::result_options::path);
+    CHECK(withPaths.has_paths());
+    std::size_t count = 0;
+    withPaths.update([&](const jsonpath::path_node&, const json&) { ++count; });
+    CHECK(count == 2);
+
+    auto withoutPaths = expr.select_nodes(root);
+    CHECK(!withoutPaths.has_paths());
+    bool threw = false;
+    try
+    {
+        withoutPaths.update([](const jsonpath::path_node&, const json&) {});
+    }
+    catch (const std::logic_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void Test_Regex_MatcherAgreesWithStdRegex()
+{
+    // Automaton, Pike VM (\b) and std::regex fallback (back reference) patterns
+    const char* patterns[] = { "lazy", "\\d{3}-\\d{4}", "^[a-z0-9._%+-]+@[a-z0-9.-]+\\.[a-z]{2,}$", "(a+)+$",
+        "(a|aa)*b", "^$", "a*?", "[^ ]+", "\\bfox\\b", "x|^The", "(o)\\1" };
+    const char* inputs[] = { "", "The quick brown fox", "call 555-1234 now", "john.doe@example.com",
+        "aaaa!", "aab", "foxes fox", "boot" };
+    for (const char* pattern : patterns)
+    {
+        for (bool icase : { false, true })
+        {
+            auto options = icase ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript;
+            std::regex expected(pattern, options);
+            jsoncons::utility::regex_matcher matcher(jsoncons::string_view(pattern), icase);
+            for (const char* input : inputs)
+            {
+                std::string s(input);
+                CHECK(matcher.search(s) == std::regex_search(s, expected));
+                std::vector<std::string> pieces;
+                matcher.split(s, [&](const jsoncons::string_view& piece) { pieces.emplace_back(piece.data(), piece.size()); });
+                std::vector<std::string> expectedPieces(std::sregex_token_iterator(s.begin(), s.end(), expected, -1),
+                    std::sregex_token_iterator());
+                CHECK(pieces == expectedPieces);
+            }
+        }
+    }
+    CHECK(jsoncons::utility::regex_matcher(jsoncons::string_view("(a+)+$")).is_linear());
+    CHECK(!jsoncons::utility::regex_matcher(jsoncons::string_view("(o)\\1")).is_linear());
+}
+
+static void Test_JsonPath_StreamQueryMatchesDom()
+{
+    const std::string text = R"({"z":{"id":0},"a":{"b":[{"id":1,"on":true},{"id":2,"t":[4,5,6]}],"c":"x"},"d":{"id":3}})";
+    auto root = json::parse(text);
+    const char* paths[] = { "$.a.c", "$.a.b[1].id", "$..id", "$.a.b[*].t[1:]", "$..b..id", "$.missing.id", "$", "$..id", "$.*.b[*].id", "$..t[2]" };
+
+    jsonpath::stream_query<json> query;
+    for (const char* path : paths)
+    {
+        CHECK(query.add(path) != query.npos);
+    }
+    // Filters and lengths need the document
+    CHECK(query.add("$.a.b[?(@.on)].id") == query.npos);
+    CHECK(query.add("$.a.b.length") == query.npos);
+    CHECK(query.size() == std::size(paths));
+    CHECK(query.singular(1));
+    CHECK(!query.singular(2));
+
+    std::vector<std::vector<json>> streamed(query.size());
+    std::vector<std::vector<std::string>> streamedPaths(query.size());
+    json_string_cursor selectCursor(text);
+    query.select(selectCursor, [&](std::size_t i, const jsonpath::path_node& path, const json& value)
+    {
+        streamed[i].push_back(value);
+        streamedPaths[i].push_back(jsonpath::to_basic_string(path));
+    });
+
+    json_string_cursor firstCursor(text);
+    auto firsts = query.first(firstCursor);
+    auto inDocument = query.first(root);
+    for (std::size_t i = 0; i < query.size(); ++i)
+    {
+        auto expr = jsonpath::make_expression<json>(paths[i]);
+        CHECK(json(json_array_arg, streamed[i].begin(), streamed[i].end()) == expr.evaluate(root));
+        std::vector<std::string> domPaths;
+        expr.evaluate(root, [&](const std::string& path, const json&) { domPaths.push_back(path); });
+        CHECK(streamedPaths[i] == domPaths);
+        auto single = expr.first(root);
+        CHECK((single.ptr() == nullptr) == (firsts[i].ptr() == nullptr));
+        if (single.ptr() != nullptr && firsts[i].ptr() != nullptr)
+        {
+            CHECK(single.value() == firsts[i].value());
+        }
+        // Answered from the parsed document, a match is the node itself
+        CHECK(inDocument[i].ptr() == single.ptr());
+    }
+}
+
+static void Test_JsonReplace_PathNodeCallbackMatchesStringCallback()
+{
+    auto byString = json::parse(R"({"a":[{"t":[1,1]},{"t":[2]}],"b":{"t":[3]}})");
+    auto byNode = byString;
+
+    std::vector<std::string> stringPaths;
+    jsonpath::json_replace(byString, "$..t", [&](const std::string& path, json& value)
+    {
+        stringPaths.push_back(path);
+        value.push_back(0);
+    });
+
+    std::vector<std::string> nodePaths;
+    jsonpath::json_replace(byNode, "$..t", [&](const jsonpath::path_node& path, json& value)
+    {
+        nodePaths.push_back(jsonpath::to_basic_string(path));
+        value.push_back(0);
+    });
+
+    CHECK(stringPaths.size() == 3);
+    CHECK(nodePaths == stringPaths);
+    CHECK(byNode == byString);
+}
+
+// Counts the bytes handed out, so a test can tell which allocator a temporary came from
+template <typename T>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    std::size_t* allocated;
+
+    explicit CountingAllocator(std::size_t* allocated) : allocated(allocated) {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : allocated(other.allocated) {}
+
+    T* allocate(std::size_t n)
+    {
+        *allocated += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, std::size_t n)
+    {
+        std::allocator<T>().deallocate(p, n);
+    }
+    bool operator==(const CountingAllocator& other) const { return allocated == other.allocated; }
+    bool operator!=(const CountingAllocator& other) const { return allocated != other.allocated; }
+};
+
+static void Test_JsonReplace_TempAllocatorBacksEvaluation()
+{
+    auto viaArena = json::parse(R"({"a":[{"n":1},{"n":2},{"n":3}],"b":{"n":4}})");
+    auto viaDefault = viaArena;
+
+    std::size_t allocated = 0;
+    auto aset = make_alloc_set(std::allocator<char>(), CountingAllocator<char>(&allocated));
+    jsonpath::json_replace(aset, viaArena, "$..[?(@.n > 1)].n", [](const jsonpath::path_node&, json& value)
+    {
+        value = value.as<int>() * 10;
+    });
+    jsonpath::json_replace(viaDefault, "$..[?(@.n > 1)].n", [](const jsonpath::path_node&, json& value)
+    {
+        value = value.as<int>() * 10;
+    });
+
+    // Path nodes and filter temporaries were placed in blocks from the temp allocator
+    CHECK(allocated >= jsonpath::detail::eval_arena::block_size);
+    CHECK(viaArena == viaDefault);
+    CHECK(viaArena["a"][0]["n"] == 1);
+    CHECK(viaArena["b"]["n"] == 40);
+}
+
+static void Test_JsonPointer_PrefixResolverMatchesAdd()
+{
+    const char* locations[] = { "/a/b/c", "/a/b/d", "/a/b", "/a/b/x", "/arr", "/arr/-", "/arr/0",
+        "/arr/1/k", "/arr/0/k", "/a/b/x/y", "", "/q/r~1s/t", "/q/r~1s/u", "/q/v", "/arr/9" };
+    json expected = json::parse(R"({"arr":[]})");
+    json actual = expected;
+    jsonpointer::prefix_resolver<json> resolver(actual);
+    int n = 0;
+    for (const char* location : locations)
+    {
+        json value(json_object_arg);
+        value["n"] = ++n;
+        std::error_code ecExpected;
+        jsonpointer::add(expected, location, value, true, ecExpected);
+        std::error_code ecActual;
+        jsonpointer::json_pointer ptr(location);
+        CHECK((resolver.find(ptr) != nullptr) == jsonpointer::contains(actual, ptr));
+        resolver.add(ptr, value, true, ecActual);
+        CHECK(ecExpected == ecActual);
+        CHECK(expected == actual);
+    }
+
+    std::vector<std::pair<jsonpointer::json_pointer, json>> batch;
+    batch.emplace_back(jsonpointer::json_pointer("/x/y/1"), json(1));
+    batch.emplace_back(jsonpointer::json_pointer("/x/y/2"), json(2));
+    json document;
+    std::error_code ec;
+    jsonpointer::add_all(document, batch.begin(), batch.end(), true, ec);
+    CHECK(!ec);
+    CHECK(document == json::parse(R"({"x":{"y":{"1":1,"2":2}}})"));
+}
+
+static void Test_JsonPointer_CompiledMatchesParsed()
+{
+    const json original = json::parse(R"({"a":{"b":[1,{"c":2}],"x/y":{"":3}},"list":[0,1,2]})");
+    const char* locations[] = { "/a/b/1/c", "/a/b/-", "/a/b/01", "/a/b/1a", "/a/x~1y/", "/list/3",
+        "/list/2", "/missing/key", "/a/b/1/c/d", "" };
+    for (const char* location : locations)
+    {
+        const jsonpointer::compiled_json_pointer compiled(location);
+        CHECK(jsonpointer::contains(original, compiled) == jsonpointer::contains(original, location));
+
+        std::error_code ecParsed;
+        std::error_code ecCompiled;
+        json parsed = original;
+        json viaCompiled = original;
+        jsonpointer::add(parsed, location, json("v"), true, ecParsed);
+        jsonpointer::add(viaCompiled, compiled, json("v"), true, ecCompiled);
+        CHECK(ecParsed == ecCompiled && parsed == viaCompiled);
+
+        ecParsed.clear();
+        ecCompiled.clear();
+        jsonpointer::replace(parsed, location, json(7), ecParsed);
+        jsonpointer::replace(viaCompiled, compiled, json(7), ecCompiled);
+        CHECK(ecParsed == ecCompiled && parsed == viaCompiled);
+
+        ecParsed.clear();
+        ecCompiled.clear();
+        jsonpointer::remove(parsed, location, ecParsed);
+        jsonpointer::remove(viaCompiled, compiled, ecCompiled);
+        CHECK(ecParsed == ecCompiled && parsed == viaCompiled);
+    }
+    CHECK(jsonpointer::get(original, jsonpointer::compiled_json_pointer("/a/x~1y/")) == json(3));
+
+    // A resolver takes compiled pointers too, alone or mixed with parsed ones
+    json parsed = original;
+    json viaCompiled = original;
+    jsonpointer::prefix_resolver<json> parsedResolver(parsed);
+    jsonpointer::prefix_resolver<json> compiledResolver(viaCompiled);
+    int n = 0;
+    for (const char* location : locations)
+    {
+        std::error_code ecParsed;
+        std::error_code ecCompiled;
+        const jsonpointer::compiled_json_pointer compiled(location);
+        CHECK((parsedResolver.find(jsonpointer::json_pointer(location)) != nullptr) == (compiledResolver.find(compiled) != nullptr));
+        parsedResolver.add(jsonpointer::json_pointer(location), json(++n), true, ecParsed);
+        compiledResolver.add(compiled, json(n), true, ecCompiled);
+        CHECK(ecParsed == ecCompiled && parsed == viaCompiled);
+    }
+    std::vector<std::pair<jsonpointer::compiled_json_pointer, json>> batch;
+    batch.emplace_back(jsonpointer::compiled_json_pointer("/list/0"), json("first"));
+    batch.emplace_back(jsonpointer::compiled_json_pointer("/list/-"), json("last"));
+    json document = original;
+    std::error_code ec;
+    jsonpointer::add_all(document, batch.begin(), batch.end(), true, ec);
+    CHECK(!ec);
+    CHECK(document["list"] == json::parse(R"(["first",0,1,2,"last"])"));
+}
+
+static void Test_Flatten_RoundTripsJsonPointerAndJsonPath()
+{
+    const std::string text = R"({"b":{"y":[1,{"z":null}],"x":"s"},"a~/'":[],"e":{},"list":[[2,3],true]})";
+    const json document = json::parse(text);
+
+    json pointers = jsonpointer::flatten(document);
+    CHECK(pointers == json::parse(R"({"/a~0~1'":[],"/b/x":"s","/b/y/0":1,"/b/y/1/z":null,"/e":{},"/list/0/0":2,"/list/0/1":3,"/list/1":true})"));
+    CHECK(jsonpointer::unflatten(pointers) == document);
+    CHECK(jsonpointer::unflatten(pointers, jsonpointer::unflatten_options::assume_object) ==
+          json::parse(R"({"a~/'":[],"b":{"x":"s","y":{"0":1,"1":{"z":null}}},"e":{},"list":{"0":{"0":2,"1":3},"1":true}})"));
+
+    json paths = jsonpath::flatten(document);
+    CHECK(paths.size() == pointers.size());
+    CHECK(paths.contains("$['a~/\\'']") && paths.contains("$['b']['y'][1]['z']") && paths.contains("$['list'][0][1]"));
+    CHECK(jsonpath::unflatten(paths) == document);
+
+    // An order preserving document keeps its members in document order
+    const ojson ordered = ojson::parse(text);
+    ojson orderedPointers = jsonpointer::flatten(ordered);
+    CHECK(orderedPointers.object_range().begin()->key() == "/b/y/0");
+    CHECK(jsonpointer::unflatten(orderedPointers).to_string() == ordered.to_string());
+    ojson orderedPaths = jsonpath::flatten(ordered);
+    CHECK(orderedPaths.object_range().begin()->key() == "$['b']['y'][0]");
+    CHECK(jsonpath::unflatten(orderedPaths).to_string() == ordered.to_string());
+}
+
+static void Test_MergePatch_InPlaceKeepsUntouchedMembers()
+{
+    // RFC 7396 section 3 example
+    auto target = json::parse(R"({"title":"Goodbye!","author":{"givenName":"John","familyName":"Doe"},"tags":["example","sample"],"content":"This will be unchanged"})");
+    auto patch = json::parse(R"({"title":"Hello!","phoneNumber":"+01-555-1234-5678","author":{"familyName":null},"tags":["example"]})");
+    auto expected = json::parse(R"({"title":"Hello!","author":{"givenName":"John"},"tags":["example"],"content":"This will be unchanged","phoneNumber":"+01-555-1234-5678"})");
+
+    jsoncons::mergepatch::apply_merge_patch(target, patch);
+    CHECK(target == expected);
+
+    // Patched members stay where they are; removed ones close up and new ones follow
+    auto ordered = ojson::parse(R"({"a":1,"b":{"x":1,"y":2},"c":3,"d":4})");
+    jsoncons::mergepatch::apply_merge_patch(ordered, ojson::parse(R"({"b":{"x":null,"z":3},"a":null,"e":5,"c":null})"));
+    CHECK(ordered.to_string() == R"({"b":{"y":2,"z":3},"d":4,"e":5})");
+
+    auto moved = json::parse(R"({"a":{"b":1}})");
+    jsoncons::mergepatch::apply_merge_patch(moved, json::parse(R"({"a":{"c":[1,2,3]},"d":null})"));
+    CHECK(moved == json::parse(R"({"a":{"b":1,"c":[1,2,3]}})"));
+}
+
+static void Test_JsonPatch_FailedPatchRestoresTarget()
+{
+    const auto original = json::parse(R"({"a":{"big":[1,2,3]},"b":[4,5],"c":"x"})");
+    const char* patches[] = {
+        R"([{"op":"replace","path":"/a","value":0},{"op":"remove","path":"/b/0"},{"op":"move","from":"/c","path":"/b/-"},{"op":"test","path":"/c","value":"x"}])",
+        R"([{"op":"move","from":"/a","path":"/b/0"},{"op":"copy","from":"/b","path":"/c"},{"op":"remove","path":"/missing"}])",
+        // Operations on the whole document are undone too
+        R"([{"op":"add","path":"","value":[]},{"op":"add","path":"/-","value":1},{"op":"test","path":"/0","value":2}])",
+        R"([{"op":"move","from":"/b","path":""},{"op":"replace","path":"/0","value":9},{"op":"remove","path":"/5"}])" };
+    for (const char* patch : patches)
+    {
+        json target = original;
+        std::error_code ec;
+        jsonpatch::apply_patch(target, json::parse(patch), ec);
+        CHECK(ec);
+        CHECK(target == original);
+    }
+
+    json target = original;
+    std::error_code ec;
+    jsonpatch::apply_patch(target, json::parse(R"([{"op":"move","from":"/a/big","path":"/d"},{"op":"replace","path":"/b","value":{"e":1}}])"), ec);
+    CHECK(!ec);
+    CHECK(target == json::parse(R"({"a":{},"b":{"e":1},"c":"x","d":[1,2,3]})"));
+}
+
+static void Test_JsonPatch_FromDiffAlignsArrayElements()
+{
+    json source(json_array_arg);
+    for (int i = 0; i < 1000; ++i)
+    {
+        json item(json_object_arg);
+        item["id"] = i;
+        source.push_back(std::move(item));
+    }
+
+    // Inserting at the front is one add, not a replace of every element
+    json target = source;
+    target.insert(target.array_range().begin(), json(-1));
+    json patch = jsonpatch::from_diff(source, target);
+    CHECK(patch == json::parse(R"([{"op":"add","path":"/0","value":-1}])"));
+
+    // A removal, an insertion and a changed element, in order
+    target = source;
+    target.erase(target.array_range().begin() + 10);
+    target.insert(target.array_range().begin() + 500, json("new"));
+    target[900]["id"] = "changed";
+    patch = jsonpatch::from_diff(source, target);
+    CHECK(patch.size() == 3);
+    json patched = source;
+    jsonpatch::apply_patch(patched, patch);
+    CHECK(patched == target);
+
+    // Reordered and mixed elements still round-trip
+    target = json::parse(R"([3,[1,2],{"a":1},"x",1])");
+    patched = json::parse(R"([1,{"a":1},[1,2],3])");
+    jsonpatch::apply_patch(patched, jsonpatch::from_diff(patched, target));
+    CHECK(patched == target);
+}
+
+static void Test_JsonPatch_StreamDiffDetectsMoves()
+{
+    const json source = json::parse(R"({"app":{"name":"x","log":{"level":"info","path":"C:/logs"}},"items":[{"id":1},{"id":2},{"id":3},{"id":4}]})");
+    const json target = json::parse(R"({"app":{"name":"y","logging":{"level":"info","path":"C:/logs"}},"items":[{"id":2},{"id":3},{"id":1},{"id":4},{"id":5}]})");
+
+    json patch(json_array_arg);
+    jsonpatch::stream_diff(source, target, [&patch](const json& operation) { patch.push_back(operation); });
+    CHECK(patch == json::parse(R"([
+        {"op":"replace","path":"/app/name","value":"y"},
+        {"op":"move","from":"/app/log","path":"/app/logging"},
+        {"op":"move","from":"/items/0","path":"/items/2"},
+        {"op":"add","path":"/items/4","value":{"id":5}}])"));
+    json patched = source;
+    jsonpatch::apply_patch(patched, patch);
+    CHECK(patched == target);
+
+    // An index is built once and can be diffed against several documents
+    const jsonpatch::structural_index<json> sourceIndex(source);
+    int operations = 0;
+    jsonpatch::stream_diff(sourceIndex, jsonpatch::structural_index<json>(source), [&operations](const json&) { ++operations; });
+    CHECK(operations == 0);
+    jsonpatch::stream_diff(sourceIndex, jsonpatch::structural_index<json>(target), [&operations](const json&) { ++operations; });
+    CHECK(operations == 4);
+}
+
+static void Test_JsonPatch_StreamApplyMatchesDom()
+{
+    const std::string text = R"({"a":{"b":1,"c":[1,2],"d":{"e":"x"}},"f":[{"g":1}],"h":"y"})";
+    const auto original = json::parse(text);
+    const char* patches[] = {
+        R"([{"op":"replace","path":"/a/b","value":{"n":[1]}},{"op":"remove","path":"/h"},{"op":"add","path":"/a/d/new","value":2}])",
+        R"([{"op":"add","path":"/a/c/-","value":3},{"op":"add","path":"/a/c/-","value":4},{"op":"add","path":"/f","value":null}])",
+        R"([{"op":"add","path":"/a/-","value":1},{"op":"remove","path":"/a/d"}])" };
+    for (const char* patchText : patches)
+    {
+        const auto patch = json::parse(patchText);
+        std::istringstream input(text);
+        std::ostringstream output;
+        json_stream_encoder encoder(output);
+        std::error_code ec;
+        jsonpatch::stream_apply_patch(input, patch, encoder, ec);
+        CHECK(!ec);
+        json expected = original;
+        jsonpatch::apply_patch(expected, patch);
+        CHECK(json::parse(output.str()) == expected);
+    }
+
+    // Patches whose result depends on element positions or operation order are not streamed,
+    // and a missing target fails as it would in memory
+    const char* unsupported[] = {
+        R"([{"op":"remove","path":"/f/0"}])",
+        R"([{"op":"add","path":"/x","value":{}},{"op":"add","path":"/x/y","value":1}])",
+        R"([{"op":"move","from":"/h","path":"/i"}])" };
+    for (const char* patchText : unsupported)
+    {
+        std::istringstream input(text);
+        std::ostringstream output;
+        json_stream_encoder encoder(output);
+        std::error_code ec;
+        jsonpatch::stream_apply_patch(input, json::parse(patchText), encoder, ec);
+        CHECK(ec == jsonpatch::jsonpatch_errc::stream_unsupported);
+    }
+    {
+        std::istringstream input(text);
+        std::ostringstream output;
+        json_stream_encoder encoder(output);
+        std::error_code ec;
+        jsonpatch::stream_apply_patch(input, json::parse(R"([{"op":"replace","path":"/a/missing","value":1}])"), encoder, ec);
+        CHECK(ec == jsonpatch::jsonpatch_errc::replace_failed);
+    }
+
+    // Any merge patch streams, including into members that are not objects
+    const auto overlay = json::parse(R"({"a":{"b":{"z":1},"c":null,"d":{"e":null,"k":[]}},"f":{"g":2},"h":null,"n":{"m":{"q":null,"r":1}}})");
+    json merged = original;
+    mergepatch::apply_merge_patch(merged, overlay);
+    std::istringstream input(text);
+    std::ostringstream output;
+    json_stream_encoder encoder(output);
+    std::error_code ec;
+    mergepatch::stream_apply_merge_patch(input, overlay, encoder, ec);
+    CHECK(!ec);
+    CHECK(json::parse(output.str()) == merged);
+}
+
 static void RunTest(const char* name, void (*fn)())
 {
     g_results.push_back(TestResult{ name });
@@ -312,20 +1225,55 @@ int main(int argc, char** argv)
     RunTest("SetValue_UpdatesExisting", Test_SetValue_UpdatesExisting);
     RunTest("CreatePointer_CreatesNestedPath", Test_CreatePointer_CreatesNestedPath);
     RunTest("DeleteValue_RemovesKey", Test_DeleteValue_RemovesKey);
+    RunTest("DeleteValue_DuplicateUnionIndexRemovedOnce", Test_DeleteValue_DuplicateUnionIndexRemovedOnce);
     RunTest("AppendArray_AddsElement", Test_AppendArray_AddsElement);
     RunTest("InsertArray_AtIndex", Test_InsertArray_AtIndex);
     RunTest("OnlyIfExists_SkipsMissingPath", Test_OnlyIfExists_SkipsMissingPath);
     RunTest("OnlyIfExists_AppliesWhenPresent", Test_OnlyIfExists_AppliesWhenPresent);
     RunTest("SetValue_PreservesStringType", Test_SetValue_PreservesStringType);
     RunTest("SetValue_WritesTypedValueForNonStrings", Test_SetValue_WritesTypedValueForNonStrings);
+    RunTest("SetValue_WildcardAppliesPerMatchType", Test_SetValue_WildcardAppliesPerMatchType);
+    RunTest("SetValue_PlainTextBecomesString", Test_SetValue_PlainTextBecomesString);
     RunTest("CreatePointer_UpdatesExistingValue", Test_CreatePointer_UpdatesExistingValue);
     RunTest("CreatePointer_TypedValueForNewPath", Test_CreatePointer_TypedValueForNewPath);
     RunTest("OnlyIfExists_SkipsMissingFile", Test_OnlyIfExists_SkipsMissingFile);
     RunTest("RemoveArrayElement_ByValue", Test_RemoveArrayElement_ByValue);
     RunTest("DistinctArray_RemovesDuplicates", Test_DistinctArray_RemovesDuplicates);
+    RunTest("DistinctArray_RejectsNonArrayMatch", Test_DistinctArray_RejectsNonArrayMatch);
+    RunTest("ApplyJsonPatch_AppliesAllOperations", Test_ApplyJsonPatch_AppliesAllOperations);
+    RunTest("ApplyJsonPatch_FailureLeavesFileUnchanged", Test_ApplyJsonPatch_FailureLeavesFileUnchanged);
+    RunTest("MergeJson_MergesOverlayFile", Test_MergeJson_MergesOverlayFile);
+    RunTest("MergeJson_HonorsOnlyIfExistsAndSchema", Test_MergeJson_HonorsOnlyIfExistsAndSchema);
+    RunTest("StreamedRewrite_MatchesInMemoryOrder", Test_StreamedRewrite_MatchesInMemoryOrder);
+    RunTest("OnlyIfExists_RecursivePath", Test_OnlyIfExists_RecursivePath);
+    RunTest("JsonPathCache_SharedByCheckAndAction", Test_JsonPathCache_SharedByCheckAndAction);
+    RunTest("SetJsonPointerValues_MatchesRowByRow", Test_SetJsonPointerValues_MatchesRowByRow);
+    RunTest("SetValue_FilterComparesByType", Test_SetValue_FilterComparesByType);
+    RunTest("SetValue_FilterRegexMatch", Test_SetValue_FilterRegexMatch);
+    RunTest("RewriteJsonFile_ReplacesOnlyOnSuccess", Test_RewriteJsonFile_ReplacesOnlyOnSuccess);
+    RunTest("Write_KeepsMemberOrder", Test_Write_KeepsMemberOrder);
     RunTest("Write_LeavesNoTempFile", Test_Write_LeavesNoTempFile);
     RunTest("Schema_ValidPasses_InvalidFails", Test_Schema_ValidPasses_InvalidFails);
 
+    // jsoncons library extensions
+    RunTest("JsonPath_KeyIndexMatchesWalk", Test_JsonPath_KeyIndexMatchesWalk);
+    RunTest("JsonPath_SelectNodesReferencesMatches", Test_JsonPath_SelectNodesReferencesMatches);
+    RunTest("JsonPath_NoDupsAndSortOrder", Test_JsonPath_NoDupsAndSortOrder);
+    RunTest("JsonPath_DirectLookupPaths", Test_JsonPath_DirectLookupPaths);
+    RunTest("JsonPath_NodeListUpdateNeedsPaths", Test_JsonPath_NodeListUpdateNeedsPaths);
+    RunTest("Regex_MatcherAgreesWithStdRegex", Test_Regex_MatcherAgreesWithStdRegex);
+    RunTest("JsonPath_StreamQueryMatchesDom", Test_JsonPath_StreamQueryMatchesDom);
+    RunTest("JsonReplace_PathNodeCallbackMatchesStringCallback", Test_JsonReplace_PathNodeCallbackMatchesStringCallback);
+    RunTest("JsonReplace_TempAllocatorBacksEvaluation", Test_JsonReplace_TempAllocatorBacksEvaluation);
+    RunTest("JsonPointer_PrefixResolverMatchesAdd", Test_JsonPointer_PrefixResolverMatchesAdd);
+    RunTest("JsonPointer_CompiledMatchesParsed", Test_JsonPointer_CompiledMatchesParsed);
+    RunTest("Flatten_RoundTripsJsonPointerAndJsonPath", Test_Flatten_RoundTripsJsonPointerAndJsonPath);
+    RunTest("MergePatch_InPlaceKeepsUntouchedMembers", Test_MergePatch_InPlaceKeepsUntouchedMembers);
+    RunTest("JsonPatch_FailedPatchRestoresTarget", Test_JsonPatch_FailedPatchRestoresTarget);
+    RunTest("JsonPatch_FromDiffAlignsArrayElements", Test_JsonPatch_FromDiffAlignsArrayElements);
+    RunTest("JsonPatch_StreamDiffDetectsMoves", Test_JsonPatch_StreamDiffDetectsMoves);
+    RunTest("JsonPatch_StreamApplyMatchesDom", Test_JsonPatch_StreamApplyMatchesDom);
+
     std::string out = (argc > 1) ? argv[1] : "cpp-tests.xml";
     WriteJUnit(out);
 